@@ -24,53 +24,106 @@
 #define ESP8266_DBG_HTTP(label, data)
 #endif
 
+/* Serial port used until begin() is called, it discards everything */
+class ESP8266NullStream: public Stream
+{
+    public:
+        virtual size_t write(uint8_t) { return 0; }
+        virtual int available() { return 0; }
+        virtual int read() { return -1; }
+        virtual int peek() { return -1; }
+        virtual void flush() { }
+};
+
+static ESP8266NullStream nullStream;
+
+/* httpDownload() chunked transfer coding states */
+#define HTTP_CHUNK_SIZE             (0)  /* Chunk size line */
+#define HTTP_CHUNK_DATA             (1)  /* Chunk payload */
+#define HTTP_CHUNK_DATA_END         (2)  /* Line end after chunk payload */
+#define HTTP_CHUNK_TRAILER          (3)  /* Trailer fields after last chunk */
+#define HTTP_CHUNK_DONE             (4)  /* Whole body received */
+
 ESP8266::ESP8266(int rst, int en)
 {
     /* Save hardware configurations */
     _resetPin = rst;
     _enablePin = en;
+    _serial = &nullStream;
+    _rx = &nullStream;
+    _rxRing = NULL;
+    _rxAutoPump = false;
+    _linkOpen = false;
+    _passiveRecv = false;
+    _recvPending = 0;
+    _ipdRemaining = 0;
+    _ipdHeaderLen = 0;
+    _rxLineLen = 0;
+    _pingRtt = -1;
+    _lastResult = ESP8266_CMD_RSP_WAIT;
+    memset((void *) &_scan, 0, sizeof(_scan));
+    _scanSsid[0] = '\0';
+    _retryPolicy.attempts = ESP8266_RETRY_ATTEMPTS;
+    _retryPolicy.backoff = ESP8266_RETRY_BACKOFF;
+    _retryPolicy.maxBackoff = ESP8266_RETRY_MAX_BACKOFF;
+    _retryPolicy.jitter = ESP8266_RETRY_JITTER;
+    _retryPolicy.retryOn = ESP8266_RETRY_ON_BUSY;
+    _recoveryThreshold = ESP8266_RECOVERY_THRESHOLD;
+    _failStreak = 0;
+    _failSince = 0;
+    _wifiMode = 0;
+    _connMode = -1;
+    _echo = -1;
+    _apSsid = NULL;
+    _apPass = NULL;
+    _tcpServer = NULL;
+    _tcpPort = 0;
+    clearMetrics();
     pinMode(_resetPin, OUTPUT);
     pinMode(_enablePin, OUTPUT);
     digitalWrite(_resetPin, LOW);
     digitalWrite(_enablePin, LOW);
 }
 
+#ifndef ESP8266_NO_SOFTWARE_SERIAL
 void ESP8266::begin(SoftwareSerial &serialPort, uint32_t baud)
 {
-    /* Save Serial Port configurations */
-    _serialPortHandler.isSoftSerial = true;
-    _serialPortHandler._soft = &serialPort;
-    _serialPortHandler._hard = NULL;
-    setup(baud);
+    serialPort.begin(baud);
+    begin(serialPort);
 }
+#endif
 
 void ESP8266::begin(HardwareSerial &serialPort, uint32_t baud)
+{
+    serialPort.begin(baud);
+    begin(serialPort);
+}
+
+void ESP8266::begin(Stream &serialPort)
 {
     /* Save Serial Port configurations */
-    _serialPortHandler.isSoftSerial = false;
-    _serialPortHandler._soft = NULL;
-    _serialPortHandler._hard = &serialPort;
-    setup(baud);
+    _serial = &serialPort;
+    attachRxBuffer(_rxRing, _rxAutoPump);
+    setup();
 }
 
-void ESP8266::setup(uint32_t baud)
+void ESP8266::attachRxBuffer(ESP8266RingBuffer *ring, bool autoPump)
 {
-    /* Begin Serial Port */
-    if (_serialPortHandler.isSoftSerial)
+    _rxRing = ring;
+    _rxAutoPump = autoPump;
+    if (NULL != ring)
     {
-        if (NULL != _serialPortHandler._soft)
-        {
-            _serialPortHandler._soft->begin(baud);
-        }
+        ring->autoPump(autoPump ? _serial : NULL);
+        _rx = ring;
     }
     else
     {
-        if (NULL != _serialPortHandler._hard)
-        {
-            _serialPortHandler._hard->begin(baud);
-        }
+        _rx = _serial;
     }
+}
 
+void ESP8266::setup(void)
+{
     /* Enable ESP8266 */
     digitalWrite(_resetPin, HIGH);
     digitalWrite(_enablePin, HIGH);
@@ -81,79 +134,133 @@ bool ESP8266::hardReset()
     digitalWrite(_resetPin, LOW);
     delay(1000);
     digitalWrite(_resetPin, HIGH);
-    return (getResponse(NULL, AT_RESPONSE_RST, NULL, NULL, NULL, 1000) > 0);
+    _linkOpen = false;
+    _metrics.resets++;
+    return (getResponse(NULL, 0, AT_RESPONSE_RST, NULL, '\0', '\0', 1000) > 0);
 }
 
 bool ESP8266::test()
 {
-    sendCommand(AT_TEST, ESP8266_CMD_EXECUTE, NULL);
-    return (getResponse(NULL, AT_RESPONSE_OK, NULL, NULL, NULL, 1000) > 0);
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    do
+    {
+        sendCommand(AT_TEST, ESP8266_CMD_EXECUTE, NULL);
+        ret = getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 1000);
+    } while (retry(ret, &attempt));
+    return (ret > 0);
 }
 
 bool ESP8266::reset()
 {
     flush();
     sendCommand(AT_RESET, ESP8266_CMD_EXECUTE, NULL);
-    return (getResponse(NULL, AT_RESPONSE_RST, NULL, NULL, NULL, 3000) > 0);
+    _linkOpen = false;
+    _metrics.resets++;
+    return (getResponse(NULL, 0, AT_RESPONSE_RST, NULL, '\0', '\0', 3000) > 0);
 }
 
 bool ESP8266::echo(bool enable)
 {
-    if (enable)
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    do
     {
-        sendCommand(AT_ECHO_ENABLE, ESP8266_CMD_EXECUTE, NULL);
-    }
-    else
+        sendCommand(enable ? AT_ECHO_ENABLE : AT_ECHO_DISABLE, ESP8266_CMD_EXECUTE, NULL);
+        ret = getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 3000);
+    } while (retry(ret, &attempt));
+    if (ret > 0)
     {
-        sendCommand(AT_ECHO_DISABLE, ESP8266_CMD_EXECUTE, NULL);
+        _echo = enable ? 1 : 0;
     }
-    return (getResponse(NULL, AT_RESPONSE_OK, NULL, NULL, NULL, 3000) > 0);
+    return (ret > 0);
 }
 
 bool ESP8266::operationMode(int mode)
 {
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
     char modeStr[2];
     itoa(mode, modeStr, 10); /* Convert current int mode into ASCII (string) */
-    sendCommand(AT_SET_WIFI_MODE, ESP8266_CMD_SETUP, modeStr);
-    return (getResponse(NULL, AT_RESPONSE_OK, NULL, NULL, NULL, 1000) > 0);
+    do
+    {
+        sendCommand(AT_SET_WIFI_MODE, ESP8266_CMD_SETUP, modeStr);
+        ret = getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 1000);
+    } while (retry(ret, &attempt));
+    if (ret > 0)
+    {
+        _wifiMode = (int8_t) mode;
+    }
+    return (ret > 0);
 }
 
 bool ESP8266::connectionMode(int mode)
 {
-    bool ret = false;
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
     char modeStr[2];
     itoa(mode, modeStr, 10); /* Convert current int mode into ASCII (string) */
-    sendCommand(AT_CIPMUX, ESP8266_CMD_SETUP, modeStr);
-    return (getResponse(NULL, AT_RESPONSE_OK, NULL, NULL, NULL, 3000) > 0);
+    do
+    {
+        sendCommand(AT_CIPMUX, ESP8266_CMD_SETUP, modeStr);
+        ret = getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 3000);
+    } while (retry(ret, &attempt));
+    if (ret > 0)
+    {
+        _connMode = (int8_t) mode;
+    }
+    return (ret > 0);
 }
 
 // Connect to Access Point
-bool ESP8266::joinAP(char *ssid, char *ssid_pass)
+bool ESP8266::joinAP(char *ssid, char *ssid_pass, const char *bssid)
 {
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
     bool conn = false;
+    uint32_t ulStartTime = millis();
 
     if (NULL != ssid)
     {
-        print(AT_CMD);
-        print(AT_CWJAP);
-        print("=\"");
-        print(ssid);
-        print("\"");
-        if (NULL != ssid_pass)
+        do
         {
-            print(",\"");
-            print(ssid_pass);
+            beginCommand(AT_CWJAP);
+            print("=\"");
+            print(ssid);
             print("\"");
-        }
-        print("\r\n");
+            if ((NULL != ssid_pass) || (NULL != bssid))
+            {
+                print(",\"");
+                if (NULL != ssid_pass)
+                {
+                    print(ssid_pass);
+                }
+                print("\"");
+            }
+            if (NULL != bssid)
+            {
+                /* Join this AP only, even if others share the SSID */
+                print(",\"");
+                print(bssid);
+                print("\"");
+            }
+            print("\r\n");
+
+            ret = getResponse(NULL, 0, "WIFI CONNECTED", NULL, '\0', '\0', 10000);
+            if (ret > 0)
+            {
+                ret = getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 5000);
+            }
+        } while (retry(ret, &attempt));
+        conn = (ret > 0);
 
-        conn = (getResponse(NULL, "WIFI CONNECTED", NULL, NULL, NULL, 10000) > 0);
         if (conn)
         {
-            conn = (getResponse(NULL, AT_RESPONSE_OK, NULL, NULL, NULL, 5000) > 0);
+            _apSsid = ssid;
+            _apPass = ssid_pass;
+            _metrics.joinTime = millis() - ulStartTime;
         }
-
-        if (!conn)
+        else
         {
             quitAP();
         }
@@ -161,30 +268,141 @@ bool ESP8266::joinAP(char *ssid, char *ssid_pass)
     return conn;
 }
 
+bool ESP8266::scanAP(const char *ssid, esp8266_ap_t *best)
+{
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    bool found = false;
+
+    if ((NULL == ssid) || (ESP8266_MAX_SSID_LEN < strlen(ssid)))
+    {
+        return false;
+    }
+
+    /* Sort by RSSI, report RSSI, MAC and channel only */
+    do
+    {
+        sendCommand(AT_CWLAPOPT, ESP8266_CMD_SETUP, (char *) "1,28");
+        ret = getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 1000);
+    } while (retry(ret, &attempt));
+
+    if (ret > 0)
+    {
+        attempt = 0;
+        do
+        {
+            beginCommand(AT_CWLAP);
+            print("=\"");
+            print(ssid);
+            print("\"\r\n");
+            /* "OK" without entries means SSID not found */
+            ret = getResponse(NULL, 0, AT_CWLAP_RX, AT_RESPONSE_OK, '\0', '\0', 5000);
+        } while (retry(ret, &attempt));
+
+        /* First entry is the strongest one */
+        if ((ret > 0) && parseAP(_rxBuffer, &_scan))
+        {
+            _scan.scanTime = millis();
+            strcpy(_scanSsid, ssid);
+            found = true;
+            if (NULL != best)
+            {
+                memcpy((void *) best, (void *) &_scan, sizeof(_scan));
+            }
+        }
+
+        /* Rest of the list up to "OK", even if the first entry couldn't be parsed */
+        if (ret > 0)
+        {
+            (void) getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 1000);
+        }
+
+        /* Default order and fields */
+        sendCommand(AT_CWLAPOPT, ESP8266_CMD_SETUP, (char *) "0,127");
+        (void) getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 1000);
+    }
+
+    return found;
+}
+
+bool ESP8266::joinBestAP(char *ssid, char *ssid_pass, uint32_t maxAge)
+{
+    bool ret = false;
+    bool cached = false;
+
+    if (NULL == ssid)
+    {
+        return false;
+    }
+
+    cached = ('\0' != _scanSsid[0]) && (0 == strcmp(_scanSsid, ssid)) && ((millis() - _scan.scanTime) < maxAge);
+    if (cached || scanAP(ssid, NULL))
+    {
+        ret = joinAP(ssid, ssid_pass, _scan.bssid);
+        if (!ret && cached && scanAP(ssid, NULL))
+        {
+            /* AP may have moved or gone, try again with a fresh scan */
+            ret = joinAP(ssid, ssid_pass, _scan.bssid);
+        }
+    }
+    else
+    {
+        /* Nothing found by scan, let the module look for the SSID */
+        ret = joinAP(ssid, ssid_pass);
+    }
+
+    if (!ret)
+    {
+        _scanSsid[0] = '\0';
+    }
+
+    return ret;
+}
+
 // Disconnect from Access Point
 bool ESP8266::quitAP(void)
 {
     bool ret = false;
-    sendCommand(AT_CWQAP, ESP8266_CMD_EXECUTE, NULL);
-    ret = (getResponse(NULL, AT_RESPONSE_OK, NULL, NULL, NULL, 3000) > 0);
+    int8_t conn = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    do
+    {
+        sendCommand(AT_CWQAP, ESP8266_CMD_EXECUTE, NULL);
+        conn = getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 3000);
+    } while (retry(conn, &attempt));
+    ret = (conn > 0);
     if (ret)
     {
-        (void) getResponse(NULL, "WIFI DISCONNECT", NULL, NULL, NULL, 1000);
+        (void) getResponse(NULL, 0, "WIFI DISCONNECT", NULL, '\0', '\0', 1000);
     }
+    _apSsid = NULL;
+    _apPass = NULL;
     return ret;
 }
 
-bool ESP8266::version(char *dest)
+bool ESP8266::version(char *dest, size_t len)
 {
-    sendCommand(AT_GMR, ESP8266_CMD_EXECUTE, NULL);
-    return (getResponse(dest, "AT version", NULL, ':', '(', 1000) > 0);
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    do
+    {
+        sendCommand(AT_GMR, ESP8266_CMD_EXECUTE, NULL);
+        ret = getResponse(dest, len, "AT version", NULL, ':', '(', 1000);
+    } while (retry(ret, &attempt));
+    return (ret > 0);
 }
 
 char* ESP8266::requestAPList(void)
 {
     char* ssidName = NULL;
-    sendCommand(AT_CWLAP, ESP8266_CMD_EXECUTE, NULL);
-    if (getResponse(_ssidBuffer, AT_CWLAP_RX, NULL, '"', '"', 5000) > 0)
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    do
+    {
+        sendCommand(AT_CWLAP, ESP8266_CMD_EXECUTE, NULL);
+        ret = getResponse(_ssidBuffer, sizeof(_ssidBuffer), AT_CWLAP_RX, NULL, '"', '"', 5000);
+    } while (retry(ret, &attempt));
+    if (ret > 0)
     {
         ssidName = (char*) &_ssidBuffer;
     }
@@ -194,53 +412,148 @@ char* ESP8266::requestAPList(void)
 char* ESP8266::getNextAP(void)
 {
     char* ssidNext = NULL;
-    if (getResponse(_ssidBuffer, AT_CWLAP_RX, NULL, '"', '"', 1000) > 0)
+    if (getResponse(_ssidBuffer, sizeof(_ssidBuffer), AT_CWLAP_RX, NULL, '"', '"', 1000) > 0)
     {
         ssidNext = (char*) &_ssidBuffer;
     }
     return ssidNext;
 }
 
-bool ESP8266::ping(char *address)
+bool ESP8266::ping(char *address, uint32_t *rtt)
 {
-    print(AT_CMD);
-    print(AT_PING);
-    print("=\"");
-    print(address);
-    print("\"\r\n");
-    return (getResponse(NULL, AT_RESPONSE_OK, NULL, NULL, NULL, 5000) > 0);
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint32_t ulStartTime = millis();
+
+    if (pingStart(address))
+    {
+        while (ESP8266_CMD_RSP_WAIT == ret)
+        {
+            ret = pingResult(rtt);
+            if ((ESP8266_CMD_RSP_WAIT == ret) && (ESP8266_PING_TIMEOUT <= (millis() - ulStartTime)))
+            {
+                _metrics.timeouts++;
+                ret = ESP8266_CMD_RSP_TIMEOUT;
+                trackResult(ret);
+            }
+        }
+    }
+
+    return (ESP8266_CMD_RSP_SUCCESS == ret);
+}
+
+bool ESP8266::pingStart(char *address)
+{
+    bool ret = false;
+
+    if (NULL != address)
+    {
+        beginCommand(AT_PING);
+        print("=\"");
+        print(address);
+        print("\"\r\n");
+        _rxLineLen = 0;
+        _pingRtt = -1;
+        ret = true;
+    }
+
+    return ret;
+}
+
+int8_t ESP8266::pingResult(uint32_t *rtt)
+{
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    int32_t time = 0;
+    int c = 0;
+
+    /* Lines are assembled across calls, only bytes already received are taken */
+    while ((ESP8266_CMD_RSP_WAIT == ret) && (0 < available()))
+    {
+        c = read();
+        _metrics.bytesReceived++;
+
+        if ('\n' != c)
+        {
+            if (_rxLineLen < (sizeof(_rxBuffer) - 1))
+            {
+                _rxBuffer[_rxLineLen++] = (char) c;
+            }
+            continue;
+        }
+
+        _rxBuffer[_rxLineLen] = '\0';
+        time = parsePing(_rxBuffer);
+        if (0 <= time)
+        {
+            _pingRtt = time;
+        }
+        else
+        {
+            /* Reply time comes before "OK", "+timeout" before "ERROR" */
+            ret = parseLine(_rxBuffer, _rxLineLen, NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0');
+            if ((ESP8266_CMD_RSP_SUCCESS == ret) && (0 > _pingRtt))
+            {
+                ret = ESP8266_CMD_RSP_FAILED;
+            }
+        }
+        _rxLineLen = 0;
+    }
+
+    if (ESP8266_CMD_RSP_SUCCESS == ret)
+    {
+        if (NULL != rtt)
+        {
+            *rtt = (uint32_t) _pingRtt;
+        }
+    }
+    else if (ESP8266_CMD_RSP_BUSY == ret)
+    {
+        _metrics.busy++;
+    }
+    else if (ESP8266_CMD_RSP_WAIT != ret)
+    {
+        _metrics.errors++;
+    }
+    trackResult(ret);
+
+    return ret;
 }
 
 bool ESP8266::startTCP(char *server, int port = 80)
 {
     uint8_t ret = false;
     int8_t conn = 0;
+    uint8_t attempt = 0;
 
     if (NULL != server)
     {
         flush();
-        /* Build command */
-        print(AT_CMD);
-        print(AT_CIPSTART);
-        print("=\"TCP\",\"");
-        print(server);
-        print("\",");
-        print(port);
-        print("\r\n");
+        do
+        {
+            /* Build command */
+            beginCommand(AT_CIPSTART);
+            print("=\"TCP\",\"");
+            print(server);
+            print("\",");
+            print(port);
+            print("\r\n");
 
-        conn = getResponse(NULL, AT_CIPSTART_RX, AT_CIPSTART_ALRDY, NULL, NULL, 3000);
+            conn = getResponse(NULL, 0, AT_CIPSTART_RX, AT_CIPSTART_ALRDY, '\0', '\0', 3000);
+        } while ((ESP8266_CMD_RSP_FAILED != conn) && retry(conn, &attempt)); /* "ALREADY CONNECT" is not a failure */
 
         /* If connected or already connected */
         if ((ESP8266_CMD_RSP_FAILED == conn) || (ESP8266_CMD_RSP_SUCCESS == conn))
         {
-            conn = getResponse(NULL, AT_RESPONSE_OK, NULL, NULL, NULL, 1000);
+            conn = getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 1000);
             if (ESP8266_CMD_RSP_SUCCESS == conn)
             {
                 ret = true;
+                _linkOpen = true;
+                _tcpServer = server;
+                _tcpPort = port;
             }
         }
 
-        if(!ret)
+        if (!ret && (ESP8266_CMD_RSP_BUSY != _lastResult))
         {
             /* Unknown issue, stop TCP connection */
             stopTCP();
@@ -253,27 +566,51 @@ bool ESP8266::startTCP(char *server, int port = 80)
 bool ESP8266::stopTCP(void)
 {
     int8_t conn = false;
-    sendCommand(AT_CIPCLOSE, ESP8266_CMD_EXECUTE, NULL);
-    conn = getResponse(NULL, AT_RESPONSE_OK, AT_RESPONSE_ERROR, NULL, NULL, 1000);
+    uint8_t attempt = 0;
+    do
+    {
+        sendCommand(AT_CIPCLOSE, ESP8266_CMD_EXECUTE, NULL);
+        conn = getResponse(NULL, 0, AT_RESPONSE_OK, AT_RESPONSE_ERROR, '\0', '\0', 1000);
+    } while ((ESP8266_CMD_RSP_FAILED != conn) && retry(conn, &attempt)); /* "ERROR" means already closed */
+    _linkOpen = false;
+    _tcpServer = NULL;
     return ((conn == ESP8266_CMD_RSP_FAILED) || (conn > 0));
 }
 
-bool ESP8266::localIP(char *ip)
+bool ESP8266::localIP(char *ip, size_t len)
 {
-    sendCommand(AT_CIFSR, ESP8266_CMD_EXECUTE, NULL);
-    return (getResponse(ip, AT_CIFSR_STATIP, NULL, '"', '"', 1000) > 0);
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    do
+    {
+        sendCommand(AT_CIFSR, ESP8266_CMD_EXECUTE, NULL);
+        ret = getResponse(ip, len, AT_CIFSR_STATIP, NULL, '"', '"', 1000);
+    } while (retry(ret, &attempt));
+    return (ret > 0);
 }
 
-bool ESP8266::getMACaddress(char* macAddr)
+bool ESP8266::getMACaddress(char* macAddr, size_t len)
 {
-    sendCommand(AT_CIPSTAMAC, ESP8266_CMD_QUERY, NULL);
-    return (getResponse(macAddr, AT_CIPSTAMAC_CURR, NULL, '"', '"', 1000) > 0);
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    do
+    {
+        sendCommand(AT_CIPSTAMAC, ESP8266_CMD_QUERY, NULL);
+        ret = getResponse(macAddr, len, AT_CIPSTAMAC_CURR, NULL, '"', '"', 1000);
+    } while (retry(ret, &attempt));
+    return (ret > 0);
 }
 
-bool ESP8266::localMAC(char *mac)
+bool ESP8266::localMAC(char *mac, size_t len)
 {
-    sendCommand(AT_CIFSR, ESP8266_CMD_EXECUTE, NULL);
-    return (getResponse(mac, AT_CIFSR_STAMAC, NULL, '"', '"', 1000) > 0);
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    do
+    {
+        sendCommand(AT_CIFSR, ESP8266_CMD_EXECUTE, NULL);
+        ret = getResponse(mac, len, AT_CIFSR_STAMAC, NULL, '"', '"', 1000);
+    } while (retry(ret, &attempt));
+    return (ret > 0);
 }
 
 bool ESP8266::send(String data)
@@ -281,28 +618,125 @@ bool ESP8266::send(String data)
     uint8_t ret = false;
     data += "\r\n\r\n";
 
-    if (startSendTCP(data.length()))
+    if (startSend(data.length()))
     {
         print(data);
         ret = endSendTCP();
     }
-    else
+
+    return ret;
+}
+
+bool ESP8266::send(const uint8_t *data, uint32_t len)
+{
+    bool ret = false;
+
+    if ((NULL != data) && (0 < len))
     {
-        stopTCP();
+        if (startSend(len))
+        {
+            write(data, len);
+            ret = endSendTCP();
+        }
     }
 
     return ret;
 }
 
-bool ESP8266::startSendTCP(int len)
+bool ESP8266::send(const esp8266_segment_t *segments, uint8_t count)
 {
-    ESP8266_DBG_PARSE(F("CMD: "), AT_CIPSEND);
+    bool ret = false;
+    uint32_t len = segmentsLength(segments, count);
+    uint8_t chunk[16];
+    uint32_t sent = 0;
+    uint32_t i = 0;
 
-    print(AT_CMD);
-    print(AT_CIPSEND);
-    print("=");
-    println(len);
-    return (getResponse(NULL, ">", NULL, NULL, NULL, 1000) > 0);
+    if ((0 < len) && (ESP8266_MAX_SEND_LEN >= len))
+    {
+        if (startSend(len))
+        {
+            for (uint8_t seg = 0; seg < count; seg++)
+            {
+                switch (segments[seg].type)
+                {
+                    case ESP8266_SEGMENT_RAM:
+                        write((const uint8_t *) segments[seg].data, segments[seg].len);
+                        break;
+                    case ESP8266_SEGMENT_FLASH:
+                        /* Flash can't be written directly, copy it in small chunks */
+                        for (sent = 0; sent < segments[seg].len; sent += i)
+                        {
+                            for (i = 0; (i < sizeof(chunk)) && ((sent + i) < segments[seg].len); i++)
+                            {
+                                chunk[i] = pgm_read_byte((const uint8_t *) segments[seg].data + sent + i);
+                            }
+                            write(chunk, i);
+                        }
+                        break;
+                    default:
+                        print((long) segments[seg].value);
+                        break;
+                }
+            }
+            ret = endSendTCP();
+        }
+    }
+
+    return ret;
+}
+
+uint32_t ESP8266::segmentsLength(const esp8266_segment_t *segments, uint8_t count)
+{
+    uint32_t len = 0;
+    uint32_t value = 0;
+
+    if (NULL == segments)
+    {
+        return 0;
+    }
+
+    for (uint8_t seg = 0; seg < count; seg++)
+    {
+        switch (segments[seg].type)
+        {
+            case ESP8266_SEGMENT_RAM:
+            case ESP8266_SEGMENT_FLASH:
+                if ((NULL == segments[seg].data) && (0 < segments[seg].len))
+                {
+                    return 0;
+                }
+                len += segments[seg].len;
+                break;
+            case ESP8266_SEGMENT_INT:
+                /* Digits plus sign, same as print() */
+                value = (0 > segments[seg].value) ? (0 - (uint32_t) segments[seg].value) : (uint32_t) segments[seg].value;
+                len += (0 > segments[seg].value) ? 2 : 1;
+                while (9 < value)
+                {
+                    value /= 10;
+                    len++;
+                }
+                break;
+            default:
+                return 0;
+        }
+    }
+
+    return len;
+}
+
+bool ESP8266::startSendTCP(int len)
+{
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    do
+    {
+        beginCommand(AT_CIPSEND);
+        print("=");
+        println(len);
+        ret = getResponse(NULL, 0, ">", NULL, '\0', '\0', 1000);
+    } while (retry(ret, &attempt));
+    return (ret > 0);
 }
 
 bool ESP8266::endSendTCP(void)
@@ -311,13 +745,13 @@ bool ESP8266::endSendTCP(void)
     int8_t conn = ESP8266_CMD_RSP_WAIT;
 
     /* Dummy check of the Recv XX bytes message */
-    conn = getResponse(NULL, "Recv ", NULL, NULL, NULL, 5000);
+    conn = getResponse(NULL, 0, "Recv ", NULL, '\0', '\0', 5000);
     if (ESP8266_CMD_RSP_SUCCESS == conn)
     {
         ret = true;
     }
 
-    conn = getResponse(NULL, AT_CIPSEND_OK, NULL, NULL, NULL, 5000);
+    conn = getResponse(NULL, 0, AT_CIPSEND_OK, NULL, '\0', '\0', 5000);
 
     if (ESP8266_CMD_RSP_SUCCESS == conn)
     {
@@ -336,7 +770,7 @@ int ESP8266::httpStatus(void)
     char *ucpEnd = NULL;
     String incoming;
 
-    uint16_t ret = (uint16_t) getResponse(buff, AT_IPD, NULL, ' ', ' ', 5000);
+    uint16_t ret = (uint16_t) getResponse(buff, sizeof(buff), AT_IPD, NULL, ' ', ' ', 5000);
     if (0 < ret)
     {
 
@@ -345,6 +779,77 @@ int ESP8266::httpStatus(void)
     return status;
 }
 
+bool ESP8266::receiveMode(bool passive)
+{
+    bool ret = false;
+    int8_t conn = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    char modeStr[2];
+    itoa(passive ? 1 : 0, modeStr, 10);
+    do
+    {
+        sendCommand(AT_CIPRECVMODE, ESP8266_CMD_SETUP, modeStr);
+        conn = getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 1000);
+    } while (retry(conn, &attempt));
+    ret = (conn > 0);
+    if (ret)
+    {
+        _passiveRecv = passive;
+        _recvPending = 0;
+    }
+    return ret;
+}
+
+int32_t ESP8266::receiveLength(void)
+{
+    int32_t len = -1;
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+    uint8_t attempt = 0;
+    do
+    {
+        sendCommand(AT_CIPRECVLEN, ESP8266_CMD_QUERY, NULL);
+        ret = getResponse(NULL, 0, AT_CIPRECVLEN_RX, NULL, '\0', '\0', 1000);
+    } while (retry(ret, &attempt));
+    if (ret > 0)
+    {
+        /* Length for link 0 (single connection) follows the prefix */
+        len = atol(&_rxBuffer[strlen(AT_CIPRECVLEN_RX)]);
+        if (getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 1000) > 0)
+        {
+            _recvPending = (uint32_t) len;
+        }
+        else
+        {
+            len = -1;
+        }
+    }
+    return len;
+}
+
+uint32_t ESP8266::receivePending(void)
+{
+    return _recvPending;
+}
+
+int32_t ESP8266::receive(uint8_t *buffer, uint32_t bufferSize, uint32_t timeout)
+{
+    int32_t count = -1;
+
+    if ((NULL != buffer) && (0 < bufferSize))
+    {
+        if (_passiveRecv)
+        {
+            count = receivePassive(buffer, bufferSize, timeout);
+        }
+        else
+        {
+            count = receiveActive(buffer, bufferSize, timeout);
+        }
+    }
+
+    return count;
+}
+
 int ESP8266::httpGetBodyLine(char *stringToLookFor, char *buffer, uint32_t bufferSize, uint32_t timeout)
 {
     bool found = false;
@@ -418,24 +923,285 @@ int ESP8266::httpGetBodyLine(char *stringToLookFor, char *buffer, uint32_t buffe
     return sizeOfline;
 }
 
-#if 0
-uint16_t ESP8266::httpReceive(httpResponse* response)
+bool ESP8266::httpDownload(char *server, int port, const char *path, Print &sink,
+                           esp8266_download_t *state, uint32_t timeout)
 {
-    uint16_t rxLength = 0;
-    int16_t remaining = 0;
+    bool ret = false;
+    bool requestSent = false;
+    bool inBody = false;
+    bool chunked = false;
+    bool unsupported = false;
+    uint8_t chunkState = HTTP_CHUNK_SIZE;
+    uint32_t chunkLeft = 0;
+    char line[ESP8266_RX_BUFF_LEN];
+    uint8_t lineLen = 0;
+    uint8_t chunk[ESP8266_DOWNLOAD_CHUNK_LEN];
+    char offsetStr[11];
+    int32_t count = 0;
+    int32_t idx = 0;
+    int32_t pos = 0;
+    int32_t out = 0;
+    uint32_t offset = 0;
+    uint32_t skip = 0;
+    uint32_t expected = 0;
+    uint32_t received = 0;
+    uint32_t ulStartTime = millis();
+    uint32_t ulLastData = ulStartTime;
+    uint32_t len = 0;
+
+    if ((NULL == server) || (NULL == path) || (NULL == state))
+    {
+        return false;
+    }
 
-    char *ucpStart = NULL;
-    char *ucpEnd = NULL;
+    /* Resume from last delivered byte */
+    offset = state->bytes;
+    state->status = -1;
+    ultoa(offset, offsetStr, 10);
 
-    uint16_t count = (uint16_t) getResponse(response->content, AT_IPD, NULL, ',', '\r', 1000);
-    if (0 < count)
+    if (!startTCP(server, port))
     {
-        /* Get response length */
-        ucpEnd = (char *) memchr(response->content, ':', count - (ucpStart - response->content));
-        if (NULL != ucpEnd)
-        {
-            if ((ucpEnd - response->content) > 1)
-            {
+        return false;
+    }
+
+    /* Request length must be known before AT+CIPSEND */
+    len = strlen("GET ") + strlen(path) + strlen(" HTTP/1.1\r\nHost: ") + strlen(server) +
+          strlen("\r\nConnection: close\r\n") + strlen("\r\n");
+    if (0 < offset)
+    {
+        len += strlen("Range: bytes=") + strlen(offsetStr) + strlen("-\r\n");
+    }
+
+    if (startSend(len))
+    {
+        print("GET ");
+        print(path);
+        print(" HTTP/1.1\r\nHost: ");
+        print(server);
+        print("\r\nConnection: close\r\n");
+        if (0 < offset)
+        {
+            print("Range: bytes=");
+            print(offsetStr);
+            print("-\r\n");
+        }
+        print("\r\n");
+        requestSent = endSendTCP();
+    }
+
+    /* Receive until whole body is delivered, connection is closed or no data arrives */
+    while (requestSent && (timeout > (millis() - ulLastData)) && !ret)
+    {
+        count = receive(chunk, sizeof(chunk), 100);
+        if (0 >= count)
+        {
+            if (!_linkOpen)
+            {
+                break;
+            }
+            continue;
+        }
+        ulLastData = millis();
+
+        for (idx = 0; (idx < count) && !inBody; idx++)
+        {
+            /* Parse headers line by line, long lines are truncated */
+            if ('\n' == chunk[idx])
+            {
+                if ((0 < lineLen) && ('\r' == line[lineLen - 1]))
+                {
+                    lineLen--;
+                }
+                line[lineLen] = '\0';
+
+                if (0 == lineLen)
+                {
+                    /* Empty line, body starts on next byte */
+                    inBody = true;
+                    if ((206 != state->status) && (0 < offset))
+                    {
+                        /* Server ignored Range, skip what was already delivered */
+                        skip = offset;
+                    }
+                }
+                else if ((-1 == state->status) && (0 == strncmp(line, "HTTP/1.", 7)) && (NULL != strchr(line, ' ')))
+                {
+                    state->status = atoi(strchr(line, ' ') + 1);
+                }
+                else if (0 == strncasecmp(line, "Content-Length:", 15))
+                {
+                    expected = (uint32_t) atol(&line[15]);
+                }
+                else if (0 == strncasecmp(line, "Transfer-Encoding:", 18))
+                {
+                    /* Only "chunked" alone can be decoded, compressed bodies can't */
+                    for (pos = 18; ' ' == line[pos]; pos++)
+                    {
+                    }
+                    chunked = (0 == strcasecmp(&line[pos], "chunked"));
+                    unsupported = !chunked;
+                }
+                lineLen = 0;
+            }
+            else if (lineLen < (sizeof(line) - 1))
+            {
+                line[lineLen++] = (char) chunk[idx];
+            }
+        }
+
+        if (inBody && (((200 != state->status) && (206 != state->status)) || unsupported))
+        {
+            /* Error body is not delivered to sink */
+            break;
+        }
+
+        if (inBody && chunked)
+        {
+            /* Drop chunk sizes and line ends, payload is moved down within chunk */
+            for (pos = idx, out = idx; pos < count; pos++)
+            {
+                switch (chunkState)
+                {
+                    case HTTP_CHUNK_SIZE:
+                        /* Hex size, strtoul() stops on extensions and line end */
+                        if ('\n' == chunk[pos])
+                        {
+                            line[lineLen] = '\0';
+                            chunkLeft = strtoul(line, NULL, 16);
+                            chunkState = (0 < chunkLeft) ? HTTP_CHUNK_DATA : HTTP_CHUNK_TRAILER;
+                            lineLen = 0;
+                        }
+                        else if (lineLen < (sizeof(line) - 1))
+                        {
+                            line[lineLen++] = (char) chunk[pos];
+                        }
+                        break;
+                    case HTTP_CHUNK_DATA:
+                        chunk[out++] = chunk[pos];
+                        chunkLeft--;
+                        if (0 == chunkLeft)
+                        {
+                            chunkState = HTTP_CHUNK_DATA_END;
+                        }
+                        break;
+                    case HTTP_CHUNK_DATA_END:
+                        if ('\n' == chunk[pos])
+                        {
+                            chunkState = HTTP_CHUNK_SIZE;
+                        }
+                        break;
+                    case HTTP_CHUNK_TRAILER:
+                        /* Trailer fields end with an empty line */
+                        if ('\n' == chunk[pos])
+                        {
+                            chunkState = (0 == lineLen) ? HTTP_CHUNK_DONE : HTTP_CHUNK_TRAILER;
+                            lineLen = 0;
+                        }
+                        else if (('\r' != chunk[pos]) && (255 > lineLen))
+                        {
+                            lineLen++;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+            count = out;
+        }
+
+        if (inBody && (idx < count))
+        {
+            if (0 < skip)
+            {
+                len = ((uint32_t) (count - idx) < skip) ? (uint32_t) (count - idx) : skip;
+                idx += len;
+                skip -= len;
+                received += len;
+            }
+
+            if (idx < count)
+            {
+                len = sink.write(&chunk[idx], count - idx);
+                state->crc32 = crc32(state->crc32, &chunk[idx], len);
+                state->bytes += len;
+                received += len;
+                if (len < (uint32_t) (count - idx))
+                {
+                    /* Sink is full, abort */
+                    break;
+                }
+            }
+        }
+
+        if (inBody && chunked)
+        {
+            /* Chunked body ends with a zero length chunk, Content-Length doesn't apply */
+            ret = (HTTP_CHUNK_DONE == chunkState);
+        }
+        else if (inBody && (0 < expected) && (received >= expected))
+        {
+            ret = ((200 == state->status) || (206 == state->status));
+        }
+    }
+
+    /* Without Content-Length body ends when server closes the connection */
+    if (inBody && !chunked && !unsupported && (0 == expected) && !_linkOpen &&
+        ((200 == state->status) || (206 == state->status)))
+    {
+        ret = true;
+    }
+
+    if (_linkOpen)
+    {
+        stopTCP();
+    }
+
+    /* Keep total length when resuming with a range */
+    if ((0 < expected) && !chunked)
+    {
+        state->contentLength = (206 == state->status) ? (offset + expected) : expected;
+    }
+    state->elapsed = millis() - ulStartTime;
+    state->bytesPerSecond = (0 < state->elapsed) ? (uint32_t) (((uint64_t) received * 1000) / state->elapsed) : 0;
+
+    return ret;
+}
+
+uint32_t ESP8266::crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    uint8_t bit = 0;
+
+    /* Bitwise implementation, no table to save RAM */
+    crc = ~crc;
+    while (0 < len--)
+    {
+        crc ^= *data++;
+        for (bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+#if 0
+uint16_t ESP8266::httpReceive(httpResponse* response)
+{
+    uint16_t rxLength = 0;
+    int16_t remaining = 0;
+
+    char *ucpStart = NULL;
+    char *ucpEnd = NULL;
+
+    uint16_t count = (uint16_t) getResponse(response->content, ESP8266_RX_BUFF_LEN, AT_IPD, NULL, ',', '\r', 1000);
+    if (0 < count)
+    {
+        /* Get response length */
+        ucpEnd = (char *) memchr(response->content, ':', count - (ucpStart - response->content));
+        if (NULL != ucpEnd)
+        {
+            if ((ucpEnd - response->content) > 1)
+            {
                 *ucpEnd = '\0';
                 rxLength = (uint16_t) atoi(response->content);
             }
@@ -469,11 +1235,11 @@ uint16_t ESP8266::httpReceive(httpResponse* response)
         {
             if (remaining < ESP8266_RX_BUFF_LEN)
             {
-                count = (uint16_t) _serialPortHandler->readBytesUntil('\n', response->content, remaining);
+                count = (uint16_t) _rx->readBytesUntil('\n', response->content, remaining);
             }
             else
             {
-                count = (uint16_t) _serialPortHandler->readBytesUntil('\n', response->content, ESP8266_RX_BUFF_LEN);
+                count = (uint16_t) _rx->readBytesUntil('\n', response->content, ESP8266_RX_BUFF_LEN);
             }
 
             if (0 < count)
@@ -527,125 +1293,506 @@ uint16_t ESP8266::httpReceive(httpResponse* response)
 }
 #endif
 
-size_t ESP8266::write(uint8_t character)
+bool ESP8266::connected(void)
 {
-    if (_serialPortHandler.isSoftSerial)
+    return _linkOpen;
+}
+
+int8_t ESP8266::lastResult(void)
+{
+    return _lastResult;
+}
+
+void ESP8266::setRetryPolicy(const esp8266_retry_policy_t *policy)
+{
+    if (NULL != policy)
     {
-        if (NULL != _serialPortHandler._soft)
+        memcpy((void *) &_retryPolicy, (const void *) policy, sizeof(_retryPolicy));
+        if (0 == _retryPolicy.attempts)
         {
-            _serialPortHandler._soft->write(character);
+            _retryPolicy.attempts = 1;
         }
     }
-    else
+}
+
+void ESP8266::retryPolicy(esp8266_retry_policy_t *dest)
+{
+    if (NULL != dest)
     {
-        if (NULL != _serialPortHandler._hard)
-        {
-            _serialPortHandler._hard->write(character);
-        }
+        memcpy((void *) dest, (const void *) &_retryPolicy, sizeof(_retryPolicy));
     }
 }
 
-int ESP8266::read()
+void ESP8266::setRecoveryThreshold(uint8_t threshold)
 {
-    if (_serialPortHandler.isSoftSerial)
+    _recoveryThreshold = threshold;
+}
+
+bool ESP8266::maintain(void)
+{
+    bool ret = true;
+    if ((0 < _recoveryThreshold) && (_recoveryThreshold <= _failStreak))
     {
-        if (NULL != _serialPortHandler._soft)
-        {
-            return _serialPortHandler._soft->read();
-        }
+        ret = recover();
+    }
+    return ret;
+}
+
+bool ESP8266::recover(void)
+{
+    bool ret = false;
+    bool linkWasOpen = _linkOpen;
+    uint32_t since = (0 < _failStreak) ? _failSince : millis();
+
+    /* 1. Leave data mode, "+++" must be surrounded by silence */
+    flush();
+    delay(20);
+    print("+++");
+    flush();
+    delay(1000);
+    while (0 < available())
+    {
+        (void) read();
+    }
+    /* First "AT" may be merged with garbage left on the module */
+    ret = test() || test();
+
+    /* 2. Software reset */
+    if (!ret)
+    {
+        ret = reset() && restore(linkWasOpen);
+    }
+
+    /* 3. Hardware reset */
+    if (!ret && (0 <= _resetPin))
+    {
+        ret = hardReset() && restore(linkWasOpen);
+    }
+
+    /* 4. Power cycle */
+    if (!ret && (0 <= _enablePin))
+    {
+        digitalWrite(_enablePin, LOW);
+        delay(1000);
+        digitalWrite(_enablePin, HIGH);
+        _linkOpen = false;
+        _metrics.resets++;
+        ret = (getResponse(NULL, 0, AT_RESPONSE_RST, NULL, '\0', '\0', 3000) > 0) && restore(linkWasOpen);
+    }
+
+    if (ret)
+    {
+        _failStreak = 0;
+        _metrics.recoveries++;
+        _metrics.downtime += millis() - since;
     }
     else
     {
-        if (NULL != _serialPortHandler._hard)
+        _metrics.recoveryFailures++;
+    }
+
+    return ret;
+}
+
+void ESP8266::metrics(esp8266_metrics_t *dest)
+{
+    if (NULL != dest)
+    {
+        memcpy((void *) dest, (void *) &_metrics, sizeof(_metrics));
+        if (0 < _metrics.recoveries)
         {
-            return _serialPortHandler._hard->read();
+            dest->meanTimeToRecovery = _metrics.downtime / _metrics.recoveries;
         }
     }
 }
 
+void ESP8266::clearMetrics(void)
+{
+    memset((void *) &_metrics, 0, sizeof(_metrics));
+}
+
+size_t ESP8266::write(uint8_t character)
+{
+    _metrics.bytesSent++;
+    return _serial->write(character);
+}
+
+int ESP8266::read()
+{
+    return _rx->read();
+}
+
 int ESP8266::peek()
 {
-    if (_serialPortHandler.isSoftSerial)
+    return _rx->peek();
+}
+
+void ESP8266::flush()
+{
+    _serial->flush();
+}
+
+int ESP8266::available()
+{
+    return _rx->available();
+}
+
+/* Private functions */
+
+void ESP8266::sendCommand(const char *cmd, at_cmd_type type, char *params)
+{
+    beginCommand(cmd);
+    if (ESP8266_CMD_QUERY == type)
+    {
+        print('?');
+    }
+    else if ((ESP8266_CMD_SETUP == type) && (NULL != params))
+    {
+        ESP8266_DBG_PARSE(F("PRM: "), params);
+        print('=');
+        print(params);
+    }
+    print("\r\n");
+}
+
+void ESP8266::trackResult(int8_t rsp)
+{
+    if (ESP8266_CMD_RSP_WAIT != rsp)
     {
-        if (NULL != _serialPortHandler._soft)
+        _lastResult = (0 < rsp) ? (int8_t) ESP8266_CMD_RSP_SUCCESS : rsp;
+    }
+
+    if ((ESP8266_CMD_RSP_TIMEOUT == rsp) || (ESP8266_CMD_RSP_BUSY == rsp))
+    {
+        if (0 == _failStreak)
+        {
+            _failSince = millis();
+        }
+        if (255 > _failStreak)
         {
-            return _serialPortHandler._soft->peek();
+            _failStreak++;
         }
     }
-    else
+    else if (ESP8266_CMD_RSP_WAIT != rsp)
     {
-        if (NULL != _serialPortHandler._hard)
+        /* Module answered, even an error means it is alive */
+        _failStreak = 0;
+    }
+}
+
+bool ESP8266::retry(int8_t rsp, uint8_t *attempt)
+{
+    bool ret = false;
+    uint32_t wait = _retryPolicy.backoff;
+
+    (*attempt)++;
+    if ((0 > rsp) && (*attempt < _retryPolicy.attempts) && (0 != (_retryPolicy.retryOn & (1 << (-rsp - 1)))))
+    {
+        /* Exponential backoff, doubled on each retry up to maxBackoff */
+        for (uint8_t i = 1; (i < *attempt) && (wait < _retryPolicy.maxBackoff); i++)
+        {
+            wait <<= 1;
+        }
+        if (wait > _retryPolicy.maxBackoff)
         {
-            return _serialPortHandler._hard->peek();
+            wait = _retryPolicy.maxBackoff;
         }
+        /* Jitter keeps modules sharing a channel from retrying in lockstep */
+        wait += random(((wait * _retryPolicy.jitter) / 100) + 1);
+
+        ESP8266_DBG_PARSE(F("RETRY: "), wait);
+        delay(wait);
+        _metrics.retries++;
+        ret = true;
     }
+
+    return ret;
 }
 
-void ESP8266::flush()
+bool ESP8266::restore(bool linkWasOpen)
+{
+    bool ret = false;
+    char *ssid = _apSsid;
+    char *pass = _apPass;
+    char *server = _tcpServer;
+    int port = _tcpPort;
+
+    ret = test();
+    /* Echo is back on after a reset */
+    if (ret && (0 <= _echo))
+    {
+        ret = echo(1 == _echo);
+    }
+    if (ret && (0 < _wifiMode))
+    {
+        ret = operationMode(_wifiMode);
+    }
+    if (ret && (0 <= _connMode))
+    {
+        ret = connectionMode(_connMode);
+    }
+    if (ret && _passiveRecv)
+    {
+        ret = receiveMode(true);
+    }
+    if (ret && (NULL != ssid))
+    {
+        ret = joinAP(ssid, pass);
+    }
+    if (ret && linkWasOpen && (NULL != server))
+    {
+        ret = startTCP(server, port);
+    }
+
+    /* Failed attempts clear settings, keep them for next recovery */
+    _apSsid = ssid;
+    _apPass = pass;
+    _tcpServer = server;
+    _tcpPort = port;
+
+    return ret;
+}
+
+void ESP8266::beginCommand(const char *cmd)
+{
+    ESP8266_DBG_PARSE(F("CMD: "), cmd);
+    _metrics.commands++;
+    print(AT_CMD);
+    print(cmd);
+}
+
+bool ESP8266::startSend(uint32_t len)
 {
-    if (_serialPortHandler.isSoftSerial)
+    bool ret = startSendTCP((int) len);
+
+    /* Connection is kept only when the module stayed busy after retries */
+    if (!ret && (ESP8266_CMD_RSP_BUSY != _lastResult))
     {
-        if (NULL != _serialPortHandler._soft)
+        stopTCP();
+    }
+
+    return ret;
+}
+
+int32_t ESP8266::receivePassive(uint8_t *buffer, uint32_t bufferSize, uint32_t timeout)
+{
+    int32_t count = -1;
+    int32_t len = 0;
+    int32_t discard = 0;
+    uint32_t notified = 0;
+    uint32_t ulStartTime = 0;
+    unsigned long previousTimeout = 0;
+    bool found = false;
+    int c = 0;
+
+    /* Nothing held by the ESP8266, wait for a "+IPD,<len>" notification without sending anything */
+    if (0 == _recvPending)
+    {
+        len = readIPD(millis(), timeout);
+        if (0 >= len)
         {
-            _serialPortHandler._soft->flush();
+            return 0;
         }
+        _recvPending = (uint32_t) len;
     }
-    else
+
+    /* Take notifications already received, a "CLOSED" among them leaves nothing to request */
+    while (_linkOpen && (0 < available()))
     {
-        if (NULL != _serialPortHandler._hard)
+        len = readIPD(millis(), 0);
+        if (0 >= len)
         {
-            _serialPortHandler._hard->flush();
+            break;
         }
+        _recvPending += (uint32_t) len;
+    }
+    if (!_linkOpen)
+    {
+        _recvPending = 0;
+        return 0;
     }
-}
 
-int ESP8266::available()
-{
-    if (_serialPortHandler.isSoftSerial)
+    /* Never ask for more than it holds, the response would wait for data */
+    if (bufferSize > _recvPending)
     {
-        if (NULL != _serialPortHandler._soft)
+        bufferSize = _recvPending;
+    }
+    if (ESP8266_MAX_RECV_LEN < bufferSize)
+    {
+        bufferSize = ESP8266_MAX_RECV_LEN;
+    }
+
+    beginCommand(AT_CIPRECVDATA);
+    print('=');
+    print(bufferSize);
+    print("\r\n");
+
+    /* Response is "+CIPRECVDATA:<len>,<data>", data is binary so it can't be read by lines.
+     * Data is already held by the ESP8266, so it comes right away whatever the caller's timeout.
+     * Notifications of newer data may come first, they add to what is held. */
+    _ipdHeaderLen = 0;
+    for (ulStartTime = millis(); !found && (1000 > (millis() - ulStartTime));)
+    {
+        c = read();
+        if (0 > c)
+        {
+            continue;
+        }
+        _metrics.bytesReceived++;
+        if ('\n' != c)
+        {
+            if (_ipdHeaderLen < (sizeof(_ipdHeader) - 1))
+            {
+                _ipdHeader[_ipdHeaderLen++] = (char) c;
+            }
+            _ipdHeader[_ipdHeaderLen] = '\0';
+        }
+
+        if ((':' == c) && (0 == strcmp(_ipdHeader, AT_CIPRECVDATA_RX)))
+        {
+            found = true;
+            _ipdHeaderLen = 0;
+        }
+        else if ('\n' == c)
         {
-            return _serialPortHandler._soft->available();
+            len = parseIPD(_ipdHeader, NULL);
+            if (0 < len)
+            {
+                notified += (uint32_t) len;
+            }
+            if (parseClosed(_ipdHeader, NULL))
+            {
+                _linkOpen = false;
+            }
+            _ipdHeaderLen = 0;
         }
     }
-    else
+
+    previousTimeout = _timeout;
+    setTimeout(1000);
+    if (found)
     {
-        if (NULL != _serialPortHandler._hard)
+        len = parseInt();
+        if (0 > len)
         {
-            return _serialPortHandler._hard->available();
+            len = 0;
         }
+        /* Skip ',' separator, parseInt() stops right before it */
+        (void) read();
+
+        count = (int32_t) readBytes(buffer, ((uint32_t) len < bufferSize) ? (uint32_t) len : bufferSize);
+
+        /* More than requested, discard it so the stream stays in sync */
+        for (discard = len - count; (0 < discard) && (0 <= timedRead()); discard--)
+        {
+        }
+        _metrics.bytesReceived += len;
+        _recvPending = ((_recvPending > (uint32_t) len) ? (_recvPending - len) : 0) + notified;
+
+        (void) getResponse(NULL, 0, AT_RESPONSE_OK, NULL, '\0', '\0', 1000);
     }
-}
+    else
+    {
+        _recvPending = notified;
+        _metrics.timeouts++;
+        trackResult(ESP8266_CMD_RSP_TIMEOUT);
+    }
+    setTimeout(previousTimeout);
 
-/* Private functions */
+    return count;
+}
 
-void ESP8266::sendCommand(const char *cmd, at_cmd_type type, char *params)
+int32_t ESP8266::receiveActive(uint8_t *buffer, uint32_t bufferSize, uint32_t timeout)
 {
-    ESP8266_DBG_PARSE(F("CMD: "), cmd);
-    print(AT_CMD);
-    print(cmd);
-    if (ESP8266_CMD_QUERY == type)
+    int32_t count = 0;
+    uint32_t ulStartTime = millis();
+
+    /* Look for next "+IPD,<len>:" header */
+    if (0 == _ipdRemaining)
     {
-        print('?');
+        _ipdRemaining = (uint32_t) readIPD(ulStartTime, timeout);
     }
-    else if ((ESP8266_CMD_SETUP == type) && (NULL != params))
+
+    /* Copy frame payload */
+    while ((0 < _ipdRemaining) && ((uint32_t) count < bufferSize))
     {
-        ESP8266_DBG_PARSE(F("PRM: "), params);
-        print('=');
-        print(params);
+        if (0 >= available())
+        {
+            if (timeout <= (millis() - ulStartTime))
+            {
+                break;
+            }
+            continue;
+        }
+
+        buffer[count++] = (uint8_t) read();
+        _ipdRemaining--;
     }
-    print("\r\n");
+    _metrics.bytesReceived += count;
+
+    return count;
+}
+
+int32_t ESP8266::readIPD(uint32_t ulStartTime, uint32_t timeout)
+{
+    int32_t len = 0;
+    int c = 0;
+
+    while (0 == len)
+    {
+        if (0 >= available())
+        {
+            if (timeout <= (millis() - ulStartTime))
+            {
+                break;
+            }
+            continue;
+        }
+
+        c = read();
+        _metrics.bytesReceived++;
+        if ('\n' != c)
+        {
+            if (_ipdHeaderLen < (sizeof(_ipdHeader) - 1))
+            {
+                _ipdHeader[_ipdHeaderLen++] = (char) c;
+            }
+            _ipdHeader[_ipdHeaderLen] = '\0';
+        }
+
+        /* Active mode frame "+IPD,<len>:", passive mode notification "+IPD,<len>" line */
+        if ((':' == c) && (0 == strncmp(_ipdHeader, AT_IPD_RX, strlen(AT_IPD_RX))))
+        {
+            len = parseIPD(_ipdHeader, NULL);
+            _ipdHeaderLen = 0;
+        }
+        else if ('\n' == c)
+        {
+            len = _passiveRecv ? parseIPD(_ipdHeader, NULL) : 0;
+            /* Any other line between frames only matters if connection was closed */
+            if (parseClosed(_ipdHeader, NULL))
+            {
+                _linkOpen = false;
+            }
+            _ipdHeaderLen = 0;
+        }
+
+        if (0 > len)
+        {
+            len = 0;
+        }
+    }
+
+    return len;
 }
 
-int8_t ESP8266::getResponse(char* dest, const char* pass, const char* fail, char delimA, char delimB, uint32_t timeout)
+int8_t ESP8266::getResponse(char* dest, size_t destLen, const char* pass, const char* fail, char delimA, char delimB, uint32_t timeout)
 {
-    static char _rxBuffer[ESP8266_RX_BUFF_LEN];
     int8_t ret = ESP8266_CMD_RSP_WAIT;
     uint8_t idx = 0;
     uint32_t ulStartTime = 0;
-
-    char *ucpStart = NULL;
-    char *ucpEnd = NULL;
+    int32_t pending = 0;
+    int c = 0;
 
     /* Validate arguments */
     if (NULL == pass)
@@ -667,95 +1814,283 @@ int8_t ESP8266::getResponse(char* dest, const char* pass, const char* fail, char
             if (timeout <= (millis() - ulStartTime))
             {
                 ESP8266_DBG_PARSE(F("TIMEOUT: "), (millis() - ulStartTime));
+                _metrics.timeouts++;
                 ret = ESP8266_CMD_RSP_TIMEOUT;
                 break;
             }
 
-            /* Read line */
-            if (_serialPortHandler.isSoftSerial)
+            /* AT+CIPSEND prompt "> " has no line end, don't wait for one */
+            if ('>' == pass[0])
             {
-                if (NULL != _serialPortHandler._soft)
+                c = _rx->peek();
+                if ('>' == c)
                 {
-                    idx = _serialPortHandler._soft->readBytesUntil('\n', _rxBuffer, sizeof(_rxBuffer));
+                    (void) _rx->read();
+                    _metrics.bytesReceived++;
+                    ret = ESP8266_CMD_RSP_SUCCESS;
+                    break;
                 }
-            }
-            else
-            {
-                if (NULL != _serialPortHandler._hard)
+                else if (0 > c)
                 {
-                    idx = _serialPortHandler._hard->readBytesUntil('\n', _rxBuffer, sizeof(_rxBuffer));
+                    continue;
                 }
             }
 
+            /* Read line, leave room for NULL terminator */
+            idx = _rx->readBytesUntil('\n', _rxBuffer, sizeof(_rxBuffer) - 1);
+
             if (0 < idx)
             {
-                /* Always add NULL terminator */
-                if (idx < ESP8266_RX_BUFF_LEN)
-                {
-                    _rxBuffer[idx] = '\0';
-                }
-                else
-                {
-                    _rxBuffer[ESP8266_RX_BUFF_LEN - 1] = '\0';
-                }
+                _metrics.bytesReceived += idx;
+                _rxBuffer[idx] = '\0';
 
                 ESP8266_DBG_PARSE(F("ACT: "), _rxBuffer);
 
-                /* Check for expected response */
-                if (0 == strncmp(_rxBuffer, pass, strlen(pass)))
+                ret = parseLine(_rxBuffer, idx, dest, destLen, pass, fail, delimA, delimB);
+                switch (ret)
                 {
-                    ESP8266_DBG_PARSE(F("FND: "), _rxBuffer);
-
-                    /* Search for delimeters */
-                    if ((delimA != NULL) && (delimB != NULL))
-                    {
-                        ucpStart = (char *) memchr(_rxBuffer, delimA, idx);
-                        if (NULL != ucpStart)
+                    case ESP8266_CMD_RSP_FAILED:
+                    case ESP8266_CMD_RSP_ERROR:
+                        _metrics.errors++;
+                        break;
+                    case ESP8266_CMD_RSP_BUSY:
+                        _metrics.busy++;
+                        break;
+                    case ESP8266_CMD_RSP_WAIT:
+                        /* Passive mode data notification "+IPD,<len>", one per received piece */
+                        if (_passiveRecv)
                         {
-                            ucpStart++;
-                            ucpEnd = (char *) memchr(ucpStart, delimB, idx - (ucpStart - _rxBuffer));
-                            if (NULL != ucpEnd)
+                            pending = parseIPD(_rxBuffer, NULL);
+                            if (0 <= pending)
                             {
-                                if ((ucpEnd - ucpStart) > 1)
-                                {
-                                    *ucpEnd = '\0';
-                                    ESP8266_DBG_PARSE("INS: ", ucpStart);
-                                    if (NULL != dest)
-                                    {
-                                        strcpy(dest, ucpStart);
-                                    }
-                                    ret = idx;
-                                    if (idx < ESP8266_RX_BUFF_LEN)
-                                    {
-                                        ret++;
-                                    }
-                                }
+                                _recvPending += (uint32_t) pending;
                             }
                         }
-                    }
-                    else
-                    {
-                        /* Expected response found and no need to find instances */
-                        ret = ESP8266_CMD_RSP_SUCCESS;
-                    }
+                        /* Connection closed by remote while waiting for something else */
+                        if (parseClosed(_rxBuffer, NULL))
+                        {
+                            _linkOpen = false;
+                        }
+                        break;
+                    default:
+                        break;
                 }
-                /* Check for failed response */
-                else if ((NULL != fail) && (0 == strncmp(_rxBuffer, fail, strlen(fail))))
+            }
+        }
+        trackResult(ret);
+    }
+    return ret;
+}
+
+int8_t ESP8266::parseLine(char *line, uint8_t len, char *dest, size_t destLen,
+                          const char *pass, const char *fail, char delimA, char delimB)
+{
+    int8_t ret = ESP8266_CMD_RSP_WAIT;
+
+    char *ucpStart = NULL;
+    char *ucpEnd = NULL;
+
+    /* Check for expected response */
+    if (0 == strncmp(line, pass, strlen(pass)))
+    {
+        ESP8266_DBG_PARSE(F("FND: "), line);
+
+        /* Search for delimeters */
+        if ((delimA != '\0') && (delimB != '\0'))
+        {
+            ucpStart = (char *) memchr(line, delimA, len);
+            if (NULL != ucpStart)
+            {
+                ucpStart++;
+                ucpEnd = (char *) memchr(ucpStart, delimB, len - (ucpStart - line));
+                if (NULL != ucpEnd)
                 {
-                    ret = ESP8266_CMD_RSP_FAILED;
+                    if ((ucpEnd - ucpStart) > 1)
+                    {
+                        *ucpEnd = '\0';
+                        ESP8266_DBG_PARSE("INS: ", ucpStart);
+                        if (NULL == dest)
+                        {
+                            ret = ESP8266_CMD_RSP_SUCCESS;
+                        }
+                        /* Only copy the instance if it fits, never trust line content */
+                        else if ((size_t) (ucpEnd - ucpStart) < destLen)
+                        {
+                            memcpy(dest, ucpStart, (ucpEnd - ucpStart) + 1);
+                            ret = ESP8266_CMD_RSP_SUCCESS;
+                        }
+                    }
                 }
-                /* Check if device is busy */
-                else if (0 == strncmp(_rxBuffer, AT_RESPONSE_BUSY, strlen(AT_RESPONSE_BUSY)))
+            }
+        }
+        else
+        {
+            /* Expected response found and no need to find instances */
+            ret = ESP8266_CMD_RSP_SUCCESS;
+        }
+    }
+    /* Check for failed response */
+    else if ((NULL != fail) && (0 == strncmp(line, fail, strlen(fail))))
+    {
+        ret = ESP8266_CMD_RSP_FAILED;
+    }
+    /* Check if device is busy */
+    else if (0 == strncmp(line, AT_RESPONSE_BUSY, strlen(AT_RESPONSE_BUSY)))
+    {
+        ret = ESP8266_CMD_RSP_BUSY;
+    }
+    /* Check if there is an error */
+    else if (0 == strncmp(line, AT_RESPONSE_ERROR, strlen(AT_RESPONSE_ERROR)))
+    {
+        ret = ESP8266_CMD_RSP_ERROR;
+    }
+
+    return ret;
+}
+
+bool ESP8266::parseAP(const char *line, esp8266_ap_t *ap)
+{
+    bool ret = false;
+    const char *ucpStart = NULL;
+    const char *ucpEnd = NULL;
+    long rssi = 0;
+    long channel = 0;
+
+    if ((NULL != line) && (NULL != ap) && (0 == strncmp(line, AT_CWLAP_RX, strlen(AT_CWLAP_RX))))
+    {
+        ucpStart = &line[strlen(AT_CWLAP_RX)];
+        if ('(' == *ucpStart)
+        {
+            ucpStart++;
+        }
+        rssi = strtol(ucpStart, (char **) &ucpEnd, 10);
+
+        /* MAC address between quotes */
+        if ((ucpEnd != ucpStart) && (0 == strncmp(ucpEnd, ",\"", 2)))
+        {
+            ucpStart = ucpEnd + 2;
+            ucpEnd = strchr(ucpStart, '"');
+            if ((NULL != ucpEnd) && ((size_t) (ucpEnd - ucpStart) < sizeof(ap->bssid)) && (',' == ucpEnd[1]))
+            {
+                memcpy(ap->bssid, ucpStart, ucpEnd - ucpStart);
+                ap->bssid[ucpEnd - ucpStart] = '\0';
+                channel = strtol(&ucpEnd[2], NULL, 10);
+                if ((-128 <= rssi) && (0 >= rssi) && (0 < channel) && (14 >= channel))
                 {
-                    ret = ESP8266_CMD_RSP_BUSY;
+                    ap->rssi = (int8_t) rssi;
+                    ap->channel = (uint8_t) channel;
+                    ret = true;
                 }
-                /* Check if there is an error */
-                else if (0 == strncmp(_rxBuffer, AT_RESPONSE_ERROR, strlen(AT_RESPONSE_ERROR)))
+            }
+        }
+    }
+
+    return ret;
+}
+
+int32_t ESP8266::parsePing(const char *line)
+{
+    int32_t time = -1;
+    uint8_t digits = 0;
+
+    if ((NULL != line) && ('+' == line[0]))
+    {
+        line = (0 == strncmp(line, AT_PING_RX, strlen(AT_PING_RX))) ? &line[strlen(AT_PING_RX)] : &line[1];
+        for (time = 0; isdigit(*line) && (7 > digits); line++, digits++)
+        {
+            time = (time * 10) + (*line - '0');
+        }
+        if ((0 == digits) || isdigit(*line))
+        {
+            /* "+timeout" or other "+" notifications */
+            time = -1;
+        }
+    }
+
+    return time;
+}
+
+int32_t ESP8266::parseIPD(const char *line, int8_t *link)
+{
+    int32_t len = -1;
+    int32_t first = 0;
+    int32_t second = 0;
+    uint8_t digits = 0;
+    const char *ucpStart = NULL;
+
+    if ((NULL != line) && (0 == strncmp(line, AT_IPD_RX, strlen(AT_IPD_RX))))
+    {
+        /* First number, link ID or data length */
+        for (ucpStart = &line[strlen(AT_IPD_RX)]; isdigit(*ucpStart) && (7 > digits); ucpStart++, digits++)
+        {
+            first = (first * 10) + (*ucpStart - '0');
+        }
+
+        if ((0 < digits) && (',' == *ucpStart))
+        {
+            /* "+IPD,<link>,<len>" */
+            for (ucpStart++, digits = 0; isdigit(*ucpStart) && (7 > digits); ucpStart++, digits++)
+            {
+                second = (second * 10) + (*ucpStart - '0');
+            }
+            if ((0 < digits) && (first <= 127) && !isdigit(*ucpStart))
+            {
+                len = second;
+                if (NULL != link)
                 {
-                    ret = ESP8266_CMD_RSP_ERROR;
+                    *link = (int8_t) first;
                 }
             }
         }
+        else if ((0 < digits) && !isdigit(*ucpStart))
+        {
+            /* "+IPD,<len>" */
+            len = first;
+            if (NULL != link)
+            {
+                *link = -1;
+            }
+        }
+    }
+
+    return len;
+}
+
+bool ESP8266::parseClosed(const char *line, int8_t *link)
+{
+    bool ret = false;
+    int32_t first = 0;
+    uint8_t digits = 0;
+    const char *ucpStart = line;
+
+    if (NULL != line)
+    {
+        /* Optional "<link>," prefix */
+        for (; isdigit(*ucpStart) && (3 > digits); ucpStart++, digits++)
+        {
+            first = (first * 10) + (*ucpStart - '0');
+        }
+        if ((0 < digits) && (',' == *ucpStart) && (first <= 127))
+        {
+            ucpStart++;
+        }
+        else
+        {
+            ucpStart = line;
+            first = -1;
+        }
+
+        if (0 == strncmp(ucpStart, AT_CIPCLOSE_OK, strlen(AT_CIPCLOSE_OK)))
+        {
+            ucpStart += strlen(AT_CIPCLOSE_OK);
+            ret = ('\0' == *ucpStart) || (0 == strcmp(ucpStart, "\r"));
+        }
+
+        if (ret && (NULL != link))
+        {
+            *link = (int8_t) first;
+        }
     }
+
     return ret;
 }
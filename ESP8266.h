@@ -2,7 +2,16 @@
 #define ESP8266_H
 
 #include "Arduino.h"
+
+/* SoftwareSerial is not available when running on a Linux host */
+#if defined(__linux__) && !defined(ESP8266_NO_SOFTWARE_SERIAL)
+#define ESP8266_NO_SOFTWARE_SERIAL
+#endif
+
+#ifndef ESP8266_NO_SOFTWARE_SERIAL
 #include <SoftwareSerial.h>
+#endif
+#include "ESP8266RingBuffer.h"
 
 #define ESP8266_DBG_PARSE_EN        (0)  /* Enable/Disable ESP8266 Debug  */
 #define ESP8266_DBG_HTTP_RES        (0)  /* Enable/Disable ESP8266 Debug for HTTP responses */
@@ -14,12 +23,134 @@
 #define ESP8266_CONN_SINGLE         (0)  /* Single connection mode */
 #define ESP8266_CONN_MULTIPLE       (1)  /* Multi-Channel connection mode */
 
-#define ESP8266_RX_BUFF_LEN        (64)  /* ESP8266 Rx Buffer length */
+#define ESP8266_MAX_RECV_LEN     (2048)  /* Maximum data length for a single AT+CIPRECVDATA */
+#define ESP8266_MAX_SEND_LEN     (2048)  /* Maximum data length for a single AT+CIPSEND */
+#define ESP8266_VERSION_LEN        (32)  /* Default buffer length for version() */
+#define ESP8266_IP_LEN             (16)  /* Default buffer length for localIP() */
+#define ESP8266_MAC_LEN            (18)  /* Default buffer length for MAC address */
+#define ESP8266_PING_TIMEOUT     (5000)  /* Maximum time to wait for a ping reply */
+#define ESP8266_SCAN_MAX_AGE    (60000)  /* Default age of a scan result still used by joinBestAP() */
+
+/*
+ * Buffer sizes, can be overridden from build flags (i.e. -DESP8266_RX_BUFF_LEN=128)
+ * to fit the driver to the RAM of each board, check ESP8266::footprint().
+ */
+#ifndef ESP8266_RX_BUFF_LEN
+#define ESP8266_RX_BUFF_LEN        (64)  /* ESP8266 Rx Buffer length, longer lines are split */
+#endif
+#ifndef ESP8266_MAX_SSID_LEN
 #define ESP8266_MAX_SSID_LEN       (32)  /* Maximum SSID data length */
+#endif
+#ifndef ESP8266_DOWNLOAD_CHUNK_LEN
+#define ESP8266_DOWNLOAD_CHUNK_LEN (64)  /* Chunk size delivered to httpDownload() sink */
+#endif
+#ifndef ESP8266_RECOVERY_THRESHOLD
+#define ESP8266_RECOVERY_THRESHOLD  (3)  /* Consecutive timeouts/busy responses before recovery */
+#endif
+
+/* Default retry policy, check ESP8266::setRetryPolicy() */
+#define ESP8266_RETRY_ATTEMPTS      (3)  /* Attempts per command, including the first one */
+#define ESP8266_RETRY_BACKOFF     (100)  /* Delay before first retry (ms) */
+#define ESP8266_RETRY_MAX_BACKOFF (2000) /* Maximum delay between retries (ms) */
+#define ESP8266_RETRY_JITTER       (25)  /* Random delay added to each retry (% of delay) */
+
+/* Retryable results, bits of esp8266_retry_policy_t::retryOn */
+#define ESP8266_RETRY_ON_ERROR   (0x01)  /* "ERROR" */
+#define ESP8266_RETRY_ON_BUSY    (0x02)  /* "busy p..." / "busy s..." */
+#define ESP8266_RETRY_ON_TIMEOUT (0x04)  /* No response */
+#define ESP8266_RETRY_ON_FAILED  (0x08)  /* Command specific failure (i.e. "FAIL") */
+
+/* ESP8266 driver metrics, check ESP8266::metrics() */
+typedef struct
+{
+    uint32_t commands;       /* AT commands sent */
+    uint32_t timeouts;       /* Responses that timed out */
+    uint32_t errors;         /* ERROR/FAIL responses */
+    uint32_t busy;           /* "busy" responses */
+    uint32_t resets;         /* Software/Hardware resets */
+    uint32_t bytesSent;      /* Bytes written to serial port */
+    uint32_t bytesReceived;  /* Bytes read from serial port */
+    uint32_t recoveries;     /* Successful recoveries, check ESP8266::recover() */
+    uint32_t recoveryFailures; /* Recoveries which didn't bring the module back */
+    uint32_t downtime;       /* Time from first failure to recovery, all recoveries (ms) */
+    uint32_t meanTimeToRecovery; /* downtime / recoveries (ms) */
+    uint32_t retries;        /* Commands sent again by the retry policy */
+    uint32_t joinTime;       /* Time taken by last successful AP association (ms) */
+} esp8266_metrics_t;
+
+/* Access Point found by a scan, check ESP8266::scanAP() */
+typedef struct
+{
+    char bssid[ESP8266_MAC_LEN]; /* AP MAC address */
+    int8_t rssi;             /* Signal strength (dBm) */
+    uint8_t channel;         /* WiFi channel */
+    uint32_t scanTime;       /* millis() when the scan was done */
+} esp8266_ap_t;
+
+/* Command retry policy, check ESP8266::setRetryPolicy() */
+typedef struct
+{
+    uint8_t attempts;        /* Attempts per command, 1 disables retries */
+    uint16_t backoff;        /* Delay before first retry, doubled on each retry (ms) */
+    uint16_t maxBackoff;     /* Maximum delay between retries (ms) */
+    uint8_t jitter;          /* Random delay added to each retry (% of delay) */
+    uint8_t retryOn;         /* Retryable results, ESP8266_RETRY_ON_* bits */
+} esp8266_retry_policy_t;
+
+/* Streaming download state, check ESP8266::httpDownload() */
+typedef struct
+{
+    int status;              /* HTTP status of last request */
+    uint32_t contentLength;  /* Total body length (0 if unknown) */
+    uint32_t bytes;          /* Body bytes delivered to sink so far */
+    uint32_t crc32;          /* CRC-32 of bytes delivered so far */
+    uint32_t elapsed;        /* Time spent on last request (ms) */
+    uint32_t bytesPerSecond; /* Throughput of last request */
+} esp8266_download_t;
+
+/* Segment types, check esp8266_segment_t */
+#define ESP8266_SEGMENT_RAM         (0)  /* Data in RAM */
+#define ESP8266_SEGMENT_FLASH       (1)  /* Data in flash (PROGMEM) */
+#define ESP8266_SEGMENT_INT         (2)  /* Integer sent as decimal text */
+
+/*
+ * Piece of data sent by ESP8266::send(const esp8266_segment_t *, uint8_t),
+ * use the helper macros to build segment lists:
+ *   esp8266_segment_t req[] = { ESP8266_SEG_P(hdr, sizeof(hdr) - 1), ESP8266_SEG_INT(len), ESP8266_SEG(body, len) };
+ */
+typedef struct
+{
+    uint8_t type;            /* ESP8266_SEGMENT_* */
+    const void *data;        /* RAM or flash data */
+    uint32_t len;            /* Data length */
+    int32_t value;           /* Integer value */
+} esp8266_segment_t;
+
+#define ESP8266_SEG(data, len)      { ESP8266_SEGMENT_RAM, (const void *) (data), (uint32_t) (len), 0 }
+#define ESP8266_SEG_P(data, len)    { ESP8266_SEGMENT_FLASH, (const void *) (data), (uint32_t) (len), 0 }
+#define ESP8266_SEG_INT(value)      { ESP8266_SEGMENT_INT, NULL, 0, (int32_t) (value) }
 
 class ESP8266: public Stream
 {
+    /* Line length is kept on uint8_t by the parser */
+    static_assert((ESP8266_RX_BUFF_LEN >= 32) && (ESP8266_RX_BUFF_LEN <= 255), "ESP8266_RX_BUFF_LEN must be 32..255");
+    static_assert((ESP8266_MAX_SSID_LEN >= 1) && (ESP8266_MAX_SSID_LEN <= 32), "ESP8266_MAX_SSID_LEN must be 1..32");
+    static_assert(ESP8266_MAX_SSID_LEN < ESP8266_RX_BUFF_LEN, "ESP8266_MAX_SSID_LEN must fit on a response line");
+    static_assert((ESP8266_DOWNLOAD_CHUNK_LEN >= 1) && (ESP8266_DOWNLOAD_CHUNK_LEN <= ESP8266_MAX_RECV_LEN),
+                  "ESP8266_DOWNLOAD_CHUNK_LEN must be 1..ESP8266_MAX_RECV_LEN");
+
     public:
+        /* Command result codes, check lastResult() */
+        typedef enum cmd_rsp_code
+        {
+            ESP8266_CMD_RSP_FAILED = -4,
+            ESP8266_CMD_RSP_TIMEOUT = -3,
+            ESP8266_CMD_RSP_BUSY = -2,
+            ESP8266_CMD_RSP_ERROR = -1,
+            ESP8266_CMD_RSP_WAIT = 0,
+            ESP8266_CMD_RSP_SUCCESS = 1,
+        };
+
         /**
          * Class constructor
          *
@@ -34,9 +165,36 @@ class ESP8266: public Stream
          * @param serialPort - Serial port where ESP8266 Tx/Rx are connectected
          * @param baud - ESP8266 current baud rate
          */
+#ifndef ESP8266_NO_SOFTWARE_SERIAL
         void begin(SoftwareSerial &serialPort, uint32_t baud);
+#endif
         void begin(HardwareSerial &serialPort, uint32_t baud);
 
+        /**
+         * Start connection to an already configured serial port
+         *
+         * Any Stream can be used as transport (other UART drivers, USB CDC,
+         * ESP8266LinuxSerial, etc.), caller is responsible for its baud rate.
+         *
+         * @param serialPort - Stream where ESP8266 Tx/Rx are connectected
+         */
+        void begin(Stream &serialPort);
+
+        /**
+         * Read ESP8266 responses from a receive ring buffer instead of the serial port.
+         *
+         * The ring buffer decouples the serial port from the parser, so bytes are not
+         * lost while the application is busy outside the library. It can be fed by
+         * the caller from an RX interrupt, a timer or a reader thread (autoPump = false),
+         * or by the driver itself from the serial port each time it looks for data.
+         * A reader thread needs a serial port which can be written from another
+         * thread while it reads, as ESP8266LinuxSerial.
+         *
+         * @param ring - Receive ring buffer, NULL to read from serial port again.
+         * @param autoPump - Let the driver move bytes from the serial port into the ring.
+         */
+        void attachRxBuffer(ESP8266RingBuffer *ring, bool autoPump = true);
+
         /**
          * Test connection to ESP8266.
          *
@@ -99,22 +257,68 @@ class ESP8266: public Stream
          * Get current ESP8266s firmware version of AT Command Set.
          *
          * @param dest - Pointer to char to save version information
+         * @param len - Size of dest buffer
          *
          * @retval true - success.
          * @retval false - failure.
          */
-        bool version(char *dest);
+        bool version(char *dest, size_t len = ESP8266_VERSION_LEN);
 
         /**
          * Join AP.
          *
          * @param ssid - SSID of AP to join in.
          * @param pwd - Password of AP to join in.
+         * @param bssid - MAC address of the AP to join when several share the SSID (can be NULL).
          * @retval true - success.
          * @retval false - failure.
          * @note This method will take a couple of seconds.
          */
-        bool joinAP(char *ssid, char *ssid_pass);
+        bool joinAP(char *ssid, char *ssid_pass, const char *bssid = NULL);
+
+        /**
+         * Scan for the strongest AP with a given SSID.
+         *
+         * The module is asked to sort the list by RSSI and to report only RSSI,
+         * MAC and channel (AT+CWLAPOPT), so lines stay short, then the list is
+         * restored to its default format for requestAPList(). Result is cached
+         * for joinBestAP().
+         *
+         * @param ssid - SSID to look for.
+         * @param best - Pointer to store strongest AP (can be NULL).
+         *
+         * @retval true - AP found.
+         * @retval false - AP not found or firmware without AT+CWLAPOPT.
+         */
+        bool scanAP(const char *ssid, esp8266_ap_t *best);
+
+        /**
+         * Join the strongest AP with a given SSID, pinned by its BSSID.
+         *
+         * A cached scan result for the same SSID is used if it is not older than
+         * maxAge, otherwise a new scan is done. If joining the cached AP fails,
+         * the scan is repeated once. Without scan results it falls back to joinAP().
+         *
+         * @param ssid - SSID of AP to join in.
+         * @param ssid_pass - Password of AP to join in.
+         * @param maxAge - Maximum age of a cached scan result (ms), 0 to always scan.
+         *
+         * @retval true - success.
+         * @retval false - failure.
+         */
+        bool joinBestAP(char *ssid, char *ssid_pass, uint32_t maxAge = ESP8266_SCAN_MAX_AGE);
+
+        /**
+         * Parse a "+CWLAP:(<rssi>,"<mac>",<channel>)" line, as reported with the
+         * AT+CWLAPOPT mask used by scanAP().
+         *
+         * @param line - NULL terminated line.
+         * @param ap - Pointer to store AP information.
+         *
+         * @retval true - success.
+         * @retval false - line is not a valid AP entry.
+         */
+        static bool parseAP(const char *line, esp8266_ap_t *ap);
 
         /**
          * Quit from current AP.
@@ -150,38 +354,74 @@ class ESP8266: public Stream
          * Get ESP8266 IP Address.
          *
          * @param ip - Pointer to store current IP address.
+         * @param len - Size of ip buffer.
          * @retval true - success.
          * @retval false - failure.
          */
-        bool localIP(char* ip);
+        bool localIP(char* ip, size_t len = ESP8266_IP_LEN);
 
         /**
          * Get ESP8266 MAC Address.
          *
          * @param macAddr - Pointer to store current MAC address.
+         * @param len - Size of macAddr buffer.
          * @retval true - success.
          * @retval false - failure.
          */
-        bool getMACaddress(char* macAddr);
+        bool getMACaddress(char* macAddr, size_t len = ESP8266_MAC_LEN);
 
         /**
          * Get ESP8266 MAC Address.
          *
-         * @param ip - Pointer to store current IP address.
+         * @param mac - Pointer to store current MAC address.
+         * @param len - Size of mac buffer.
          * @retval true - success.
          * @retval false - failure.
          */
-        bool localMAC(char* mac);
+        bool localMAC(char* mac, size_t len = ESP8266_MAC_LEN);
 
         /**
          * Ping server or IP address
          *
          * @param address - Server or IP address to ping
+         * @param rtt - Pointer to store round trip time in ms (can be NULL).
          *
          * @retval true - success.
          * @retval false - failure.
          */
-        bool ping(char *address);
+        bool ping(char *address, uint32_t *rtt = NULL);
+
+        /**
+         * Start a ping without waiting for the reply, check pingResult().
+         * No other command can be sent until the ping is completed.
+         *
+         * @param address - Server or IP address to ping
+         *
+         * @retval true - ping sent.
+         * @retval false - invalid address.
+         */
+        bool pingStart(char *address);
+
+        /**
+         * Check reply of a ping started with pingStart(), it only processes bytes
+         * already received so it never blocks.
+         *
+         * @param rtt - Pointer to store round trip time in ms (can be NULL).
+         *
+         * @retval ESP8266_CMD_RSP_SUCCESS - reply received.
+         * @retval ESP8266_CMD_RSP_WAIT - waiting for reply.
+         * @retval <0 - no reply from host, check cmd_rsp_code.
+         */
+        int8_t pingResult(uint32_t *rtt);
+
+        /**
+         * Parse round trip time from a "+<time>" or "+PING:<time>" line.
+         *
+         * @param line - NULL terminated line.
+         *
+         * @retval - Round trip time in ms, -1 if line is not a ping reply.
+         */
+        static int32_t parsePing(const char *line);
 
         /**
          * Start connection to TCP server.
@@ -206,10 +446,45 @@ class ESP8266: public Stream
          *
          * @param data - Data to send.
          * @retval true - success.
-         * @retval false - failure.
+         * @retval false - failure, connection is closed unless the module stayed
+         * busy after retries (check lastResult()).
          */
         bool send(String data);
 
+        /**
+         * Send binary data to current TCP connection, data is sent as is.
+         *
+         * @param data - Data to send.
+         * @param len - Data length.
+         * @retval true - success.
+         * @retval false - failure, connection is closed unless the module stayed
+         * busy after retries (check lastResult()).
+         */
+        bool send(const uint8_t *data, uint32_t len);
+
+        /**
+         * Send a list of segments to current TCP connection with a single
+         * AT+CIPSEND. Total length is computed first and segments are written
+         * to the port as they are, without building the whole payload in RAM.
+         *
+         * @param segments - Segments to send.
+         * @param count - Number of segments.
+         * @retval true - success.
+         * @retval false - failure, total length over ESP8266_MAX_SEND_LEN or
+         * invalid segment. Connection is closed on send errors unless the module
+         * stayed busy after retries (check lastResult()).
+         */
+        bool send(const esp8266_segment_t *segments, uint8_t count);
+
+        /**
+         * Get length of a list of segments as sent by send().
+         *
+         * @param segments - Segments.
+         * @param count - Number of segments.
+         * @retval - Total length, 0 if a segment is invalid.
+         */
+        static uint32_t segmentsLength(const esp8266_segment_t *segments, uint8_t count);
+
         /**
          * Start data send to TCP connection .
          *
@@ -244,6 +519,139 @@ class ESP8266: public Stream
          */
         int httpGetBodyLine(char *stringToLookFor, char *buffer, uint32_t bufferSize, uint32_t timeout = 200);
 
+        /**
+         * Download a resource with HTTP GET and deliver its body to a sink in chunks
+         * of up to ESP8266_DOWNLOAD_CHUNK_LEN bytes as +IPD frames arrive, so payloads
+         * bigger than RAM can be stored (i.e. on external flash).
+         *
+         * Bodies with Content-Length, "Transfer-Encoding: chunked" or ended by the
+         * server closing the connection are supported, any other transfer coding
+         * (i.e. gzip) fails without delivering anything.
+         *
+         * State must be zeroed before the first call. If a download fails, calling
+         * again with the same state resumes it with a "Range" request from the last
+         * byte delivered, CRC-32 and byte count continue from previous values.
+         *
+         * @param server - Server address.
+         * @param port - Server port.
+         * @param path - Resource path (i.e. "/firmware.bin").
+         * @param sink - Destination of body bytes, any Print implementing write(const uint8_t*, size_t).
+         * @param state - Download state, updated with status, length, CRC and throughput.
+         * @param timeout - Maximum time without receiving data.
+         *
+         * @retval true - whole body delivered.
+         * @retval false - failure, check state to resume.
+         */
+        bool httpDownload(char *server, int port, const char *path, Print &sink,
+                          esp8266_download_t *state, uint32_t timeout = 10000);
+
+        /**
+         * Update a CRC-32 (IEEE 802.3) with a block of data.
+         *
+         * @param crc - Previous CRC, 0 for the first block.
+         * @param data - Data block.
+         * @param len - Data length.
+         *
+         * @retval - Updated CRC.
+         */
+        static uint32_t crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+        /**
+         * Enable/Disable passive receive mode (AT+CIPRECVMODE).
+         *
+         * In passive mode the ESP8266 keeps received TCP data in its own buffer
+         * and only notifies the length with "+IPD,<len>", data is then pulled
+         * with receive() at the pace of the application.
+         *
+         * @param passive - true for passive mode, false for active mode.
+         *
+         * @retval true - success.
+         * @retval false - failure.
+         *
+         * @note Requires an AT firmware newer than the one listed in firmware/README.md.
+         */
+        bool receiveMode(bool passive);
+
+        /**
+         * Query length of TCP data held by the ESP8266 in passive mode (AT+CIPRECVLEN?).
+         *
+         * @retval - Pending bytes, -1 on failure.
+         */
+        int32_t receiveLength(void);
+
+        /**
+         * Get number of pending bytes last reported by the ESP8266 in passive mode,
+         * either by a "+IPD,<len>" notification or by receiveLength().
+         *
+         * @retval - Pending bytes.
+         */
+        uint32_t receivePending(void);
+
+        /**
+         * Receive TCP data from current connection.
+         *
+         * In active mode payload is taken from "+IPD,<len>:<data>" frames as they
+         * arrive, frames can be read in several calls. A zero timeout only takes
+         * bytes already received, so it can be used for polling. Lines received
+         * between frames are discarded, except for "CLOSED" which ends the connection.
+         *
+         * In passive mode data is pulled from the ESP8266 (AT+CIPRECVDATA), request
+         * is limited to bufferSize, so the caller controls the pace of the transfer
+         * by passing only the free space it has available. Nothing is requested
+         * until a "+IPD,<len>" notification (or receiveLength()) reports pending
+         * data, timeout is the time to wait for that notification. Data held when
+         * the connection closes is dropped by the ESP8266, so nothing is requested
+         * once "CLOSED" was received.
+         *
+         * @param buffer - Buffer to store received data.
+         * @param bufferSize - Free space on buffer.
+         * @param timeout - Timeout to receive the data.
+         *
+         * @retval - Bytes copied in buffer, -1 on failure.
+         */
+        int32_t receive(uint8_t *buffer, uint32_t bufferSize, uint32_t timeout = 1000);
+
+        /**
+         * Parse a single response line, this is the parser used by getResponse().
+         *
+         * Instance between delimiters is copied in dest only if it fits on destLen
+         * (including NULL terminator), otherwise the line is not considered a match.
+         *
+         * @param line - NULL terminated line, instance delimiter may be replaced by NULL.
+         * @param len - Line length.
+         * @param dest - Pointer to save instance if found (can be NULL).
+         * @param destLen - Size of dest buffer.
+         * @param pass - Expected response if succeed
+         * @param fail - Expected response if fails (can be NULL)
+         * @param delimA - Delimiter character
+         * @param delimB - Delimiter character
+         *
+         * @retval cmd_rsp_code, ESP8266_CMD_RSP_WAIT if line doesn't match.
+         */
+        static int8_t parseLine(char *line, uint8_t len, char *dest, size_t destLen,
+                                const char *pass, const char *fail, char delimA, char delimB);
+
+        /**
+         * Parse a "+IPD,<len>[:]" or "+IPD,<link>,<len>[:]" header.
+         *
+         * @param line - NULL terminated line.
+         * @param link - Pointer to store link ID, -1 when single connection (can be NULL).
+         *
+         * @retval - Data length, -1 if line is not a valid +IPD header.
+         */
+        static int32_t parseIPD(const char *line, int8_t *link);
+
+        /**
+         * Check for a "CLOSED" or "<link>,CLOSED" line, trailing '\r' is ignored.
+         *
+         * @param line - NULL terminated line.
+         * @param link - Pointer to store link ID, -1 when single connection (can be NULL).
+         *
+         * @retval true - connection closed.
+         * @retval false - any other line.
+         */
+        static bool parseClosed(const char *line, int8_t *link);
+
 #if 0
         /**
          * Get response for the last TCP connection.
@@ -254,10 +662,103 @@ class ESP8266: public Stream
         uint16_t httpReceive(httpResponse* response);
 #endif
 
+        /**
+         * Check if there is an open TCP connection on this module.
+         *
+         * @retval true - connection open.
+         * @retval false - no connection.
+         */
+        bool connected(void);
+
+        /**
+         * Get result of the last command, to tell why a method returned false.
+         *
+         * @retval - cmd_rsp_code (i.e. ESP8266::ESP8266_CMD_RSP_BUSY).
+         */
+        int8_t lastResult(void);
+
+        /**
+         * Set how commands are retried when the module answers with a retryable
+         * result. Default policy retries "busy" 3 times with 100 ms exponential
+         * backoff and 25% jitter.
+         *
+         * @param policy - Retry policy, it is copied.
+         */
+        void setRetryPolicy(const esp8266_retry_policy_t *policy);
+
+        /**
+         * Get current retry policy.
+         *
+         * @param dest - Pointer to store policy.
+         */
+        void retryPolicy(esp8266_retry_policy_t *dest);
+
+        /**
+         * Set how many consecutive timeouts or "busy" responses make the module
+         * unhealthy, check maintain().
+         *
+         * Echo, mode, AP and TCP connection set through this driver are restored after
+         * a reset, SSID, password and server are kept by pointer for that purpose
+         * so they must remain valid.
+         *
+         * @param threshold - Consecutive failures, 0 to disable.
+         */
+        void setRecoveryThreshold(uint8_t threshold);
+
+        /**
+         * Check module health, to be called periodically (i.e. from loop()).
+         * An unhealthy module is recovered with recover().
+         *
+         * @retval true - module is healthy or was recovered.
+         * @retval false - recovery failed, will be retried on next call.
+         */
+        bool maintain(void);
+
+        /**
+         * Bring a hung or desynchronized module back, escalating until it answers:
+         *  1. Leave data mode with "+++" and resynchronize with "AT".
+         *  2. Software reset (reset()).
+         *  3. Hardware reset with RST pin (hardReset()).
+         *  4. Power cycle with EN pin.
+         * After a reset, echo, operation mode, connection mode, receive mode, AP
+         * and open TCP connection are restored.
+         *
+         * This function can take several seconds.
+         *
+         * @retval true - module recovered.
+         * @retval false - module doesn't answer or state couldn't be restored.
+         */
+        bool recover(void);
+
+        /**
+         * Get driver metrics for this module.
+         *
+         * @param dest - Pointer to store current metrics.
+         */
+        void metrics(esp8266_metrics_t *dest);
+
+        /**
+         * Clear driver metrics for this module.
+         */
+        void clearMetrics(void);
+
+        /**
+         * RAM needed by the driver: an instance plus the buffers httpDownload()
+         * places on the stack, the largest user of stack in the driver. Attached
+         * ring buffers are not included, check their own sizeof().
+         *
+         * @retval - Bytes.
+         */
+        static constexpr size_t footprint(void)
+        {
+            return sizeof(ESP8266) + ESP8266_RX_BUFF_LEN + ESP8266_DOWNLOAD_CHUNK_LEN;
+        }
+
         /**
          * Virtual method to match Stream class
          */
         virtual size_t write(uint8_t);
+        using Print::write;
 
         virtual int available();
         virtual int read();
@@ -265,50 +766,84 @@ class ESP8266: public Stream
         virtual void flush();
 
     private:
+        /* Send paths built on startSend() */
+        friend class ESP8266Lzss;
+        friend class ESP8266Queue;
+
         /* Command type, used by sendCommand function */
         typedef enum at_cmd_type
         {
             ESP8266_CMD_QUERY, ESP8266_CMD_SETUP, ESP8266_CMD_EXECUTE,
         };
 
-        /* Response codes for getResponse */
-        typedef enum cmd_rsp_code
-        {
-            ESP8266_CMD_RSP_FAILED = -4,
-            ESP8266_CMD_RSP_TIMEOUT = -3,
-            ESP8266_CMD_RSP_BUSY = -2,
-            ESP8266_CMD_RSP_ERROR = -1,
-            ESP8266_CMD_RSP_WAIT = 0,
-            ESP8266_CMD_RSP_SUCCESS = 1,
-        };
-
-        typedef struct serialPorthandler
-        {
-                SoftwareSerial* _soft;
-                HardwareSerial* _hard;
-                bool isSoftSerial;
-        };
+        /* ESP8266 Serial Port, bound once by begin() */
+        Stream* _serial;
 
-        /* ESP8266 Serial Port handler */
-        serialPorthandler _serialPortHandler;
+        /* Stream where responses are read from, serial port or receive ring buffer */
+        Stream* _rx;
+        ESP8266RingBuffer* _rxRing;
+        bool _rxAutoPump;
 
         /* ESP8266 control pins */
         int _enablePin;
         int _resetPin;
 
-        char _ssidBuffer[ESP8266_MAX_SSID_LEN];
+        char _ssidBuffer[ESP8266_MAX_SSID_LEN + 1];
+
+        /* Response line buffer, one per instance */
+        char _rxBuffer[ESP8266_RX_BUFF_LEN];
+        uint8_t _rxLineLen;
+
+        /* Round trip time of ping in progress, -1 until reported */
+        int32_t _pingRtt;
+
+        /* Last scan result, check joinBestAP() */
+        esp8266_ap_t _scan;
+        char _scanSsid[ESP8266_MAX_SSID_LEN + 1];
+
+        /* Result of last command and retry policy */
+        int8_t _lastResult;
+        esp8266_retry_policy_t _retryPolicy;
+
+        /* TCP connection status */
+        bool _linkOpen;
+
+        /* Passive receive mode status */
+        bool _passiveRecv;
+        uint32_t _recvPending;
+
+        /* Active receive mode status, bytes left on current +IPD frame and partial header */
+        uint32_t _ipdRemaining;
+        char _ipdHeader[16];
+        uint8_t _ipdHeaderLen;
+
+        /* Driver metrics */
+        esp8266_metrics_t _metrics;
+
+        /* Health monitor, consecutive timeouts/busy responses and time of the first one */
+        uint8_t _recoveryThreshold;
+        uint8_t _failStreak;
+        uint32_t _failSince;
+
+        /* Settings restored after a reset */
+        int8_t _wifiMode;
+        int8_t _connMode;
+        int8_t _echo;
+        char *_apSsid;
+        char *_apPass;
+        char *_tcpServer;
+        int _tcpPort;
 
         /**
-         * Setup ESP8266 Serial port.
-         *
-         * @param baud - ESP8266 current baud rate
+         * Enable ESP8266 once the serial port is ready.
          */
-        void setup(uint32_t baud);
+        void setup(void);
 
         /**
          * Look for a response from the ESP8266, if found this function can return the instance that matches
          *
          * @param dest - Pointer to save instance if found
+         * @param destLen - Size of dest buffer
          * @param pass - Expected response if succeed
          * @param fail - Expected response if fails
          * @param delimA - Delimiter character
@@ -317,7 +852,36 @@ class ESP8266: public Stream
          *
          * @retval cmd_rsp_code (1 =  success).
          */
-        int8_t getResponse(char* dest, const char* pass, const char* fail, char delimA, char delimB, uint32_t timeout);
+        int8_t getResponse(char* dest, size_t destLen, const char* pass, const char* fail, char delimA, char delimB, uint32_t timeout);
+
+        /**
+         * Keep result for lastResult() and update health monitor.
+         *
+         * @param rsp - Response code, check cmd_rsp_code.
+         */
+        void trackResult(int8_t rsp);
+
+        /**
+         * Apply retry policy to a command result, waits the backoff delay if the
+         * command has to be sent again.
+         *
+         * @param rsp - Response code, check cmd_rsp_code.
+         * @param attempt - Attempts done so far, updated.
+         *
+         * @retval true - send command again.
+         * @retval false - done.
+         */
+        bool retry(int8_t rsp, uint8_t *attempt);
+
+        /**
+         * Restore settings after a reset.
+         *
+         * @param linkWasOpen - Reopen TCP connection.
+         *
+         * @retval true - success.
+         * @retval false - failure.
+         */
+        bool restore(bool linkWasOpen);
 
         /**
          * Send command to ESP8266.
@@ -327,6 +891,47 @@ class ESP8266: public Stream
          * @param params - Parameters to use when passed setup type
          */
         void sendCommand(const char *cmd, at_cmd_type type, char *params);
+
+        /**
+         * Start a new AT command ("AT" + cmd), parameters are printed by caller.
+         *
+         * @param cmd - Command to send
+         */
+        void beginCommand(const char *cmd);
+
+        /**
+         * Start data send to TCP connection, used by every send path.
+         *
+         * On failure the connection is closed, since the state of the link is
+         * unknown, unless the module stayed busy after retries: then the
+         * connection is kept so the caller can send again later
+         * (lastResult() is ESP8266_CMD_RSP_BUSY).
+         *
+         * @param len - Data length to send.
+         * @retval true - ready to send.
+         * @retval false - failure.
+         */
+        bool startSend(uint32_t len);
+
+        /**
+         * Receive TCP data in passive mode, check receive().
+         */
+        int32_t receivePassive(uint8_t *buffer, uint32_t bufferSize, uint32_t timeout);
+
+        /**
+         * Receive TCP data in active mode, check receive().
+         */
+        int32_t receiveActive(uint8_t *buffer, uint32_t bufferSize, uint32_t timeout);
+
+        /**
+         * Read lines received between frames up to the next "+IPD,<len>" header.
+         *
+         * @param ulStartTime - millis() when the caller started waiting.
+         * @param timeout - Timeout to get the header.
+         *
+         * @retval - Data length, 0 on timeout.
+         */
+        int32_t readIPD(uint32_t ulStartTime, uint32_t timeout);
 };
 
 #endif /* ESP8266_H */
@@ -0,0 +1,589 @@
+/**
+ * @file ESP8266Async.cpp
+ * @brief C++20 coroutine API for ESP8266 modules on a Linux host.
+ */
+
+#include "ESP8266Async.h"
+
+#if defined(__linux__) && defined(__cpp_impl_coroutine)
+
+#include "ESP8266.h"
+#include "ESP8266_AT_CMD.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+const char AT_CIPSEND_FAIL[] = "SEND FAIL";
+const char AT_CIPSTATUS[] = "+CIPSTATUS";
+const char AT_CIPSTATUS_RX[] = "STATUS:";
+
+/* ESP8266AsyncOp */
+
+ESP8266AsyncOp::ESP8266AsyncOp(ESP8266AsyncModule *module, uint8_t type, uint32_t timeout)
+{
+    _module = module;
+    _next = NULL;
+    _type = type;
+    _done = false;
+    _result = 0;
+    _command[0] = '\0';
+    _pass = AT_RESPONSE_OK;
+    _alt = NULL;
+    _altSeen = false;
+    _prompt = false;
+    _data = NULL;
+    _buffer = NULL;
+    _len = 0;
+    _timeout = timeout;
+    _start = 0;
+}
+
+bool ESP8266AsyncOp::await_ready(void) noexcept
+{
+    if ((ASYNC_OP_RECEIVE == _type) && !_done)
+    {
+        if (NULL != _module->_receiver)
+        {
+            /* Only one receiver per module */
+            _result = -1;
+            _done = true;
+        }
+        else if (!_module->takeData(this) && (0 == _timeout))
+        {
+            _result = -1;
+            _done = true;
+        }
+    }
+    return _done;
+}
+
+void ESP8266AsyncOp::await_suspend(std::coroutine_handle<> handle)
+{
+    _handle = handle;
+    _start = millis();
+
+    if (ASYNC_OP_RECEIVE == _type)
+    {
+        _module->_receiver = this;
+    }
+    else
+    {
+        _module->enqueue(this);
+    }
+}
+
+int32_t ESP8266AsyncOp::await_resume(void) noexcept
+{
+    return _result;
+}
+
+uint32_t ESP8266AsyncOp::elapsed(uint32_t now)
+{
+    /* Started after now was read, i.e. by a coroutine resumed from another module */
+    if (0 > (int32_t) (now - _start))
+    {
+        return 0;
+    }
+    return now - _start;
+}
+
+/* ESP8266AsyncModule */
+
+ESP8266AsyncModule::ESP8266AsyncModule(ESP8266LinuxSerial &port)
+{
+    _port = &port;
+    _head = NULL;
+    _tail = NULL;
+    _receiver = NULL;
+    _linkOpen = false;
+    _lineLen = 0;
+    _rxHead = 0;
+    _rxTail = 0;
+    _ipdRemaining = 0;
+    _rxDropped = 0;
+    _resync = false;
+    _statusSeen = false;
+
+    /* Event loop tells when data is available, never wait on reads */
+    _port->setIdleWait(0);
+}
+
+ESP8266AsyncOp ESP8266AsyncModule::test(uint32_t timeout)
+{
+    ESP8266AsyncOp op(this, ESP8266AsyncOp::ASYNC_OP_COMMAND, timeout);
+    snprintf(op._command, sizeof(op._command), "%s%s\r\n", AT_CMD, AT_TEST);
+    return op;
+}
+
+ESP8266AsyncOp ESP8266AsyncModule::joinAP(const char *ssid, const char *ssid_pass, uint32_t timeout)
+{
+    ESP8266AsyncOp op(this, ESP8266AsyncOp::ASYNC_OP_COMMAND, timeout);
+    int len = 0;
+
+    if (NULL != ssid)
+    {
+        if (NULL != ssid_pass)
+        {
+            len = snprintf(op._command, sizeof(op._command), "%s%s=\"%s\",\"%s\"\r\n", AT_CMD, AT_CWJAP, ssid, ssid_pass);
+        }
+        else
+        {
+            len = snprintf(op._command, sizeof(op._command), "%s%s=\"%s\"\r\n", AT_CMD, AT_CWJAP, ssid);
+        }
+    }
+
+    if ((0 >= len) || (sizeof(op._command) <= (size_t) len))
+    {
+        op._done = true;
+    }
+    return op;
+}
+
+ESP8266AsyncOp ESP8266AsyncModule::startTCP(const char *server, int port, uint32_t timeout)
+{
+    ESP8266AsyncOp op(this, ESP8266AsyncOp::ASYNC_OP_COMMAND, timeout);
+    int len = 0;
+
+    if (NULL != server)
+    {
+        len = snprintf(op._command, sizeof(op._command), "%s%s=\"TCP\",\"%s\",%d\r\n", AT_CMD, AT_CIPSTART, server, port);
+    }
+
+    if ((0 >= len) || (sizeof(op._command) <= (size_t) len))
+    {
+        op._done = true;
+    }
+    /* "ALREADY CONNECT" is followed by "ERROR" */
+    op._alt = AT_CIPSTART_ALRDY;
+    return op;
+}
+
+ESP8266AsyncOp ESP8266AsyncModule::send(const uint8_t *data, uint32_t len, uint32_t timeout)
+{
+    ESP8266AsyncOp op(this, ESP8266AsyncOp::ASYNC_OP_SEND, timeout);
+
+    if ((NULL == data) || (0 == len) || (ESP8266_MAX_SEND_LEN < len))
+    {
+        op._done = true;
+    }
+    else
+    {
+        snprintf(op._command, sizeof(op._command), "%s%s=%lu\r\n", AT_CMD, AT_CIPSEND, (unsigned long) len);
+        op._pass = AT_CIPSEND_OK;
+        op._prompt = true;
+        op._data = data;
+        op._len = len;
+    }
+    return op;
+}
+
+ESP8266AsyncOp ESP8266AsyncModule::receive(uint8_t *buffer, uint32_t len, uint32_t timeout)
+{
+    ESP8266AsyncOp op(this, ESP8266AsyncOp::ASYNC_OP_RECEIVE, timeout);
+
+    if ((NULL == buffer) || (0 == len))
+    {
+        op._result = -1;
+        op._done = true;
+    }
+    op._buffer = buffer;
+    op._len = len;
+    return op;
+}
+
+ESP8266AsyncOp ESP8266AsyncModule::stopTCP(uint32_t timeout)
+{
+    ESP8266AsyncOp op(this, ESP8266AsyncOp::ASYNC_OP_COMMAND, timeout);
+    snprintf(op._command, sizeof(op._command), "%s%s\r\n", AT_CMD, AT_CIPCLOSE);
+    return op;
+}
+
+bool ESP8266AsyncModule::connected(void)
+{
+    return _linkOpen;
+}
+
+bool ESP8266AsyncModule::pending(void)
+{
+    return (NULL != _head) || (NULL != _receiver);
+}
+
+uint32_t ESP8266AsyncModule::dropped(void)
+{
+    return _rxDropped;
+}
+
+int ESP8266AsyncModule::fd(void)
+{
+    return _port->fd();
+}
+
+void ESP8266AsyncModule::poll(void)
+{
+    while (0 < _port->available())
+    {
+        processByte((uint8_t) _port->read());
+    }
+}
+
+void ESP8266AsyncModule::tick(uint32_t now, uint32_t *next)
+{
+    uint32_t elapsed = 0;
+    bool expired = true;
+
+    /* Completing a command starts the next one, check it too */
+    while ((NULL != _head) && expired)
+    {
+        elapsed = _head->elapsed(now);
+        expired = (_head->_timeout <= elapsed);
+        if (expired)
+        {
+            /* Its response may still come, don't let it complete the next command */
+            _resync = true;
+            completeCommand(0);
+            /* Next command and the resumed coroutine started operations after now */
+            now = millis();
+        }
+        else if ((_head->_timeout - elapsed) < *next)
+        {
+            *next = _head->_timeout - elapsed;
+        }
+    }
+
+    if (NULL != _receiver)
+    {
+        elapsed = _receiver->elapsed(now);
+        if (_receiver->_timeout <= elapsed)
+        {
+            ESP8266AsyncOp *op = _receiver;
+            _receiver = NULL;
+            op->_result = -1;
+            op->_done = true;
+            op->_handle.resume();
+        }
+        else if ((_receiver->_timeout - elapsed) < *next)
+        {
+            *next = _receiver->_timeout - elapsed;
+        }
+    }
+}
+
+/* Private functions */
+
+void ESP8266AsyncModule::enqueue(ESP8266AsyncOp *op)
+{
+    op->_next = NULL;
+    if (NULL == _tail)
+    {
+        _head = op;
+        _tail = op;
+        startCommand();
+    }
+    else
+    {
+        _tail->_next = op;
+        _tail = op;
+    }
+}
+
+bool ESP8266AsyncModule::takeData(ESP8266AsyncOp *op)
+{
+    uint32_t count = _rxTail - _rxHead;
+    bool ret = false;
+
+    if (0 < count)
+    {
+        if (count > op->_len)
+        {
+            count = op->_len;
+        }
+        memcpy(op->_buffer, &_rxBuffer[_rxHead], count);
+        _rxHead += count;
+        if (_rxHead == _rxTail)
+        {
+            _rxHead = 0;
+            _rxTail = 0;
+        }
+        op->_result = (int32_t) count;
+        ret = true;
+    }
+    else if (!_linkOpen)
+    {
+        op->_result = 0;
+        ret = true;
+    }
+
+    op->_done = ret;
+    return ret;
+}
+
+void ESP8266AsyncModule::startCommand(void)
+{
+    if (_resync)
+    {
+        /* Module answers commands in order, anything before the probe status is stale */
+        _port->print(AT_CMD);
+        _port->print(AT_CIPSTATUS);
+        _port->print("\r\n");
+        (void) _port->drain();
+    }
+    else if (NULL != _head)
+    {
+        _head->_start = millis();
+        _port->print(_head->_command);
+        (void) _port->drain();
+    }
+}
+
+void ESP8266AsyncModule::completeCommand(int32_t result)
+{
+    ESP8266AsyncOp *op = _head;
+
+    _head = op->_next;
+    if (NULL == _head)
+    {
+        _tail = NULL;
+    }
+    op->_result = result;
+    op->_done = true;
+
+    /* Next command goes out before resuming, which may queue more commands */
+    startCommand();
+    op->_handle.resume();
+}
+
+void ESP8266AsyncModule::completeReceive(void)
+{
+    ESP8266AsyncOp *op = _receiver;
+
+    if ((NULL != op) && takeData(op))
+    {
+        _receiver = NULL;
+        op->_handle.resume();
+    }
+}
+
+void ESP8266AsyncModule::processLine(void)
+{
+    ESP8266AsyncOp *op = _head;
+    bool failed = false;
+
+    if ((0 == strcmp(_line, AT_CIPSTART_RX)) || (0 == strcmp(_line, AT_CIPSTART_ALRDY)))
+    {
+        _linkOpen = true;
+    }
+    else if (ESP8266::parseClosed(_line, NULL))
+    {
+        _linkOpen = false;
+        completeReceive();
+    }
+
+    /* Probe answer, "STATUS:<n>" then "OK" */
+    if (0 == strncmp(_line, AT_CIPSTATUS_RX, strlen(AT_CIPSTATUS_RX)))
+    {
+        _statusSeen = true;
+        return;
+    }
+    if (_statusSeen && (0 == strcmp(_line, AT_RESPONSE_OK)))
+    {
+        _statusSeen = false;
+        if (_resync)
+        {
+            _resync = false;
+            startCommand();
+        }
+        return;
+    }
+    if (_resync)
+    {
+        /* Late response of the timed out command */
+        return;
+    }
+
+    if (NULL != op)
+    {
+        failed = (0 == strcmp(_line, AT_RESPONSE_ERROR)) || (0 == strcmp(_line, AT_RESPONSE_FAIL)) ||
+                 (0 == strcmp(_line, AT_CIPSEND_FAIL));
+
+        if (failed)
+        {
+            completeCommand(op->_altSeen ? 1 : 0);
+        }
+        else if (op->_prompt)
+        {
+            /* Wait for '>' */
+        }
+        else if (0 == strcmp(_line, op->_pass))
+        {
+            completeCommand(1);
+        }
+        else if ((NULL != op->_alt) && (0 == strcmp(_line, op->_alt)))
+        {
+            op->_altSeen = true;
+        }
+    }
+}
+
+void ESP8266AsyncModule::processByte(uint8_t c)
+{
+    int32_t len = 0;
+
+    if (0 < _ipdRemaining)
+    {
+        /* Frame payload, dropped if receiver doesn't keep up */
+        if (ESP8266_ASYNC_RX_BUFF_LEN > _rxTail)
+        {
+            _rxBuffer[_rxTail++] = c;
+        }
+        else
+        {
+            _rxDropped++;
+        }
+        _ipdRemaining--;
+        if (0 == _ipdRemaining)
+        {
+            completeReceive();
+        }
+    }
+    else if ('\n' == c)
+    {
+        if ((0 < _lineLen) && ('\r' == _line[_lineLen - 1]))
+        {
+            _lineLen--;
+        }
+        _line[_lineLen] = '\0';
+        if (0 < _lineLen)
+        {
+            processLine();
+        }
+        _lineLen = 0;
+    }
+    else if (_lineLen < (sizeof(_line) - 1))
+    {
+        _line[_lineLen++] = (char) c;
+        _line[_lineLen] = '\0';
+
+        if ((':' == c) && (0 == strncmp(_line, AT_IPD_RX, strlen(AT_IPD_RX))))
+        {
+            len = ESP8266::parseIPD(_line, NULL);
+            if (0 < len)
+            {
+                _ipdRemaining = (uint32_t) len;
+                if (0 < _rxHead)
+                {
+                    /* Make room at the end of the buffer */
+                    memmove(_rxBuffer, &_rxBuffer[_rxHead], _rxTail - _rxHead);
+                    _rxTail -= _rxHead;
+                    _rxHead = 0;
+                }
+            }
+            _lineLen = 0;
+        }
+        else if (('>' == c) && (1 == _lineLen) && !_resync && (NULL != _head) && _head->_prompt)
+        {
+            /* Prompt has no line ending, send data right away */
+            _head->_prompt = false;
+            _port->write(_head->_data, _head->_len);
+            (void) _port->drain();
+            _lineLen = 0;
+        }
+    }
+}
+
+/* ESP8266AsyncLoop */
+
+ESP8266AsyncLoop::ESP8266AsyncLoop(void)
+{
+    _epoll = epoll_create1(EPOLL_CLOEXEC);
+    _count = 0;
+    _stop = false;
+}
+
+ESP8266AsyncLoop::~ESP8266AsyncLoop(void)
+{
+    if (0 <= _epoll)
+    {
+        close(_epoll);
+    }
+}
+
+bool ESP8266AsyncLoop::add(ESP8266AsyncModule &module)
+{
+    struct epoll_event event;
+    bool ret = false;
+
+    if ((0 <= _epoll) && (ESP8266_ASYNC_MAX_MODULES > _count))
+    {
+        event.events = EPOLLIN;
+        event.data.ptr = &module;
+        if (0 == epoll_ctl(_epoll, EPOLL_CTL_ADD, module.fd(), &event))
+        {
+            _modules[_count++] = &module;
+            /* Bytes buffered before joining the loop won't raise an event */
+            module.poll();
+            ret = true;
+        }
+    }
+
+    return ret;
+}
+
+void ESP8266AsyncLoop::run(void)
+{
+    _stop = false;
+    while (!_stop && pending())
+    {
+        step(1000);
+    }
+}
+
+void ESP8266AsyncLoop::runFor(uint32_t ms)
+{
+    uint32_t ulStartTime = millis();
+    uint32_t elapsed = 0;
+
+    _stop = false;
+    while (!_stop && (ms > elapsed))
+    {
+        step(ms - elapsed);
+        elapsed = millis() - ulStartTime;
+    }
+}
+
+void ESP8266AsyncLoop::stop(void)
+{
+    _stop = true;
+}
+
+/* Private functions */
+
+bool ESP8266AsyncLoop::pending(void)
+{
+    bool ret = false;
+    for (uint8_t i = 0; (i < _count) && !ret; i++)
+    {
+        ret = _modules[i]->pending();
+    }
+    return ret;
+}
+
+void ESP8266AsyncLoop::step(uint32_t timeout)
+{
+    struct epoll_event events[ESP8266_ASYNC_MAX_MODULES];
+    uint32_t now = millis();
+    int count = 0;
+
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        _modules[i]->tick(now, &timeout);
+    }
+
+    count = epoll_wait(_epoll, events, ESP8266_ASYNC_MAX_MODULES, (int) timeout);
+    for (int i = 0; i < count; i++)
+    {
+        ((ESP8266AsyncModule *) events[i].data.ptr)->poll();
+    }
+}
+
+#endif /* __linux__ && __cpp_impl_coroutine */
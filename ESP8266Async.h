@@ -0,0 +1,282 @@
+/**
+ * @file ESP8266Async.h
+ * @brief C++20 coroutine API for ESP8266 modules on a Linux host.
+ */
+
+#ifndef ESP8266_ASYNC_H
+#define ESP8266_ASYNC_H
+
+#if defined(__linux__) && defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <exception>
+#include "ESP8266LinuxSerial.h"
+
+#define ESP8266_ASYNC_MAX_MODULES    (32)  /* Maximum modules driven by an event loop */
+#define ESP8266_ASYNC_LINE_LEN      (128)  /* Maximum response line length */
+#define ESP8266_ASYNC_CMD_LEN       (160)  /* Maximum AT command length */
+#define ESP8266_ASYNC_RX_BUFF_LEN  (2048)  /* +IPD data buffered per module */
+
+class ESP8266AsyncModule;
+
+/**
+ * Return type of coroutines using the asynchronous API.
+ *
+ * Coroutines start running when called and release their frame when they
+ * finish, so the returned task can be discarded.
+ */
+class ESP8266Task
+{
+    public:
+        struct promise_type
+        {
+            ESP8266Task get_return_object(void) { return ESP8266Task(); }
+            std::suspend_never initial_suspend(void) noexcept { return {}; }
+            std::suspend_never final_suspend(void) noexcept { return {}; }
+            void return_void(void) {}
+            void unhandled_exception(void) { std::terminate(); }
+        };
+};
+
+/**
+ * Pending AT operation of a module, suspends the awaiting coroutine until
+ * the operation completes.
+ *
+ * Result of co_await:
+ *  - joinAP(), startTCP(), send(), stopTCP(), test(): 1 on success, 0 on failure or timeout.
+ *  - receive(): bytes received, 0 if the connection was closed, -1 on timeout.
+ */
+class ESP8266AsyncOp
+{
+    public:
+        bool await_ready(void) noexcept;
+        void await_suspend(std::coroutine_handle<> handle);
+        int32_t await_resume(void) noexcept;
+
+    private:
+        friend class ESP8266AsyncModule;
+
+        typedef enum
+        {
+            ASYNC_OP_COMMAND, ASYNC_OP_SEND, ASYNC_OP_RECEIVE,
+        } async_op_type_t;
+
+        ESP8266AsyncModule *_module;
+        ESP8266AsyncOp *_next;
+        std::coroutine_handle<> _handle;
+        uint8_t _type;
+        bool _done;
+        int32_t _result;
+
+        /* Command operations */
+        char _command[ESP8266_ASYNC_CMD_LEN];
+        const char *_pass;
+        const char *_alt;        /* Response which turns a following failure into success */
+        bool _altSeen;
+        bool _prompt;            /* Waiting for '>' before sending data */
+
+        /* Data */
+        const uint8_t *_data;
+        uint8_t *_buffer;
+        uint32_t _len;
+
+        uint32_t _timeout;
+        uint32_t _start;
+
+        ESP8266AsyncOp(ESP8266AsyncModule *module, uint8_t type, uint32_t timeout);
+
+        uint32_t elapsed(uint32_t now);
+};
+
+/**
+ * ESP8266 module driven by an ESP8266AsyncLoop, single connection mode.
+ *
+ * AT commands are queued and sent one at a time, +IPD data is buffered
+ * while commands are in progress. Only one coroutine can wait on receive()
+ * at a time.
+ *
+ * When a command times out its response may still come. The module is then
+ * probed with AT+CIPSTATUS, responses before the probe answer are discarded
+ * and queued commands are sent once it arrives.
+ */
+class ESP8266AsyncModule
+{
+    public:
+        /**
+         * Class constructor
+         *
+         * @param port - Already opened tty where ESP8266 Tx/Rx are connected.
+         */
+        ESP8266AsyncModule(ESP8266LinuxSerial &port);
+
+        /**
+         * Test connection to ESP8266.
+         */
+        ESP8266AsyncOp test(uint32_t timeout = 1000);
+
+        /**
+         * Connect to Access Point.
+         *
+         * @param ssid - Access Point SSID.
+         * @param ssid_pass - Access Point password (can be NULL).
+         */
+        ESP8266AsyncOp joinAP(const char *ssid, const char *ssid_pass, uint32_t timeout = 15000);
+
+        /**
+         * Start TCP connection.
+         *
+         * @param server - Server name or IP address.
+         * @param port - Server port.
+         */
+        ESP8266AsyncOp startTCP(const char *server, int port, uint32_t timeout = 5000);
+
+        /**
+         * Send data through TCP connection.
+         *
+         * @param data - Data to send, must remain valid until the operation completes.
+         * @param len - Data length (max. 2048 bytes).
+         */
+        ESP8266AsyncOp send(const uint8_t *data, uint32_t len, uint32_t timeout = 5000);
+
+        /**
+         * Receive TCP data, completes as soon as some data is available.
+         *
+         * @param buffer - Buffer to store data.
+         * @param len - Buffer size.
+         */
+        ESP8266AsyncOp receive(uint8_t *buffer, uint32_t len, uint32_t timeout = 5000);
+
+        /**
+         * Close TCP connection.
+         */
+        ESP8266AsyncOp stopTCP(uint32_t timeout = 2000);
+
+        /**
+         * Check TCP connection status.
+         *
+         * @retval true - connected.
+         * @retval false - disconnected.
+         */
+        bool connected(void);
+
+        /**
+         * Check for operations in progress or queued.
+         *
+         * @retval true - operations pending.
+         * @retval false - module is idle.
+         */
+        bool pending(void);
+
+        /**
+         * Get +IPD bytes dropped because the receive buffer was full, receive()
+         * should be called before ESP8266_ASYNC_RX_BUFF_LEN bytes pile up.
+         */
+        uint32_t dropped(void);
+
+        /**
+         * Get tty file descriptor.
+         */
+        int fd(void);
+
+        /**
+         * Process received bytes, called by the event loop when the tty is readable.
+         */
+        void poll(void);
+
+        /**
+         * Expire operations, called by the event loop.
+         *
+         * @param now - Current time (ms).
+         * @param next - Time until next deadline (ms), updated if an operation expires sooner.
+         */
+        void tick(uint32_t now, uint32_t *next);
+
+    private:
+        friend class ESP8266AsyncOp;
+
+        ESP8266LinuxSerial *_port;
+        ESP8266AsyncOp *_head;   /* Command in progress */
+        ESP8266AsyncOp *_tail;
+        ESP8266AsyncOp *_receiver;
+        bool _linkOpen;
+
+        char _line[ESP8266_ASYNC_LINE_LEN];
+        uint8_t _lineLen;
+
+        uint8_t _rxBuffer[ESP8266_ASYNC_RX_BUFF_LEN];
+        uint32_t _rxHead;
+        uint32_t _rxTail;
+        uint32_t _ipdRemaining;
+        uint32_t _rxDropped;
+
+        /* Resynchronization after a command timeout */
+        bool _resync;
+        bool _statusSeen;
+
+        void enqueue(ESP8266AsyncOp *op);
+        bool takeData(ESP8266AsyncOp *op);
+        void startCommand(void);
+        void completeCommand(int32_t result);
+        void completeReceive(void);
+        void processLine(void);
+        void processByte(uint8_t c);
+};
+
+/**
+ * Event loop driving many modules from a single thread with epoll.
+ *
+ * Usage:
+ *   ESP8266Task run(ESP8266AsyncModule &m) { if (co_await m.joinAP("ssid", "pass")) { ... } }
+ *   loop.add(module); run(module); loop.run();
+ */
+class ESP8266AsyncLoop
+{
+    public:
+        /**
+         * Class constructor
+         */
+        ESP8266AsyncLoop(void);
+
+        /**
+         * Class destructor
+         */
+        ~ESP8266AsyncLoop(void);
+
+        /**
+         * Add a module to the event loop.
+         *
+         * @retval true - success.
+         * @retval false - too many modules or epoll error.
+         */
+        bool add(ESP8266AsyncModule &module);
+
+        /**
+         * Run until stop() is called or every module is idle.
+         */
+        void run(void);
+
+        /**
+         * Run for a while, even if modules are idle.
+         *
+         * @param ms - Time to run (ms).
+         */
+        void runFor(uint32_t ms);
+
+        /**
+         * Make run() return, can be called from a coroutine.
+         */
+        void stop(void);
+
+    private:
+        int _epoll;
+        ESP8266AsyncModule *_modules[ESP8266_ASYNC_MAX_MODULES];
+        uint8_t _count;
+        bool _stop;
+
+        bool pending(void);
+        void step(uint32_t timeout);
+};
+
+#endif /* __linux__ && __cpp_impl_coroutine */
+
+#endif /* ESP8266_ASYNC_H */
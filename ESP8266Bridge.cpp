@@ -0,0 +1,127 @@
+/**
+ * @file ESP8266Bridge.cpp
+ * @brief Bridge between a local Stream and the TCP connection of an ESP8266.
+ */
+
+#include "ESP8266Bridge.h"
+
+ESP8266Bridge::ESP8266Bridge(ESP8266 &esp, Stream &local)
+{
+    _esp = &esp;
+    _local = &local;
+    _flushLatency = ESP8266_BRIDGE_FLUSH_LATENCY;
+    _txLen = 0;
+    _txStart = 0;
+    clearStats();
+}
+
+bool ESP8266Bridge::begin(uint32_t flushLatency)
+{
+    _flushLatency = flushLatency;
+    _txLen = 0;
+    return _esp->receiveMode(true);
+}
+
+bool ESP8266Bridge::poll(void)
+{
+    int c = 0;
+
+    if (!_esp->connected())
+    {
+        if (0 < _txLen)
+        {
+            _stats.dropped += _txLen;
+            _txLen = 0;
+        }
+        return false;
+    }
+
+    /* Local to TCP */
+    while ((ESP8266_BRIDGE_TX_LEN > _txLen) && (0 < _local->available()))
+    {
+        c = _local->read();
+        if (0 > c)
+        {
+            break;
+        }
+        if (0 == _txLen)
+        {
+            _txStart = millis();
+        }
+        _txBuffer[_txLen++] = (uint8_t) c;
+    }
+
+    if ((ESP8266_BRIDGE_TX_LEN == _txLen) || ((0 < _txLen) && (_flushLatency <= (millis() - _txStart))))
+    {
+        (void) flush();
+    }
+
+    /* TCP to local */
+    downlink();
+
+    return _esp->connected();
+}
+
+bool ESP8266Bridge::flush(void)
+{
+    bool ret = true;
+
+    if (0 < _txLen)
+    {
+        _stats.sends++;
+        ret = _esp->send(_txBuffer, _txLen);
+        if (ret)
+        {
+            _stats.bytesUp += _txLen;
+            _txLen = 0;
+        }
+        else
+        {
+            /* Keep data while the module is busy, it's sent on next poll() */
+            _stats.sendErrors++;
+            if (!_esp->connected())
+            {
+                _stats.dropped += _txLen;
+                _txLen = 0;
+            }
+        }
+    }
+
+    return ret;
+}
+
+void ESP8266Bridge::setFlushLatency(uint32_t ms)
+{
+    _flushLatency = ms;
+}
+
+void ESP8266Bridge::stats(esp8266_bridge_stats_t *dest)
+{
+    if (NULL != dest)
+    {
+        memcpy((void *) dest, (void *) &_stats, sizeof(_stats));
+    }
+}
+
+void ESP8266Bridge::clearStats(void)
+{
+    memset((void *) &_stats, 0, sizeof(_stats));
+}
+
+/* Private functions */
+
+void ESP8266Bridge::downlink(void)
+{
+    int32_t count = 0;
+
+    /* One buffer per poll(), so local bytes are not held back. Active mode takes
+     * frames already received, passive mode asks for data only after a
+     * "+IPD,<len>" notification and never once "CLOSED" was received */
+    count = _esp->receive(_rxBuffer, ESP8266_BRIDGE_RX_LEN, 0);
+
+    if (0 < count)
+    {
+        _local->write(_rxBuffer, (size_t) count);
+        _stats.bytesDown += (uint32_t) count;
+    }
+}
@@ -0,0 +1,121 @@
+/**
+ * @file ESP8266Bridge.h
+ * @brief Bridge between a local Stream and the TCP connection of an ESP8266.
+ */
+
+#ifndef ESP8266_BRIDGE_H
+#define ESP8266_BRIDGE_H
+
+#include "ESP8266.h"
+
+/* Buffer sizes, can be overridden from build flags */
+#ifndef ESP8266_BRIDGE_TX_LEN
+#define ESP8266_BRIDGE_TX_LEN      (256)  /* Local to TCP buffer, largest AT+CIPSEND */
+#endif
+#ifndef ESP8266_BRIDGE_RX_LEN
+#define ESP8266_BRIDGE_RX_LEN       (64)  /* TCP to local buffer */
+#endif
+#define ESP8266_BRIDGE_FLUSH_LATENCY (20)  /* Default time local bytes wait for more before being sent (ms) */
+
+/* Bridge counters, check ESP8266Bridge::stats() */
+typedef struct
+{
+    uint32_t bytesUp;        /* Bytes sent from local Stream to TCP */
+    uint32_t bytesDown;      /* Bytes sent from TCP to local Stream */
+    uint32_t sends;          /* AT+CIPSEND done */
+    uint32_t sendErrors;     /* AT+CIPSEND failed */
+    uint32_t dropped;        /* Local bytes dropped, connection closed */
+} esp8266_bridge_stats_t;
+
+/**
+ * Forward bytes between a local Stream (i.e. a UART device) and the current
+ * TCP connection, call poll() from loop().
+ *
+ * Local bytes are collected until ESP8266_BRIDGE_TX_LEN bytes are buffered or
+ * the first of them has waited the flush latency, then sent with a single
+ * AT+CIPSEND straight from the buffer. TCP data is received into a small
+ * buffer and written to the local Stream as is, so each direction copies
+ * data only once.
+ *
+ * Passive receive mode is used if the firmware supports it, otherwise TCP
+ * data arriving while an AT+CIPSEND is in progress may be lost. Local bytes
+ * keep arriving while a chunk is sent, the local Stream must be able to
+ * buffer them (i.e. attach an ESP8266RingBuffer to it).
+ */
+class ESP8266Bridge
+{
+    static_assert((ESP8266_BRIDGE_TX_LEN >= 1) && (ESP8266_BRIDGE_TX_LEN <= ESP8266_MAX_SEND_LEN),
+                  "ESP8266_BRIDGE_TX_LEN must be 1..ESP8266_MAX_SEND_LEN");
+    static_assert((ESP8266_BRIDGE_RX_LEN >= 1) && (ESP8266_BRIDGE_RX_LEN <= ESP8266_MAX_RECV_LEN),
+                  "ESP8266_BRIDGE_RX_LEN must be 1..ESP8266_MAX_RECV_LEN");
+
+    public:
+        /**
+         * Class constructor
+         *
+         * @param esp - Module with the TCP connection.
+         * @param local - Local Stream.
+         */
+        ESP8266Bridge(ESP8266 &esp, Stream &local);
+
+        /**
+         * Set up receive mode, call it before starting the TCP connection.
+         *
+         * @param flushLatency - Maximum time local bytes wait for more before being sent (ms).
+         *
+         * @retval true - passive receive mode.
+         * @retval false - active receive mode, firmware without passive mode.
+         */
+        bool begin(uint32_t flushLatency = ESP8266_BRIDGE_FLUSH_LATENCY);
+
+        /**
+         * Move data in both directions, never waits for more local data.
+         *
+         * @retval true - connection open.
+         * @retval false - connection closed.
+         */
+        bool poll(void);
+
+        /**
+         * Send buffered local bytes now.
+         *
+         * @retval true - success or nothing to send.
+         * @retval false - send failed.
+         */
+        bool flush(void);
+
+        /**
+         * Set maximum time local bytes wait for more before being sent.
+         *
+         * @param ms - Flush latency (ms), 0 sends on every poll().
+         */
+        void setFlushLatency(uint32_t ms);
+
+        /**
+         * Get bridge counters.
+         *
+         * @param dest - Pointer to store counters.
+         */
+        void stats(esp8266_bridge_stats_t *dest);
+
+        /**
+         * Reset bridge counters.
+         */
+        void clearStats(void);
+
+    private:
+        ESP8266 *_esp;
+        Stream *_local;
+        uint32_t _flushLatency;
+
+        uint8_t _txBuffer[ESP8266_BRIDGE_TX_LEN];
+        uint32_t _txLen;
+        uint32_t _txStart;       /* millis() when first buffered byte was read */
+        uint8_t _rxBuffer[ESP8266_BRIDGE_RX_LEN];
+
+        esp8266_bridge_stats_t _stats;
+
+        void downlink(void);
+};
+
+#endif /* ESP8266_BRIDGE_H */
@@ -0,0 +1,453 @@
+/**
+ * @file ESP8266Json.cpp
+ * @brief Constant memory streaming JSON value extractor for response bodies.
+ */
+
+#include "ESP8266Json.h"
+
+ESP8266JsonExtractor::ESP8266JsonExtractor(void)
+{
+    _fieldCount = 0;
+    reset();
+}
+
+bool ESP8266JsonExtractor::addInt(const char *path, long *dest)
+{
+    return addField(path, (void *) dest, sizeof(long), JSON_FIELD_INT);
+}
+
+bool ESP8266JsonExtractor::addFloat(const char *path, float *dest)
+{
+    return addField(path, (void *) dest, sizeof(float), JSON_FIELD_FLOAT);
+}
+
+bool ESP8266JsonExtractor::addString(const char *path, char *dest, size_t len)
+{
+    bool ret = false;
+    if (0 < len)
+    {
+        dest[0] = '\0';
+        ret = addField(path, (void *) dest, len, JSON_FIELD_STRING);
+    }
+    return ret;
+}
+
+void ESP8266JsonExtractor::reset(void)
+{
+    _found = 0;
+    _depth = 0;
+    _state = JSON_VALUE;
+    _path[0] = '\0';
+    _pathLen = 0;
+    _pathTruncated = false;
+    _active = -1;
+    _valueLen = 0;
+    _unicode = 0;
+}
+
+bool ESP8266JsonExtractor::found(uint8_t field)
+{
+    return (field < _fieldCount) && (0 != (_found & (1 << field)));
+}
+
+bool ESP8266JsonExtractor::complete(void)
+{
+    return (0 < _fieldCount) && (((1 << _fieldCount) - 1) == _found);
+}
+
+bool ESP8266JsonExtractor::error(void)
+{
+    return (JSON_ERROR == _state);
+}
+
+size_t ESP8266JsonExtractor::write(uint8_t c)
+{
+    bool again = false;
+
+    do
+    {
+        again = false;
+
+        switch (_state)
+        {
+            case JSON_VALUE:
+            case JSON_VALUE_OR_END:
+                if (isspace(c))
+                {
+                    break;
+                }
+                if ((JSON_VALUE_OR_END == _state) && (']' == c))
+                {
+                    /* Empty array */
+                    popLevel();
+                }
+                else if ('{' == c)
+                {
+                    if (pushLevel(false))
+                    {
+                        _state = JSON_KEY_OR_END;
+                    }
+                }
+                else if ('[' == c)
+                {
+                    if (pushLevel(true))
+                    {
+                        beginElement();
+                        _state = JSON_VALUE_OR_END;
+                    }
+                }
+                else if ('"' == c)
+                {
+                    beginValue();
+                    _state = JSON_STRING;
+                }
+                else if (('-' == c) || isalnum(c))
+                {
+                    beginValue();
+                    storeChar((char) c);
+                    _state = JSON_LITERAL;
+                }
+                else
+                {
+                    _state = JSON_ERROR;
+                }
+                break;
+
+            case JSON_KEY_OR_END:
+                if (isspace(c))
+                {
+                    break;
+                }
+                if ('}' == c)
+                {
+                    popLevel();
+                }
+                else if ('"' == c)
+                {
+                    /* Key is appended to the path of its object */
+                    restorePath();
+                    if (0 < _pathLen)
+                    {
+                        appendPath('.');
+                    }
+                    _state = JSON_KEY;
+                }
+                else
+                {
+                    _state = JSON_ERROR;
+                }
+                break;
+
+            case JSON_KEY:
+                if ('"' == c)
+                {
+                    _state = JSON_COLON;
+                }
+                else if ('\\' == c)
+                {
+                    _state = JSON_KEY_ESC;
+                }
+                else
+                {
+                    appendPath((char) c);
+                }
+                break;
+
+            case JSON_KEY_ESC:
+                appendPath((char) c);
+                _state = JSON_KEY;
+                break;
+
+            case JSON_COLON:
+                if (':' == c)
+                {
+                    _state = JSON_VALUE;
+                }
+                else if (!isspace(c))
+                {
+                    _state = JSON_ERROR;
+                }
+                break;
+
+            case JSON_STRING:
+                if ('"' == c)
+                {
+                    endString();
+                    _state = (0 == _depth) ? JSON_DONE : JSON_AFTER_VALUE;
+                }
+                else if ('\\' == c)
+                {
+                    _state = JSON_STRING_ESC;
+                }
+                else
+                {
+                    storeChar((char) c);
+                }
+                break;
+
+            case JSON_STRING_ESC:
+                _state = JSON_STRING;
+                switch (c)
+                {
+                    case 'n': storeChar('\n'); break;
+                    case 'r': storeChar('\r'); break;
+                    case 't': storeChar('\t'); break;
+                    case 'b': storeChar('\b'); break;
+                    case 'f': storeChar('\f'); break;
+                    case 'u':
+                        /* Non ASCII characters are not decoded */
+                        storeChar('?');
+                        _unicode = 4;
+                        _state = JSON_STRING_UNICODE;
+                        break;
+                    default: storeChar((char) c); break;
+                }
+                break;
+
+            case JSON_STRING_UNICODE:
+                if (0 == --_unicode)
+                {
+                    _state = JSON_STRING;
+                }
+                break;
+
+            case JSON_LITERAL:
+                if (isalnum(c) || ('.' == c) || ('-' == c) || ('+' == c))
+                {
+                    storeChar((char) c);
+                }
+                else
+                {
+                    endLiteral();
+                    _state = (0 == _depth) ? JSON_DONE : JSON_AFTER_VALUE;
+                    /* Delimiter belongs to the container */
+                    again = (JSON_AFTER_VALUE == _state);
+                }
+                break;
+
+            case JSON_AFTER_VALUE:
+                if (isspace(c))
+                {
+                    break;
+                }
+                if (',' == c)
+                {
+                    if (_stack[_depth - 1].isArray)
+                    {
+                        _stack[_depth - 1].index++;
+                        beginElement();
+                        _state = JSON_VALUE;
+                    }
+                    else
+                    {
+                        _state = JSON_KEY_OR_END;
+                    }
+                }
+                else if ((']' == c) && _stack[_depth - 1].isArray)
+                {
+                    popLevel();
+                }
+                else if (('}' == c) && !_stack[_depth - 1].isArray)
+                {
+                    popLevel();
+                }
+                else
+                {
+                    _state = JSON_ERROR;
+                }
+                break;
+
+            default:
+                /* Document done or malformed, ignore remaining bytes */
+                break;
+        }
+    } while (again);
+
+    return 1;
+}
+
+/* Private functions */
+
+bool ESP8266JsonExtractor::addField(const char *path, void *dest, size_t len, uint8_t type)
+{
+    bool ret = false;
+    if ((NULL != path) && (NULL != dest) && (ESP8266_JSON_MAX_FIELDS > _fieldCount))
+    {
+        _fields[_fieldCount].path = path;
+        _fields[_fieldCount].dest = dest;
+        _fields[_fieldCount].len = len;
+        _fields[_fieldCount].type = type;
+        _fieldCount++;
+        ret = true;
+    }
+    return ret;
+}
+
+void ESP8266JsonExtractor::appendPath(char c)
+{
+    if (_pathLen < (sizeof(_path) - 1))
+    {
+        _path[_pathLen++] = c;
+        _path[_pathLen] = '\0';
+    }
+    else
+    {
+        /* Path too long, nothing below this point can match */
+        _pathTruncated = true;
+    }
+}
+
+void ESP8266JsonExtractor::restorePath(void)
+{
+    if (0 < _depth)
+    {
+        _pathLen = _stack[_depth - 1].pathLen;
+        _pathTruncated = _stack[_depth - 1].truncated;
+    }
+    else
+    {
+        _pathLen = 0;
+        _pathTruncated = false;
+    }
+    _path[_pathLen] = '\0';
+}
+
+bool ESP8266JsonExtractor::pushLevel(bool isArray)
+{
+    bool ret = false;
+    if (ESP8266_JSON_MAX_DEPTH > _depth)
+    {
+        _stack[_depth].isArray = isArray;
+        _stack[_depth].truncated = _pathTruncated;
+        _stack[_depth].pathLen = _pathLen;
+        _stack[_depth].index = 0;
+        _depth++;
+        ret = true;
+    }
+    else
+    {
+        _state = JSON_ERROR;
+    }
+    return ret;
+}
+
+void ESP8266JsonExtractor::popLevel(void)
+{
+    _depth--;
+    _state = (0 == _depth) ? JSON_DONE : JSON_AFTER_VALUE;
+}
+
+void ESP8266JsonExtractor::beginElement(void)
+{
+    char indexStr[6];
+    uint8_t i = 0;
+
+    restorePath();
+    if (0 < _pathLen)
+    {
+        appendPath('.');
+    }
+    utoa(_stack[_depth - 1].index, indexStr, 10);
+    for (i = 0; '\0' != indexStr[i]; i++)
+    {
+        appendPath(indexStr[i]);
+    }
+}
+
+void ESP8266JsonExtractor::beginValue(void)
+{
+    const char *key = NULL;
+    const char *path = NULL;
+
+    _active = -1;
+    _valueLen = 0;
+
+    if (!_pathTruncated)
+    {
+        /* Last path segment, used by "*key" fields */
+        key = strrchr(_path, '.');
+        key = (NULL != key) ? (key + 1) : _path;
+
+        for (uint8_t i = 0; (i < _fieldCount) && (-1 == _active); i++)
+        {
+            path = _fields[i].path;
+            if ((('*' == path[0]) && (0 == strcmp(&path[1], key))) || (0 == strcmp(path, _path)))
+            {
+                _active = i;
+            }
+        }
+    }
+}
+
+void ESP8266JsonExtractor::storeChar(char c)
+{
+    if (0 <= _active)
+    {
+        if (JSON_FIELD_STRING == _fields[_active].type)
+        {
+            if (_valueLen < (_fields[_active].len - 1))
+            {
+                ((char *) _fields[_active].dest)[_valueLen++] = c;
+                ((char *) _fields[_active].dest)[_valueLen] = '\0';
+            }
+        }
+        else if (_valueLen < (sizeof(_literal) - 1))
+        {
+            _literal[_valueLen++] = c;
+        }
+    }
+}
+
+void ESP8266JsonExtractor::endString(void)
+{
+    if (0 <= _active)
+    {
+        if (JSON_FIELD_STRING != _fields[_active].type)
+        {
+            /* Quoted number */
+            endLiteral();
+        }
+        else
+        {
+            _found |= (1 << _active);
+        }
+    }
+    _active = -1;
+}
+
+void ESP8266JsonExtractor::endLiteral(void)
+{
+    if (0 <= _active)
+    {
+        if (JSON_FIELD_STRING == _fields[_active].type)
+        {
+            /* Literal text already copied */
+            _found |= (1 << _active);
+        }
+        else
+        {
+            _literal[_valueLen] = '\0';
+            if (0 != strcmp(_literal, "null"))
+            {
+                if (JSON_FIELD_INT == _fields[_active].type)
+                {
+                    if (0 == strcmp(_literal, "true"))
+                    {
+                        *((long *) _fields[_active].dest) = 1;
+                    }
+                    else
+                    {
+                        /* "false" and non numeric literals are stored as 0 */
+                        *((long *) _fields[_active].dest) = atol(_literal);
+                    }
+                }
+                else
+                {
+                    *((float *) _fields[_active].dest) = (float) atof(_literal);
+                }
+                _found |= (1 << _active);
+            }
+        }
+    }
+    _active = -1;
+}
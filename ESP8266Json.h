@@ -0,0 +1,173 @@
+/**
+ * @file ESP8266Json.h
+ * @brief Constant memory streaming JSON value extractor for response bodies.
+ */
+
+#ifndef ESP8266_JSON_H
+#define ESP8266_JSON_H
+
+#include "Arduino.h"
+
+#define ESP8266_JSON_MAX_FIELDS     (8)  /* Maximum fields to extract */
+#ifndef ESP8266_JSON_MAX_DEPTH
+#define ESP8266_JSON_MAX_DEPTH      (8)  /* Maximum object/array nesting */
+#endif
+#ifndef ESP8266_JSON_PATH_LEN
+#define ESP8266_JSON_PATH_LEN      (48)  /* Maximum length of current path */
+#endif
+#define ESP8266_JSON_LITERAL_LEN   (24)  /* Maximum length of numbers and literals */
+
+/**
+ * Extract values from a JSON document fed byte by byte, without buffering it.
+ *
+ * Fields are selected with a path from the root, object keys and array
+ * indexes separated by dots (i.e. "main.temp" or "list.0.name"), or with a
+ * key prefixed by '*' to match that key at any depth (i.e. "*temp").
+ *
+ * The extractor is a Print, so it can be used directly as sink of
+ * ESP8266::httpDownload() or fed with write()/print().
+ */
+class ESP8266JsonExtractor: public Print
+{
+    /* Depth and path length are kept on uint8_t */
+    static_assert((ESP8266_JSON_MAX_DEPTH >= 1) && (ESP8266_JSON_MAX_DEPTH <= 255), "ESP8266_JSON_MAX_DEPTH must be 1..255");
+    static_assert((ESP8266_JSON_PATH_LEN >= 2) && (ESP8266_JSON_PATH_LEN <= 255), "ESP8266_JSON_PATH_LEN must be 2..255");
+
+    public:
+        /**
+         * Class constructor
+         */
+        ESP8266JsonExtractor(void);
+
+        /**
+         * Register an integer field, "true"/"false" are stored as 1/0.
+         *
+         * @param path - Field path, must remain valid while parsing.
+         * @param dest - Pointer to store value.
+         *
+         * @retval true - success.
+         * @retval false - too many fields.
+         */
+        bool addInt(const char *path, long *dest);
+
+        /**
+         * Register a floating point field.
+         *
+         * @param path - Field path, must remain valid while parsing.
+         * @param dest - Pointer to store value.
+         *
+         * @retval true - success.
+         * @retval false - too many fields.
+         */
+        bool addFloat(const char *path, float *dest);
+
+        /**
+         * Register a string field, longer values are truncated.
+         *
+         * @param path - Field path, must remain valid while parsing.
+         * @param dest - Buffer to store value (NULL terminated).
+         * @param len - Size of dest buffer.
+         *
+         * @retval true - success.
+         * @retval false - too many fields.
+         */
+        bool addString(const char *path, char *dest, size_t len);
+
+        /**
+         * Restart parser for a new document, registered fields are kept.
+         */
+        void reset(void);
+
+        /**
+         * Check if a field was found.
+         *
+         * @param field - Field index, in order of registration.
+         *
+         * @retval true - value stored.
+         * @retval false - not found (yet).
+         */
+        bool found(uint8_t field);
+
+        /**
+         * Check if every registered field was found.
+         *
+         * @retval true - all fields found.
+         * @retval false - some field is missing.
+         */
+        bool complete(void);
+
+        /**
+         * Check if the document is malformed or nested deeper than ESP8266_JSON_MAX_DEPTH.
+         *
+         * @retval true - parse error, remaining bytes are ignored.
+         * @retval false - no error.
+         */
+        bool error(void);
+
+        /**
+         * Feed a byte of the document.
+         */
+        virtual size_t write(uint8_t c);
+        using Print::write;
+
+    private:
+        typedef enum
+        {
+            JSON_VALUE, JSON_VALUE_OR_END, JSON_KEY_OR_END, JSON_KEY, JSON_KEY_ESC, JSON_COLON,
+            JSON_STRING, JSON_STRING_ESC, JSON_STRING_UNICODE, JSON_LITERAL, JSON_AFTER_VALUE,
+            JSON_DONE, JSON_ERROR,
+        } json_state_t;
+
+        typedef enum
+        {
+            JSON_FIELD_INT, JSON_FIELD_FLOAT, JSON_FIELD_STRING,
+        } json_field_type_t;
+
+        typedef struct
+        {
+            const char *path;
+            void *dest;
+            size_t len;
+            uint8_t type;
+        } json_field_t;
+
+        typedef struct
+        {
+            bool isArray;
+            bool truncated;
+            uint8_t pathLen;
+            uint16_t index;
+        } json_level_t;
+
+        json_field_t _fields[ESP8266_JSON_MAX_FIELDS];
+        uint8_t _fieldCount;
+        uint8_t _found;
+
+        json_level_t _stack[ESP8266_JSON_MAX_DEPTH];
+        uint8_t _depth;
+        uint8_t _state;
+
+        /* Path of current value */
+        char _path[ESP8266_JSON_PATH_LEN];
+        uint8_t _pathLen;
+        bool _pathTruncated;
+
+        /* Current value */
+        int8_t _active;
+        size_t _valueLen;
+        char _literal[ESP8266_JSON_LITERAL_LEN];
+        uint8_t _unicode;
+
+        bool addField(const char *path, void *dest, size_t len, uint8_t type);
+        void appendPath(char c);
+        void restorePath(void);
+        bool pushLevel(bool isArray);
+        void popLevel(void);
+        void beginElement(void);
+        void beginValue(void);
+        void storeChar(char c);
+        void endString(void);
+        void endLiteral(void);
+};
+
+#endif /* ESP8266_JSON_H */
@@ -0,0 +1,267 @@
+/**
+ * @file ESP8266LinuxSerial.cpp
+ * @brief Linux tty transport for ESP8266 modules on USB-UART adapters.
+ */
+
+#if defined(__linux__)
+
+#include "ESP8266LinuxSerial.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+/* termios2 allows any baud rate, <termios.h> can't be included along with it */
+#include <asm/termbits.h>
+
+ESP8266LinuxSerial::ESP8266LinuxSerial(void)
+{
+    _fd = -1;
+    _epoll = -1;
+    _idleWait = 1;
+    _rxHead = 0;
+    _rxTail = 0;
+    _txLen = 0;
+}
+
+ESP8266LinuxSerial::~ESP8266LinuxSerial(void)
+{
+    end();
+}
+
+bool ESP8266LinuxSerial::begin(const char *device, uint32_t baud)
+{
+    struct termios2 tio;
+    struct epoll_event event;
+
+    end();
+
+    _fd = open(device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (0 > _fd)
+    {
+        return false;
+    }
+
+    if (0 != ioctl(_fd, TCGETS2, &tio))
+    {
+        end();
+        return false;
+    }
+
+    /* Raw mode, same as cfmakeraw() */
+    tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+    tio.c_oflag &= ~OPOST;
+    tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS | CBAUD);
+    tio.c_cflag |= CS8 | CREAD | CLOCAL | BOTHER;
+    tio.c_ispeed = baud;
+    tio.c_ospeed = baud;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+
+    if ((0 != ioctl(_fd, TCSETS2, &tio)) || (0 != ioctl(_fd, TCFLSH, TCIOFLUSH)))
+    {
+        end();
+        return false;
+    }
+
+    _epoll = epoll_create1(EPOLL_CLOEXEC);
+    event.events = EPOLLIN;
+    event.data.fd = _fd;
+    if ((0 > _epoll) || (0 != epoll_ctl(_epoll, EPOLL_CTL_ADD, _fd, &event)))
+    {
+        end();
+        return false;
+    }
+
+    _rxHead = 0;
+    _rxTail = 0;
+    _txLen = 0;
+    return true;
+}
+
+void ESP8266LinuxSerial::end(void)
+{
+    if (0 <= _fd)
+    {
+        (void) drain();
+        close(_fd);
+        _fd = -1;
+    }
+    if (0 <= _epoll)
+    {
+        close(_epoll);
+        _epoll = -1;
+    }
+}
+
+int ESP8266LinuxSerial::fd(void)
+{
+    return _fd;
+}
+
+bool ESP8266LinuxSerial::wait(uint32_t timeout)
+{
+    if (_rxHead == _rxTail)
+    {
+        fill(timeout);
+    }
+    return (_rxHead != _rxTail);
+}
+
+void ESP8266LinuxSerial::setIdleWait(uint32_t ms)
+{
+    _idleWait = ms;
+}
+
+size_t ESP8266LinuxSerial::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t ESP8266LinuxSerial::write(const uint8_t *buffer, size_t size)
+{
+    std::lock_guard<std::recursive_mutex> guard(_txLock);
+    size_t count = 0;
+    size_t len = 0;
+
+    while ((count < size) && (0 <= _fd))
+    {
+        if (ESP8266_LINUX_TX_BUFF_LEN == _txLen)
+        {
+            if (!drain())
+            {
+                break;
+            }
+        }
+        len = ESP8266_LINUX_TX_BUFF_LEN - _txLen;
+        if (len > (size - count))
+        {
+            len = size - count;
+        }
+        memcpy(&_txBuffer[_txLen], &buffer[count], len);
+        _txLen += len;
+        count += len;
+    }
+
+    return count;
+}
+
+int ESP8266LinuxSerial::available()
+{
+    if (_rxHead == _rxTail)
+    {
+        fill(_idleWait);
+    }
+    return (int) (_rxTail - _rxHead);
+}
+
+int ESP8266LinuxSerial::read()
+{
+    int c = -1;
+    if (0 < available())
+    {
+        c = _rxBuffer[_rxHead++];
+    }
+    return c;
+}
+
+int ESP8266LinuxSerial::peek()
+{
+    int c = -1;
+    if (0 < available())
+    {
+        c = _rxBuffer[_rxHead];
+    }
+    return c;
+}
+
+void ESP8266LinuxSerial::flush()
+{
+    if (drain())
+    {
+        /* Wait until everything is on the wire */
+        (void) ioctl(_fd, TCSBRK, 1);
+    }
+}
+
+/* Private functions */
+
+void ESP8266LinuxSerial::fill(uint32_t timeout)
+{
+    struct epoll_event event;
+    ssize_t count = 0;
+
+    if (0 > _fd)
+    {
+        return;
+    }
+
+    /* Command must be out before waiting for its response */
+    (void) drain();
+
+    if (_rxHead == _rxTail)
+    {
+        _rxHead = 0;
+        _rxTail = 0;
+    }
+
+    count = ::read(_fd, &_rxBuffer[_rxTail], ESP8266_LINUX_RX_BUFF_LEN - _rxTail);
+    if ((0 > count) && (EAGAIN == errno) && (0 < timeout))
+    {
+        if (0 < epoll_wait(_epoll, &event, 1, (int) timeout))
+        {
+            count = ::read(_fd, &_rxBuffer[_rxTail], ESP8266_LINUX_RX_BUFF_LEN - _rxTail);
+        }
+    }
+
+    if (0 < count)
+    {
+        _rxTail += (size_t) count;
+    }
+}
+
+bool ESP8266LinuxSerial::drain(void)
+{
+    std::lock_guard<std::recursive_mutex> guard(_txLock);
+    struct epoll_event event;
+    ssize_t count = 0;
+    size_t sent = 0;
+    bool ret = true;
+
+    while ((sent < _txLen) && ret)
+    {
+        count = ::write(_fd, &_txBuffer[sent], _txLen - sent);
+        if (0 < count)
+        {
+            sent += (size_t) count;
+        }
+        else if ((0 > count) && (EINTR == errno))
+        {
+            continue;
+        }
+        else if ((0 > count) && (EAGAIN == errno))
+        {
+            /* Output queue full, wait until tty is writable */
+            event.events = EPOLLOUT;
+            event.data.fd = _fd;
+            (void) epoll_ctl(_epoll, EPOLL_CTL_MOD, _fd, &event);
+            ret = (0 < epoll_wait(_epoll, &event, 1, (int) _timeout));
+            event.events = EPOLLIN;
+            (void) epoll_ctl(_epoll, EPOLL_CTL_MOD, _fd, &event);
+        }
+        else
+        {
+            ret = false;
+        }
+    }
+
+    /* Keep bytes not written */
+    memmove(_txBuffer, &_txBuffer[sent], _txLen - sent);
+    _txLen -= sent;
+
+    return ret;
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,127 @@
+/**
+ * @file ESP8266LinuxSerial.h
+ * @brief Linux tty transport for ESP8266 modules on USB-UART adapters.
+ */
+
+#ifndef ESP8266_LINUX_SERIAL_H
+#define ESP8266_LINUX_SERIAL_H
+
+#if defined(__linux__)
+
+#include "Arduino.h"
+
+#include <mutex>
+
+#define ESP8266_LINUX_RX_BUFF_LEN  (4096)  /* Bytes read from tty on each system call */
+#define ESP8266_LINUX_TX_BUFF_LEN  (4096)  /* Bytes queued before writing to tty */
+
+/**
+ * Serial port on a Linux tty (i.e. /dev/ttyUSB0 or a pty), configured in raw
+ * mode with any baud rate. I/O is non-blocking and driven by epoll.
+ *
+ * Written bytes are queued and sent when the queue is full, on flush() or
+ * before reading, so each AT command goes out in a single write(). The queue
+ * is locked, so a reader thread can pump an ESP8266RingBuffer from the port
+ * while the driver writes from its own thread. Reads must stay on one thread.
+ *
+ * Usage: open the port and pass it to ESP8266::begin(Stream &).
+ */
+class ESP8266LinuxSerial: public Stream
+{
+    public:
+        /**
+         * Class constructor
+         */
+        ESP8266LinuxSerial(void);
+
+        /**
+         * Class destructor, closes the port.
+         */
+        ~ESP8266LinuxSerial(void);
+
+        /**
+         * Open tty in raw mode (8N1, no flow control).
+         *
+         * @param device - tty path.
+         * @param baud - Baud rate, non standard rates are supported.
+         *
+         * @retval true - success.
+         * @retval false - failure, check errno.
+         */
+        bool begin(const char *device, uint32_t baud);
+
+        /**
+         * Close the port.
+         */
+        void end(void);
+
+        /**
+         * Get tty file descriptor, i.e. to add it to an external event loop.
+         *
+         * @retval - File descriptor, -1 if closed.
+         */
+        int fd(void);
+
+        /**
+         * Wait until data is received.
+         *
+         * @param timeout - Maximum time to wait (ms).
+         *
+         * @retval true - data available.
+         * @retval false - timeout or error.
+         */
+        bool wait(uint32_t timeout);
+
+        /**
+         * Set time read()/available() wait for data when nothing is buffered,
+         * keeps polling loops of the driver from spinning the CPU.
+         *
+         * @param ms - Idle wait (ms), 0 to return immediately.
+         */
+        void setIdleWait(uint32_t ms);
+
+        /**
+         * Write queued bytes to tty, waiting only if the tty output queue is full.
+         * Unlike flush() it doesn't wait for the bytes to be transmitted.
+         *
+         * @retval true - all queued bytes written.
+         * @retval false - error or timeout.
+         */
+        bool drain(void);
+
+        /**
+         * Stream methods.
+         */
+        virtual size_t write(uint8_t c);
+        virtual size_t write(const uint8_t *buffer, size_t size);
+        using Print::write;
+        virtual int available();
+        virtual int read();
+        virtual int peek();
+        virtual void flush();
+
+    private:
+        int _fd;
+        int _epoll;
+        uint32_t _idleWait;
+
+        uint8_t _rxBuffer[ESP8266_LINUX_RX_BUFF_LEN];
+        size_t _rxHead;
+        size_t _rxTail;
+
+        /* Written by the driver, sent by whichever thread reads or flushes */
+        std::recursive_mutex _txLock;
+        uint8_t _txBuffer[ESP8266_LINUX_TX_BUFF_LEN];
+        size_t _txLen;
+
+        /**
+         * Read pending bytes from tty into rx buffer.
+         *
+         * @param timeout - Time to wait when nothing is pending (ms).
+         */
+        void fill(uint32_t timeout);
+};
+
+#endif /* __linux__ */
+
+#endif /* ESP8266_LINUX_SERIAL_H */
@@ -0,0 +1,245 @@
+/**
+ * @file ESP8266Lzss.cpp
+ * @brief LZSS payload compression for the TCP send path.
+ */
+
+#include "ESP8266Lzss.h"
+
+ESP8266Lzss::ESP8266Lzss(ESP8266 &esp)
+{
+    _esp = &esp;
+    clearStats();
+}
+
+bool ESP8266Lzss::send(const uint8_t *data, uint32_t len)
+{
+    bool ret = false;
+    uint8_t header[ESP8266_LZSS_HEADER_LEN];
+    int32_t compressed = 0;
+    uint32_t payload = 0;
+    uint32_t start = 0;
+
+    if ((NULL == data) || (0 == len) || (ESP8266_LZSS_MAX_LEN < len))
+    {
+        return false;
+    }
+
+    /* Only worth it if payload gets smaller than data */
+    start = micros();
+    compressed = compress(data, len, _buffer, ((len - 1) < sizeof(_buffer)) ? (len - 1) : sizeof(_buffer));
+    _compressTime += micros() - start;
+
+    header[0] = ESP8266_LZSS_MAGIC;
+    header[1] = (0 < compressed) ? ESP8266_LZSS_COMPRESSED : ESP8266_LZSS_STORED;
+    payload = (0 < compressed) ? (uint32_t) compressed : len;
+    header[2] = (uint8_t) (payload >> 8);
+    header[3] = (uint8_t) payload;
+    header[4] = (uint8_t) (len >> 8);
+    header[5] = (uint8_t) len;
+
+    if (_esp->startSend(ESP8266_LZSS_HEADER_LEN + payload))
+    {
+        _esp->write(header, ESP8266_LZSS_HEADER_LEN);
+        if (ESP8266_LZSS_COMPRESSED == header[1])
+        {
+            _esp->write(_buffer, payload);
+        }
+        else
+        {
+            _esp->write(data, len);
+            _stored++;
+        }
+        ret = _esp->endSendTCP();
+
+        _frames++;
+        _bytesIn += len;
+        _bytesOut += ESP8266_LZSS_HEADER_LEN + payload;
+    }
+
+    return ret;
+}
+
+void ESP8266Lzss::stats(esp8266_lzss_stats_t *dest)
+{
+    if (NULL != dest)
+    {
+        memset((void *) dest, 0, sizeof(esp8266_lzss_stats_t));
+        dest->frames = _frames;
+        dest->stored = _stored;
+        dest->bytesIn = _bytesIn;
+        dest->bytesOut = _bytesOut;
+        dest->compressTime = _compressTime;
+        if (0 < _bytesIn)
+        {
+            dest->ratio = (uint32_t) (((uint64_t) _bytesOut * 100) / _bytesIn);
+            dest->timePerByte = (uint32_t) (((uint64_t) _compressTime * 1000) / _bytesIn);
+        }
+    }
+}
+
+void ESP8266Lzss::clearStats(void)
+{
+    _frames = 0;
+    _stored = 0;
+    _bytesIn = 0;
+    _bytesOut = 0;
+    _compressTime = 0;
+}
+
+int32_t ESP8266Lzss::compress(const uint8_t *src, uint32_t len, uint8_t *dest, uint32_t destLen)
+{
+    /* Flag byte and 8 tokens of up to 2 bytes */
+    uint8_t group[1 + (8 * 2)];
+    uint8_t groupLen = 1;
+    uint8_t tokens = 0;
+    uint32_t out = 0;
+    uint32_t pos = 0;
+    uint32_t best = 0;
+    uint32_t bestDist = 0;
+    uint32_t maxLen = 0;
+    uint32_t n = 0;
+
+    if ((NULL == src) || (NULL == dest))
+    {
+        return -1;
+    }
+
+    group[0] = 0;
+    while (pos < len)
+    {
+        /* Longest match within the window, overlapping the current position is allowed */
+        best = 0;
+        maxLen = ((len - pos) < ESP8266_LZSS_MAX_MATCH) ? (len - pos) : ESP8266_LZSS_MAX_MATCH;
+        for (uint32_t dist = 1; (dist <= ESP8266_LZSS_WINDOW) && (dist <= pos) && (best < maxLen); dist++)
+        {
+            for (n = 0; (n < maxLen) && (src[pos + n] == src[pos - dist + n]); n++)
+            {
+            }
+            if (n > best)
+            {
+                best = n;
+                bestDist = dist;
+            }
+        }
+
+        if (ESP8266_LZSS_MIN_MATCH <= best)
+        {
+            group[groupLen++] = (uint8_t) (bestDist - 1);
+            group[groupLen++] = (uint8_t) (best - ESP8266_LZSS_MIN_MATCH);
+            pos += best;
+        }
+        else
+        {
+            group[0] |= (uint8_t) (1 << tokens);
+            group[groupLen++] = src[pos++];
+        }
+
+        tokens++;
+        if ((8 == tokens) || (pos >= len))
+        {
+            if ((out + groupLen) > destLen)
+            {
+                return -1;
+            }
+            memcpy(&dest[out], group, groupLen);
+            out += groupLen;
+            group[0] = 0;
+            groupLen = 1;
+            tokens = 0;
+        }
+    }
+
+    return (int32_t) out;
+}
+
+int32_t ESP8266Lzss::decompress(const uint8_t *src, uint32_t len, uint8_t *dest, uint32_t destLen)
+{
+    uint32_t idx = 0;
+    uint32_t out = 0;
+    uint32_t dist = 0;
+    uint32_t count = 0;
+    uint8_t flags = 0;
+    uint8_t tokens = 0;
+
+    if ((NULL == src) || (NULL == dest))
+    {
+        return -1;
+    }
+
+    while (idx < len)
+    {
+        if (0 == tokens)
+        {
+            flags = src[idx++];
+            tokens = 8;
+            continue;
+        }
+
+        if (0 != (flags & 0x01))
+        {
+            if (out >= destLen)
+            {
+                return -1;
+            }
+            dest[out++] = src[idx++];
+        }
+        else
+        {
+            if ((idx + 2) > len)
+            {
+                return -1;
+            }
+            dist = (uint32_t) src[idx] + 1;
+            count = (uint32_t) src[idx + 1] + ESP8266_LZSS_MIN_MATCH;
+            idx += 2;
+            if ((dist > out) || ((out + count) > destLen))
+            {
+                return -1;
+            }
+            /* Byte by byte, source may overlap destination */
+            for (; 0 < count; count--, out++)
+            {
+                dest[out] = dest[out - dist];
+            }
+        }
+        flags >>= 1;
+        tokens--;
+    }
+
+    return (int32_t) out;
+}
+
+int32_t ESP8266Lzss::decodeFrame(const uint8_t *frame, uint32_t len, uint8_t *dest, uint32_t destLen)
+{
+    int32_t ret = -1;
+    uint32_t payload = 0;
+    uint32_t original = 0;
+
+    if ((NULL == frame) || (ESP8266_LZSS_HEADER_LEN > len) || (ESP8266_LZSS_MAGIC != frame[0]))
+    {
+        return -1;
+    }
+
+    payload = ((uint32_t) frame[2] << 8) | frame[3];
+    original = ((uint32_t) frame[4] << 8) | frame[5];
+    if (((ESP8266_LZSS_HEADER_LEN + payload) > len) || (original > destLen) || (NULL == dest))
+    {
+        return -1;
+    }
+
+    if ((ESP8266_LZSS_STORED == frame[1]) && (payload == original))
+    {
+        memcpy(dest, &frame[ESP8266_LZSS_HEADER_LEN], payload);
+        ret = (int32_t) payload;
+    }
+    else if (ESP8266_LZSS_COMPRESSED == frame[1])
+    {
+        ret = decompress(&frame[ESP8266_LZSS_HEADER_LEN], payload, dest, original);
+        if ((uint32_t) ret != original)
+        {
+            ret = -1;
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file ESP8266Lzss.h
+ * @brief LZSS payload compression for the TCP send path.
+ */
+
+#ifndef ESP8266_LZSS_H
+#define ESP8266_LZSS_H
+
+#include "ESP8266.h"
+
+#define ESP8266_LZSS_MAGIC        (0x5A)  /* First byte of every frame ('Z') */
+#define ESP8266_LZSS_STORED          (0)  /* Frame method, payload sent as is */
+#define ESP8266_LZSS_COMPRESSED      (1)  /* Frame method, payload compressed */
+#define ESP8266_LZSS_HEADER_LEN      (6)  /* Frame header length */
+#define ESP8266_LZSS_MAX_LEN      (ESP8266_MAX_SEND_LEN - ESP8266_LZSS_HEADER_LEN)  /* Maximum data per frame */
+#define ESP8266_LZSS_WINDOW        (256)  /* Maximum match distance */
+#define ESP8266_LZSS_MIN_MATCH       (3)  /* Shorter matches are sent as literals */
+#define ESP8266_LZSS_MAX_MATCH     (258)  /* Longest match */
+
+/* Compressed payload buffer, can be overridden from build flags */
+#ifndef ESP8266_LZSS_BUFF_LEN
+#define ESP8266_LZSS_BUFF_LEN      (256)
+#endif
+
+/* Compression counters, check ESP8266Lzss::stats() */
+typedef struct
+{
+    uint32_t frames;         /* Frames sent */
+    uint32_t stored;         /* Frames sent uncompressed, data didn't compress */
+    uint32_t bytesIn;        /* Data bytes before compression */
+    uint32_t bytesOut;       /* Bytes sent, headers included */
+    uint32_t ratio;          /* bytesOut / bytesIn (%) */
+    uint32_t compressTime;   /* Time spent compressing (us) */
+    uint32_t timePerByte;    /* compressTime / bytesIn (ns) */
+} esp8266_lzss_stats_t;
+
+/**
+ * Send data compressed with LZSS, one frame per send(), so frames can be
+ * decoded on their own by the server.
+ *
+ * Frame format (lengths big endian):
+ *   byte 0      ESP8266_LZSS_MAGIC
+ *   byte 1      method, ESP8266_LZSS_STORED or ESP8266_LZSS_COMPRESSED
+ *   bytes 2..3  payload length
+ *   bytes 4..5  data length before compression
+ *   payload
+ *
+ * Compressed payload is a sequence of groups, a flag byte followed by up to
+ * 8 tokens, flag bits taken from LSB. Bit set: literal byte. Bit clear:
+ * match of two bytes, (distance - 1) and (length - ESP8266_LZSS_MIN_MATCH),
+ * copying length bytes from distance bytes back in the decoded data.
+ *
+ * Payload is compressed once into an ESP8266_LZSS_BUFF_LEN bytes buffer,
+ * compression stops as soon as it would outgrow the buffer or the data, and
+ * the frame is sent stored. Frames of a few records barely compress, batch
+ * records on each send() and check stats() to see if it pays off, raise
+ * ESP8266_LZSS_BUFF_LEN if bigger batches end up stored.
+ * extras/LzssDecode has a decoder for the server side.
+ */
+class ESP8266Lzss
+{
+    static_assert((ESP8266_LZSS_BUFF_LEN >= 16) && (ESP8266_LZSS_BUFF_LEN <= ESP8266_LZSS_MAX_LEN),
+                  "ESP8266_LZSS_BUFF_LEN must be 16..ESP8266_LZSS_MAX_LEN");
+
+    public:
+        /**
+         * Class constructor
+         *
+         * @param esp - Module used to send the frames.
+         */
+        ESP8266Lzss(ESP8266 &esp);
+
+        /**
+         * Compress data and send it as a frame to current TCP connection.
+         * Data which doesn't get smaller or doesn't fit in the compressed
+         * payload buffer is sent uncompressed.
+         *
+         * @param data - Data to send.
+         * @param len - Data length (max. ESP8266_LZSS_MAX_LEN).
+         *
+         * @retval true - success.
+         * @retval false - failure, connection is closed unless the module stayed
+         * busy after retries (check ESP8266::lastResult()).
+         */
+        bool send(const uint8_t *data, uint32_t len);
+
+        /**
+         * Get compression counters.
+         *
+         * @param dest - Pointer to store counters.
+         */
+        void stats(esp8266_lzss_stats_t *dest);
+
+        /**
+         * Reset compression counters.
+         */
+        void clearStats(void);
+
+        /**
+         * Compress data.
+         *
+         * @param src - Data to compress.
+         * @param len - Data length.
+         * @param dest - Buffer to store compressed data.
+         * @param destLen - Buffer size, compression stops once it's full.
+         *
+         * @retval - Compressed length, -1 if it doesn't fit in dest.
+         */
+        static int32_t compress(const uint8_t *src, uint32_t len, uint8_t *dest, uint32_t destLen);
+
+        /**
+         * Decompress a payload.
+         *
+         * @param src - Compressed payload.
+         * @param len - Payload length.
+         * @param dest - Buffer to store data.
+         * @param destLen - Buffer size.
+         *
+         * @retval - Data length, -1 if payload is corrupted or doesn't fit in dest.
+         */
+        static int32_t decompress(const uint8_t *src, uint32_t len, uint8_t *dest, uint32_t destLen);
+
+        /**
+         * Decode a whole frame.
+         *
+         * @param frame - Frame, header included.
+         * @param len - Frame length.
+         * @param dest - Buffer to store data.
+         * @param destLen - Buffer size.
+         *
+         * @retval - Data length, -1 if frame is invalid or doesn't fit in dest.
+         */
+        static int32_t decodeFrame(const uint8_t *frame, uint32_t len, uint8_t *dest, uint32_t destLen);
+
+    private:
+        ESP8266 *_esp;
+        uint8_t _buffer[ESP8266_LZSS_BUFF_LEN];
+
+        uint32_t _frames;
+        uint32_t _stored;
+        uint32_t _bytesIn;
+        uint32_t _bytesOut;
+        uint32_t _compressTime;
+};
+
+#endif /* ESP8266_LZSS_H */
@@ -0,0 +1,442 @@
+/**
+ * @file ESP8266Mqtt.cpp
+ * @brief Lightweight MQTT 3.1.1 client over the ESP8266 TCP connection.
+ */
+
+#include "ESP8266Mqtt.h"
+
+ESP8266Mqtt::ESP8266Mqtt(ESP8266 &esp)
+{
+    _esp = &esp;
+    _callback = NULL;
+    _connected = false;
+    _txLen = 0;
+    _txFirst = 0;
+    _rxLen = 0;
+    _rxSkip = 0;
+    _lastPacket = 0;
+    _connackCode = 0;
+    _keepAlive = 0;
+    _lastSend = 0;
+    _pingSent = 0;
+    _pingPending = false;
+    _packetId = 0;
+}
+
+bool ESP8266Mqtt::connect(char *server, int port, const char *clientId, uint16_t keepAlive,
+                          const char *user, const char *pass)
+{
+    uint8_t flags = 0x02; /* Clean session */
+    uint16_t remaining = 0;
+
+    _connected = false;
+    _txLen = 0;
+    _rxLen = 0;
+    _rxSkip = 0;
+    _lastPacket = 0;
+    _pingPending = false;
+    _keepAlive = keepAlive;
+
+    if (NULL == clientId)
+    {
+        return false;
+    }
+
+    /* In active mode a packet arriving during AT+CIPSEND would be dropped by the
+     * driver, in passive mode the module holds it until it is read. Firmware
+     * without AT+CIPRECVMODE stays in active mode. */
+    (void) _esp->receiveMode(true);
+
+    if (!_esp->startTCP(server, port))
+    {
+        return false;
+    }
+
+    /* Variable header (10 bytes) + client identifier */
+    remaining = 10 + 2 + strlen(clientId);
+
+    if (NULL != user)
+    {
+        flags |= 0x80;
+        remaining += 2 + strlen(user);
+    }
+    if (NULL != pass)
+    {
+        flags |= 0x40;
+        remaining += 2 + strlen(pass);
+    }
+
+    if (beginPacket(ESP8266_MQTT_CONNECT, remaining))
+    {
+        /* Variable header: protocol name, level 4 (3.1.1), flags, keep alive */
+        appendString("MQTT");
+        _txBuffer[_txLen++] = 0x04;
+        _txBuffer[_txLen++] = flags;
+        appendWord(keepAlive);
+
+        /* Payload */
+        appendString(clientId);
+        if (NULL != user)
+        {
+            appendString(user);
+        }
+        if (NULL != pass)
+        {
+            appendString(pass);
+        }
+
+        if (flush() && waitPacket(ESP8266_MQTT_CONNACK, ESP8266_MQTT_TIMEOUT))
+        {
+            _connected = true;
+        }
+    }
+
+    if (!_connected)
+    {
+        _txLen = 0;
+        _esp->stopTCP();
+    }
+
+    return _connected;
+}
+
+void ESP8266Mqtt::disconnect(void)
+{
+    if (_connected)
+    {
+        (void) flush();
+        if (beginPacket(ESP8266_MQTT_DISCONNECT, 0))
+        {
+            (void) flush();
+        }
+        _esp->stopTCP();
+    }
+    _connected = false;
+    _txLen = 0;
+}
+
+bool ESP8266Mqtt::connected(void)
+{
+    return _connected && _esp->connected();
+}
+
+bool ESP8266Mqtt::subscribe(const char *topic)
+{
+    bool ret = false;
+
+    if (_connected && (NULL != topic))
+    {
+        if (beginPacket(ESP8266_MQTT_SUBSCRIBE, 2 + 2 + strlen(topic) + 1))
+        {
+            _packetId++;
+            if (0 == _packetId)
+            {
+                _packetId = 1;
+            }
+            appendWord(_packetId);
+            appendString(topic);
+            _txBuffer[_txLen++] = 0x00; /* Requested QoS */
+            ret = flush();
+        }
+    }
+
+    return ret;
+}
+
+bool ESP8266Mqtt::publish(const char *topic, const uint8_t *payload, uint16_t len)
+{
+    bool ret = false;
+
+    if (_connected && (NULL != topic) && ((NULL != payload) || (0 == len)))
+    {
+        if (beginPacket(ESP8266_MQTT_PUBLISH, 2 + strlen(topic) + len))
+        {
+            appendString(topic);
+            append(payload, len);
+            ret = true;
+        }
+    }
+
+    return ret;
+}
+
+bool ESP8266Mqtt::publish(const char *topic, const char *payload)
+{
+    return publish(topic, (const uint8_t *) payload, (NULL != payload) ? strlen(payload) : 0);
+}
+
+bool ESP8266Mqtt::flush(void)
+{
+    bool ret = true;
+
+    if (0 < _txLen)
+    {
+        /* Whole batch goes on a single AT+CIPSEND */
+        ret = _esp->send(_txBuffer, _txLen);
+        _txLen = 0;
+        if (ret)
+        {
+            _lastSend = millis();
+        }
+        else
+        {
+            _connected = false;
+        }
+    }
+
+    return ret;
+}
+
+void ESP8266Mqtt::onMessage(esp8266_mqtt_callback_t callback)
+{
+    _callback = callback;
+}
+
+void ESP8266Mqtt::loop(void)
+{
+    uint32_t now = millis();
+
+    if (!_connected)
+    {
+        return;
+    }
+
+    /* Send batch once the window expires */
+    if ((0 < _txLen) && (ESP8266_MQTT_BATCH_MS <= (now - _txFirst)))
+    {
+        (void) flush();
+        /* flush() took time and moved _lastSend past now */
+        now = millis();
+    }
+
+    /* Keep alive, ping when idle for half of the keep alive time */
+    if (_connected && (0 < _keepAlive))
+    {
+        if (_pingPending)
+        {
+            if (((uint32_t) _keepAlive * 1000UL) <= (now - _pingSent))
+            {
+                /* Broker is gone */
+                _connected = false;
+                _esp->stopTCP();
+            }
+        }
+        else if (((uint32_t) _keepAlive * 500UL) <= (now - _lastSend))
+        {
+            if (beginPacket(ESP8266_MQTT_PINGREQ, 0) && flush())
+            {
+                _pingPending = true;
+                _pingSent = now;
+            }
+        }
+    }
+
+    if (_connected)
+    {
+        receive(0);
+    }
+}
+
+/* Private functions */
+
+bool ESP8266Mqtt::beginPacket(uint8_t header, uint16_t remaining)
+{
+    bool ret = false;
+    uint16_t size = 1 + ((128 > remaining) ? 1 : 2) + remaining;
+
+    /* Make room sending what is already queued */
+    if ((ESP8266_MQTT_TX_BUFF_LEN < (_txLen + size)) && (0 < _txLen))
+    {
+        (void) flush();
+    }
+
+    if ((ESP8266_MQTT_TX_BUFF_LEN >= (_txLen + size)) && (16384 > remaining))
+    {
+        if (0 == _txLen)
+        {
+            _txFirst = millis();
+        }
+
+        _txBuffer[_txLen++] = header;
+        if (128 > remaining)
+        {
+            _txBuffer[_txLen++] = (uint8_t) remaining;
+        }
+        else
+        {
+            _txBuffer[_txLen++] = (uint8_t) ((remaining & 0x7F) | 0x80);
+            _txBuffer[_txLen++] = (uint8_t) (remaining >> 7);
+        }
+        ret = true;
+    }
+
+    return ret;
+}
+
+void ESP8266Mqtt::append(const uint8_t *data, uint16_t len)
+{
+    if (0 < len)
+    {
+        memcpy(&_txBuffer[_txLen], data, len);
+        _txLen += len;
+    }
+}
+
+void ESP8266Mqtt::appendString(const char *str)
+{
+    uint16_t len = strlen(str);
+    appendWord(len);
+    append((const uint8_t *) str, len);
+}
+
+void ESP8266Mqtt::appendWord(uint16_t value)
+{
+    _txBuffer[_txLen++] = (uint8_t) (value >> 8);
+    _txBuffer[_txLen++] = (uint8_t) (value & 0xFF);
+}
+
+void ESP8266Mqtt::receive(uint32_t timeout)
+{
+    int32_t count = 0;
+    uint16_t pos = 0;
+    uint32_t remaining = 0;
+    uint8_t lenBytes = 0;
+    bool complete = false;
+    uint16_t total = 0;
+
+    count = _esp->receive(&_rxBuffer[_rxLen], ESP8266_MQTT_RX_BUFF_LEN - _rxLen, timeout);
+    if (0 < count)
+    {
+        _rxLen += (uint16_t) count;
+    }
+
+    /* Drop rest of a packet too big for the buffer */
+    if (0 < _rxSkip)
+    {
+        total = (_rxSkip < _rxLen) ? (uint16_t) _rxSkip : _rxLen;
+        memmove(_rxBuffer, &_rxBuffer[total], _rxLen - total);
+        _rxLen -= total;
+        _rxSkip -= total;
+    }
+
+    do
+    {
+        complete = false;
+
+        /* Decode remaining length */
+        remaining = 0;
+        for (pos = 1, lenBytes = 0; (pos < _rxLen) && (4 > lenBytes); pos++, lenBytes++)
+        {
+            remaining |= (uint32_t) (_rxBuffer[pos] & 0x7F) << (7 * lenBytes);
+            if (0 == (_rxBuffer[pos] & 0x80))
+            {
+                complete = true;
+                pos++;
+                break;
+            }
+        }
+
+        if (complete)
+        {
+            if ((pos + remaining) > ESP8266_MQTT_RX_BUFF_LEN)
+            {
+                /* Packet doesn't fit, skip it */
+                _rxSkip = (pos + remaining) - _rxLen;
+                _rxLen = 0;
+                complete = false;
+            }
+            else if ((pos + remaining) <= _rxLen)
+            {
+                total = pos + (uint16_t) remaining;
+                handlePacket(_rxBuffer[0], &_rxBuffer[pos], (uint16_t) remaining);
+                memmove(_rxBuffer, &_rxBuffer[total], _rxLen - total);
+                _rxLen -= total;
+            }
+            else
+            {
+                /* Wait for the rest of the packet */
+                complete = false;
+            }
+        }
+        else if (4 <= lenBytes)
+        {
+            /* Malformed length, resynchronization is not possible */
+            _rxLen = 0;
+            _connected = false;
+            _esp->stopTCP();
+        }
+    } while (complete && (0 < _rxLen));
+}
+
+void ESP8266Mqtt::handlePacket(uint8_t header, uint8_t *packet, uint16_t len)
+{
+    uint16_t topicLen = 0;
+    uint16_t offset = 0;
+    uint8_t qos = 0;
+    uint8_t ack[4];
+
+    _lastPacket = header & 0xF0;
+
+    switch (_lastPacket)
+    {
+        case ESP8266_MQTT_CONNACK:
+            /* Return code 0 means connection accepted, anything else ends the wait too */
+            _connackCode = (2 > len) ? 0xFF : packet[1];
+            break;
+
+        case ESP8266_MQTT_PINGRESP:
+            _pingPending = false;
+            break;
+
+        case ESP8266_MQTT_PUBLISH:
+            if (2 <= len)
+            {
+                qos = (header >> 1) & 0x03;
+                topicLen = ((uint16_t) packet[0] << 8) | packet[1];
+                offset = 2 + topicLen + ((0 < qos) ? 2 : 0);
+                if (offset <= len)
+                {
+                    if (0 < qos)
+                    {
+                        /* Acknowledge QoS1, QoS2 is not supported by this client */
+                        ack[0] = ESP8266_MQTT_PUBACK;
+                        ack[1] = 0x02;
+                        ack[2] = packet[2 + topicLen];
+                        ack[3] = packet[3 + topicLen];
+                        if (beginPacket(ack[0], 2))
+                        {
+                            append(&ack[2], 2);
+                        }
+                    }
+
+                    if (NULL != _callback)
+                    {
+                        /* Move topic over its length field to make room for NULL terminator */
+                        memmove(packet, &packet[2], topicLen);
+                        packet[topicLen] = '\0';
+                        _callback((const char *) packet, &packet[offset], len - offset);
+                    }
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool ESP8266Mqtt::waitPacket(uint8_t type, uint32_t timeout)
+{
+    uint32_t ulStartTime = millis();
+    uint32_t elapsed = 0;
+
+    _lastPacket = 0;
+    _connackCode = 0;
+    while ((type != _lastPacket) && (timeout > elapsed))
+    {
+        receive(timeout - elapsed);
+        elapsed = millis() - ulStartTime;
+    }
+
+    return (type == _lastPacket) && ((ESP8266_MQTT_CONNACK != type) || (0 == _connackCode));
+}
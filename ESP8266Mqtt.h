@@ -0,0 +1,193 @@
+/**
+ * @file ESP8266Mqtt.h
+ * @brief Lightweight MQTT 3.1.1 client over the ESP8266 TCP connection.
+ */
+
+#ifndef ESP8266_MQTT_H
+#define ESP8266_MQTT_H
+
+#include "ESP8266.h"
+
+#ifndef ESP8266_MQTT_TX_BUFF_LEN
+#define ESP8266_MQTT_TX_BUFF_LEN   (128)  /* Outgoing packets buffer, QoS0 publishes are batched here */
+#endif
+#ifndef ESP8266_MQTT_RX_BUFF_LEN
+#define ESP8266_MQTT_RX_BUFF_LEN   (128)  /* Incoming packets buffer, bigger packets are dropped */
+#endif
+#define ESP8266_MQTT_BATCH_MS       (20)  /* Time to wait for more publishes before sending a batch */
+#define ESP8266_MQTT_TIMEOUT      (3000)  /* Timeout for CONNACK */
+
+/* MQTT control packet types (upper nibble of fixed header) */
+#define ESP8266_MQTT_CONNECT      (0x10)
+#define ESP8266_MQTT_CONNACK      (0x20)
+#define ESP8266_MQTT_PUBLISH      (0x30)
+#define ESP8266_MQTT_PUBACK       (0x40)
+#define ESP8266_MQTT_SUBSCRIBE    (0x82)
+#define ESP8266_MQTT_SUBACK       (0x90)
+#define ESP8266_MQTT_PINGREQ      (0xC0)
+#define ESP8266_MQTT_PINGRESP     (0xD0)
+#define ESP8266_MQTT_DISCONNECT   (0xE0)
+
+/* Incoming PUBLISH callback, topic is NULL terminated, payload is not */
+typedef void (*esp8266_mqtt_callback_t)(const char *topic, const uint8_t *payload, uint16_t len);
+
+class ESP8266Mqtt
+{
+    /* Remaining length is encoded on up to two bytes, buffer lengths are kept on uint16_t */
+    static_assert((ESP8266_MQTT_TX_BUFF_LEN >= 32) && (ESP8266_MQTT_TX_BUFF_LEN <= 16384), "ESP8266_MQTT_TX_BUFF_LEN must be 32..16384");
+    static_assert((ESP8266_MQTT_RX_BUFF_LEN >= 4) && (ESP8266_MQTT_RX_BUFF_LEN <= 65535), "ESP8266_MQTT_RX_BUFF_LEN must be 4..65535");
+
+    public:
+        /**
+         * Class constructor
+         *
+         * @param esp - ESP8266 module used for the TCP connection.
+         */
+        ESP8266Mqtt(ESP8266 &esp);
+
+        /**
+         * Open TCP connection to broker and send CONNECT (clean session).
+         *
+         * Module is switched to passive receive mode (AT+CIPRECVMODE=1), so
+         * broker packets arriving while a batch or a PINGREQ is being sent are
+         * kept by the module instead of being lost. It is left in that mode.
+         *
+         * @param server - Broker address.
+         * @param port - Broker port.
+         * @param clientId - MQTT client identifier.
+         * @param keepAlive - Keep alive in seconds, 0 to disable.
+         * @param user - User name (can be NULL).
+         * @param pass - Password (can be NULL).
+         *
+         * @retval true - CONNACK accepted.
+         * @retval false - failure.
+         */
+        bool connect(char *server, int port, const char *clientId, uint16_t keepAlive = 60,
+                     const char *user = NULL, const char *pass = NULL);
+
+        /**
+         * Send DISCONNECT and close TCP connection.
+         */
+        void disconnect(void);
+
+        /**
+         * Check MQTT session status.
+         *
+         * @retval true - connected.
+         * @retval false - disconnected.
+         */
+        bool connected(void);
+
+        /**
+         * Subscribe to a topic with QoS0, packet is sent immediately.
+         *
+         * @param topic - Topic filter.
+         *
+         * @retval true - success.
+         * @retval false - failure.
+         */
+        bool subscribe(const char *topic);
+
+        /**
+         * Queue a QoS0 publish.
+         *
+         * Publishes queued within ESP8266_MQTT_BATCH_MS are sent together on a
+         * single AT+CIPSEND by loop(), or earlier if the buffer gets full.
+         *
+         * @param topic - Topic name.
+         * @param payload - Message payload.
+         * @param len - Payload length.
+         *
+         * @retval true - queued.
+         * @retval false - failure, message doesn't fit on ESP8266_MQTT_TX_BUFF_LEN.
+         */
+        bool publish(const char *topic, const uint8_t *payload, uint16_t len);
+        bool publish(const char *topic, const char *payload);
+
+        /**
+         * Send every queued packet now.
+         *
+         * @retval true - success (or nothing to send).
+         * @retval false - failure.
+         */
+        bool flush(void);
+
+        /**
+         * Set callback for incoming PUBLISH messages.
+         *
+         * @param callback - Function to call, NULL to disable.
+         */
+        void onMessage(esp8266_mqtt_callback_t callback);
+
+        /**
+         * Process client, should be called often: sends batched publishes,
+         * handles PINGREQ keep alive and delivers incoming messages.
+         */
+        void loop(void);
+
+    private:
+        ESP8266 *_esp;
+        esp8266_mqtt_callback_t _callback;
+        bool _connected;
+
+        /* Outgoing batch */
+        uint8_t _txBuffer[ESP8266_MQTT_TX_BUFF_LEN];
+        uint16_t _txLen;
+        uint32_t _txFirst;
+
+        /* Incoming packets */
+        uint8_t _rxBuffer[ESP8266_MQTT_RX_BUFF_LEN];
+        uint16_t _rxLen;
+        uint32_t _rxSkip;
+        uint8_t _lastPacket;
+        uint8_t _connackCode;    /* Return code of last CONNACK */
+
+        /* Keep alive */
+        uint16_t _keepAlive;
+        uint32_t _lastSend;
+        uint32_t _pingSent;
+        bool _pingPending;
+
+        uint16_t _packetId;
+
+        /**
+         * Append fixed header to tx buffer.
+         *
+         * @retval true - success.
+         * @retval false - packet doesn't fit.
+         */
+        bool beginPacket(uint8_t header, uint16_t remaining);
+
+        /**
+         * Append data to tx buffer, space must be checked by beginPacket().
+         */
+        void append(const uint8_t *data, uint16_t len);
+        void appendString(const char *str);
+        void appendWord(uint16_t value);
+
+        /**
+         * Receive and process every complete packet.
+         *
+         * @param timeout - Time to wait for data, 0 only takes data already received.
+         */
+        void receive(uint32_t timeout);
+
+        /**
+         * Process a complete packet.
+         *
+         * @param packet - Pointer to first byte of variable header.
+         * @param header - Fixed header first byte.
+         * @param len - Remaining length.
+         */
+        void handlePacket(uint8_t header, uint8_t *packet, uint16_t len);
+
+        /**
+         * Wait for a packet type.
+         *
+         * @retval true - packet received.
+         * @retval false - timeout or connection refused.
+         */
+        bool waitPacket(uint8_t type, uint32_t timeout);
+};
+
+#endif /* ESP8266_MQTT_H */
@@ -0,0 +1,156 @@
+/**
+ * @file ESP8266Ping.cpp
+ * @brief Network latency probe, ping series with RTT statistics.
+ */
+
+#include "ESP8266Ping.h"
+
+ESP8266PingProbe::ESP8266PingProbe(ESP8266 &esp)
+{
+    _esp = &esp;
+    _address = NULL;
+    _count = 0;
+    _interval = 0;
+    _pinging = false;
+    _lost = false;
+    _lastStart = 0;
+    _sent = 0;
+    _received = 0;
+    _min = 0;
+    _max = 0;
+    _sum = 0;
+    _last = 0;
+    _jitterSum = 0;
+}
+
+bool ESP8266PingProbe::run(char *address, uint16_t count, uint32_t interval)
+{
+    if (start(address, count, interval))
+    {
+        while (poll())
+        {
+            /* Wait for series to complete */
+        }
+    }
+    return (0 < _received);
+}
+
+bool ESP8266PingProbe::start(char *address, uint16_t count, uint32_t interval)
+{
+    bool ret = false;
+
+    if ((NULL != address) && (0 < count) && !_pinging)
+    {
+        _address = address;
+        _count = count;
+        _interval = interval;
+        _sent = 0;
+        _received = 0;
+        _sum = 0;
+        _jitterSum = 0;
+        ret = true;
+    }
+
+    return ret;
+}
+
+bool ESP8266PingProbe::poll(void)
+{
+    uint32_t now = millis();
+    uint32_t rtt = 0;
+    int8_t result = 0;
+
+    if (_pinging)
+    {
+        result = _esp->pingResult(&rtt);
+        if (ESP8266::ESP8266_CMD_RSP_WAIT != result)
+        {
+            /* A reply after the timeout is not credited, the ping is already lost */
+            if ((0 < result) && !_lost)
+            {
+                addSample(rtt);
+            }
+            _pinging = false;
+        }
+        else if (!_lost && (ESP8266_PING_TIMEOUT <= (now - _lastStart)))
+        {
+            /* Lost, but the module is still on it: wait for its OK/ERROR before the next ping */
+            _lost = true;
+        }
+        else if (_lost && ((2 * ESP8266_PING_TIMEOUT) <= (now - _lastStart)))
+        {
+            /* No final response at all, module is hung */
+            _pinging = false;
+        }
+    }
+
+    if (!_pinging && (_sent < _count))
+    {
+        if ((0 == _sent) || (_interval <= (now - _lastStart)))
+        {
+            _lastStart = now;
+            _lost = false;
+            _pinging = _esp->pingStart(_address);
+            _sent++;
+        }
+    }
+
+    return _pinging || (_sent < _count);
+}
+
+bool ESP8266PingProbe::busy(void)
+{
+    return _pinging;
+}
+
+void ESP8266PingProbe::stats(esp8266_ping_stats_t *dest)
+{
+    uint16_t done = (_pinging && !_lost) ? (_sent - 1) : _sent;
+
+    if (NULL != dest)
+    {
+        memset((void *) dest, 0, sizeof(esp8266_ping_stats_t));
+        dest->sent = done;
+        dest->received = _received;
+        if (0 < done)
+        {
+            dest->loss = (uint8_t) (((uint32_t) (done - _received) * 100) / done);
+        }
+        if (0 < _received)
+        {
+            dest->min = _min;
+            dest->avg = _sum / _received;
+            dest->max = _max;
+        }
+        if (1 < _received)
+        {
+            dest->jitter = _jitterSum / (_received - 1);
+        }
+    }
+}
+
+/* Private functions */
+
+void ESP8266PingProbe::addSample(uint32_t rtt)
+{
+    if (0 == _received)
+    {
+        _min = rtt;
+        _max = rtt;
+    }
+    else
+    {
+        _jitterSum += (rtt > _last) ? (rtt - _last) : (_last - rtt);
+        if (rtt < _min)
+        {
+            _min = rtt;
+        }
+        if (rtt > _max)
+        {
+            _max = rtt;
+        }
+    }
+    _sum += rtt;
+    _last = rtt;
+    _received++;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file ESP8266Ping.h
+ * @brief Network latency probe, ping series with RTT statistics.
+ */
+
+#ifndef ESP8266_PING_H
+#define ESP8266_PING_H
+
+#include "ESP8266.h"
+
+/* Ping series statistics, check ESP8266PingProbe::stats() */
+typedef struct
+{
+    uint16_t sent;           /* Pings sent */
+    uint16_t received;       /* Replies received */
+    uint8_t loss;            /* Lost pings (%) */
+    uint32_t min;            /* Minimum round trip time (ms) */
+    uint32_t avg;            /* Average round trip time (ms) */
+    uint32_t max;            /* Maximum round trip time (ms) */
+    uint32_t jitter;         /* Mean difference between consecutive round trip times (ms) */
+} esp8266_ping_stats_t;
+
+/**
+ * Run a series of pings to an IP address or host and compute min/avg/max
+ * round trip time, jitter and loss.
+ *
+ * A series can run blocking with run(), or in the background with start()
+ * and poll() called from loop(), so it can be interleaved with other work
+ * on the same module between pings.
+ */
+class ESP8266PingProbe
+{
+    public:
+        /**
+         * Class constructor
+         *
+         * @param esp - Module used to send the pings.
+         */
+        ESP8266PingProbe(ESP8266 &esp);
+
+        /**
+         * Run a series of pings, blocking until it's done.
+         *
+         * @param address - Server or IP address, must remain valid during the series.
+         * @param count - Number of pings.
+         * @param interval - Time between pings (ms).
+         *
+         * @retval true - at least one reply received.
+         * @retval false - all pings lost.
+         */
+        bool run(char *address, uint16_t count, uint32_t interval = 1000);
+
+        /**
+         * Start a series of pings in the background, check poll().
+         *
+         * @param address - Server or IP address, must remain valid during the series.
+         * @param count - Number of pings.
+         * @param interval - Time between pings (ms).
+         *
+         * @retval true - series started.
+         * @retval false - invalid arguments.
+         */
+        bool start(char *address, uint16_t count, uint32_t interval = 1000);
+
+        /**
+         * Advance series in progress, never blocks.
+         *
+         * @retval true - series in progress.
+         * @retval false - series done.
+         */
+        bool poll(void);
+
+        /**
+         * Check if a ping is waiting for its reply, no other command can be sent
+         * to the module meanwhile.
+         *
+         * @retval true - module in use by the probe.
+         * @retval false - module can be used.
+         */
+        bool busy(void);
+
+        /**
+         * Get statistics of current or last series.
+         *
+         * @param dest - Pointer to store statistics.
+         */
+        void stats(esp8266_ping_stats_t *dest);
+
+    private:
+        ESP8266 *_esp;
+        char *_address;
+        uint16_t _count;
+        uint32_t _interval;
+        bool _pinging;
+        bool _lost;              /* Ping in progress timed out, waiting for its final response */
+        uint32_t _lastStart;
+
+        uint16_t _sent;
+        uint16_t _received;
+        uint32_t _min;
+        uint32_t _max;
+        uint32_t _sum;
+        uint32_t _last;
+        uint32_t _jitterSum;
+
+        void addSample(uint32_t rtt);
+};
+
+#endif /* ESP8266_PING_H */
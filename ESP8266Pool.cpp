@@ -0,0 +1,269 @@
+/**
+ * @file ESP8266Pool.cpp
+ * @brief Pool of ESP8266 modules with load-balanced TCP connections.
+ */
+
+#include "ESP8266Pool.h"
+
+ESP8266Pool::ESP8266Pool(void)
+{
+    _count = 0;
+    _failovers = 0;
+    for (uint8_t i = 0; i < ESP8266_POOL_MAX_MODULES; i++)
+    {
+        _modules[i] = NULL;
+        _healthy[i] = false;
+    }
+    for (uint8_t i = 0; i < ESP8266_POOL_MAX_LINKS; i++)
+    {
+        _links[i].server = NULL;
+        _links[i].port = 0;
+        _links[i].module = -1;
+    }
+}
+
+bool ESP8266Pool::add(ESP8266 &module)
+{
+    bool ret = false;
+    if (ESP8266_POOL_MAX_MODULES > _count)
+    {
+        _modules[_count] = &module;
+        _healthy[_count] = true;
+        _count++;
+        ret = true;
+    }
+    return ret;
+}
+
+uint8_t ESP8266Pool::size(void)
+{
+    return _count;
+}
+
+uint8_t ESP8266Pool::healthy(void)
+{
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        if (_healthy[i])
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+int8_t ESP8266Pool::startTCP(char *server, int port)
+{
+    int8_t link = ESP8266_POOL_INVALID_LINK;
+
+    if (NULL != server)
+    {
+        /* Look for a free link slot */
+        for (int8_t i = 0; i < ESP8266_POOL_MAX_LINKS; i++)
+        {
+            if (NULL == _links[i].server)
+            {
+                link = i;
+                break;
+            }
+        }
+
+        if (ESP8266_POOL_INVALID_LINK != link)
+        {
+            _links[link].server = server;
+            _links[link].port = port;
+            _links[link].module = -1;
+            if (!openLink(link))
+            {
+                _links[link].server = NULL;
+                link = ESP8266_POOL_INVALID_LINK;
+            }
+        }
+    }
+
+    return link;
+}
+
+bool ESP8266Pool::send(int8_t link, String data)
+{
+    bool ret = false;
+
+    if (validLink(link))
+    {
+        ESP8266 *esp = _modules[_links[link].module];
+        ret = esp->send(data);
+        if (!ret && (ESP8266::ESP8266_CMD_RSP_BUSY != esp->lastResult()))
+        {
+            /* Connection is still open when data was written but not confirmed */
+            if (esp->connected())
+            {
+                esp->stopTCP();
+            }
+
+            /* Module failed, move link */
+            _healthy[_links[link].module] = false;
+            _links[link].module = -1;
+            if (openLink(link))
+            {
+                _failovers++;
+                ret = _modules[_links[link].module]->send(data);
+            }
+        }
+    }
+
+    return ret;
+}
+
+bool ESP8266Pool::stopTCP(int8_t link)
+{
+    bool ret = false;
+
+    if ((0 <= link) && (ESP8266_POOL_MAX_LINKS > link) && (NULL != _links[link].server))
+    {
+        if (0 <= _links[link].module)
+        {
+            ret = _modules[_links[link].module]->stopTCP();
+        }
+        _links[link].server = NULL;
+        _links[link].module = -1;
+    }
+
+    return ret;
+}
+
+ESP8266* ESP8266Pool::module(int8_t link)
+{
+    ESP8266 *esp = NULL;
+    if (validLink(link))
+    {
+        esp = _modules[_links[link].module];
+    }
+    return esp;
+}
+
+uint8_t ESP8266Pool::check(void)
+{
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        _healthy[i] = _modules[i]->test();
+        if (!_healthy[i])
+        {
+            /* Give module a chance to recover */
+            _healthy[i] = _modules[i]->recover();
+        }
+    }
+
+    /* Move connections whose module went down, lost its link or failed a previous failover */
+    for (int8_t link = 0; link < ESP8266_POOL_MAX_LINKS; link++)
+    {
+        int8_t idx = _links[link].module;
+        if (NULL != _links[link].server)
+        {
+            if ((0 > idx) || !_healthy[idx] || !_modules[idx]->connected())
+            {
+                _links[link].module = -1;
+                if (openLink(link))
+                {
+                    _failovers++;
+                }
+            }
+        }
+    }
+
+    return healthy();
+}
+
+void ESP8266Pool::metrics(esp8266_metrics_t *dest)
+{
+    esp8266_metrics_t current;
+
+    if (NULL != dest)
+    {
+        memset((void *) dest, 0, sizeof(esp8266_metrics_t));
+        for (uint8_t i = 0; i < _count; i++)
+        {
+            _modules[i]->metrics(&current);
+            dest->commands += current.commands;
+            dest->timeouts += current.timeouts;
+            dest->errors += current.errors;
+            dest->busy += current.busy;
+            dest->resets += current.resets;
+            dest->bytesSent += current.bytesSent;
+            dest->bytesReceived += current.bytesReceived;
+            dest->recoveries += current.recoveries;
+            dest->recoveryFailures += current.recoveryFailures;
+            dest->downtime += current.downtime;
+            dest->retries += current.retries;
+        }
+        if (0 < dest->recoveries)
+        {
+            dest->meanTimeToRecovery = dest->downtime / dest->recoveries;
+        }
+    }
+}
+
+uint32_t ESP8266Pool::failovers(void)
+{
+    return _failovers;
+}
+
+/* Private functions */
+
+int8_t ESP8266Pool::leastLoaded(void)
+{
+    int8_t best = -1;
+    uint32_t bestLoad = 0;
+    esp8266_metrics_t current;
+
+    for (int8_t i = 0; i < (int8_t) _count; i++)
+    {
+        /* Only healthy modules without an open connection can take a new one */
+        if (_healthy[i] && !_modules[i]->connected())
+        {
+            /* Spread traffic by bytes already sent through each module */
+            _modules[i]->metrics(&current);
+            if ((-1 == best) || (current.bytesSent < bestLoad))
+            {
+                best = i;
+                bestLoad = current.bytesSent;
+            }
+        }
+    }
+
+    return best;
+}
+
+bool ESP8266Pool::openLink(int8_t link)
+{
+    bool ret = false;
+    int8_t idx = leastLoaded();
+
+    while ((-1 != idx) && !ret)
+    {
+        ret = _modules[idx]->startTCP(_links[link].server, _links[link].port);
+        if (ret)
+        {
+            _links[link].module = idx;
+        }
+        else if (_modules[idx]->test())
+        {
+            /* Module is fine, server refused the connection or isn't reachable */
+            idx = -1;
+        }
+        else
+        {
+            /* Try with next module */
+            _healthy[idx] = false;
+            idx = leastLoaded();
+        }
+    }
+
+    return ret;
+}
+
+bool ESP8266Pool::validLink(int8_t link)
+{
+    return ((0 <= link) && (ESP8266_POOL_MAX_LINKS > link) &&
+            (NULL != _links[link].server) && (0 <= _links[link].module));
+}
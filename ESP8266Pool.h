@@ -0,0 +1,164 @@
+/**
+ * @file ESP8266Pool.h
+ * @brief Pool of ESP8266 modules with load-balanced TCP connections.
+ */
+
+#ifndef ESP8266_POOL_H
+#define ESP8266_POOL_H
+
+#include "ESP8266.h"
+
+#ifndef ESP8266_POOL_MAX_MODULES
+#define ESP8266_POOL_MAX_MODULES    (4)  /* Maximum modules handled by one pool */
+#endif
+#define ESP8266_POOL_MAX_LINKS      ESP8266_POOL_MAX_MODULES  /* One connection per module */
+#define ESP8266_POOL_INVALID_LINK  (-1)  /* Returned when no connection could be opened */
+
+class ESP8266Pool
+{
+    /* Module and link indexes are kept on int8_t */
+    static_assert((ESP8266_POOL_MAX_MODULES >= 1) && (ESP8266_POOL_MAX_MODULES <= 127), "ESP8266_POOL_MAX_MODULES must be 1..127");
+
+    public:
+        /**
+         * Class constructor
+         */
+        ESP8266Pool(void);
+
+        /**
+         * Add a module to the pool, module must be already started with begin().
+         *
+         * @param module - ESP8266 module to add.
+         *
+         * @retval true - success.
+         * @retval false - pool is full.
+         */
+        bool add(ESP8266 &module);
+
+        /**
+         * Get number of modules in the pool.
+         *
+         * @retval - Number of modules.
+         */
+        uint8_t size(void);
+
+        /**
+         * Get number of modules currently marked as healthy.
+         *
+         * @retval - Number of healthy modules.
+         */
+        uint8_t healthy(void);
+
+        /**
+         * Open a TCP connection on the least loaded healthy module.
+         *
+         * If the selected module fails to connect and doesn't answer an AT test
+         * it is marked as unhealthy and the next least loaded module is tried.
+         * A module answering the test means the server refused the connection
+         * (or isn't reachable), other modules are not tried.
+         *
+         * @param server - Server address to connect, must remain valid while the connection is open.
+         * @param port - Server port to connect.
+         *
+         * @retval - Connection handle, ESP8266_POOL_INVALID_LINK if no module could connect.
+         */
+        int8_t startTCP(char *server, int port);
+
+        /**
+         * Send data through a pool connection.
+         *
+         * If the module serving the connection fails (i.e. it was reset), the
+         * connection is closed there, re-opened on another module and data is
+         * sent again. A module still busy after its retries keeps the connection.
+         *
+         * When the module took the data but never confirmed it (no "SEND OK"),
+         * the server may already have it and receives it twice.
+         *
+         * @param link - Connection handle returned by startTCP().
+         * @param data - Data to send.
+         *
+         * @retval true - success.
+         * @retval false - failure.
+         */
+        bool send(int8_t link, String data);
+
+        /**
+         * Close a pool connection.
+         *
+         * @param link - Connection handle returned by startTCP().
+         *
+         * @retval true - success.
+         * @retval false - failure.
+         */
+        bool stopTCP(int8_t link);
+
+        /**
+         * Get module currently serving a connection.
+         *
+         * @param link - Connection handle returned by startTCP().
+         *
+         * @retval - Pointer to module, NULL if connection is not open.
+         */
+        ESP8266* module(int8_t link);
+
+        /**
+         * Test every module, unhealthy modules go through ESP8266::recover()
+         * and are restored to the pool if they answer afterwards.
+         *
+         * @retval - Number of healthy modules.
+         */
+        uint8_t check(void);
+
+        /**
+         * Get metrics aggregated across all modules in the pool.
+         *
+         * @param dest - Pointer to store aggregated metrics.
+         */
+        void metrics(esp8266_metrics_t *dest);
+
+        /**
+         * Get number of connections moved to another module after a failure.
+         *
+         * @retval - Number of failovers.
+         */
+        uint32_t failovers(void);
+
+    private:
+        typedef struct
+        {
+            char *server;
+            int port;
+            int8_t module;
+        } pool_link_t;
+
+        ESP8266* _modules[ESP8266_POOL_MAX_MODULES];
+        bool _healthy[ESP8266_POOL_MAX_MODULES];
+        uint8_t _count;
+
+        pool_link_t _links[ESP8266_POOL_MAX_LINKS];
+        uint32_t _failovers;
+
+        /**
+         * Get least loaded healthy module without an open connection.
+         *
+         * @retval - Module index, -1 if none available.
+         */
+        int8_t leastLoaded(void);
+
+        /**
+         * Open connection on the best available module for a link slot.
+         *
+         * @param link - Link slot to (re)open.
+         *
+         * @retval true - success.
+         * @retval false - no module could connect, or the server refused the connection.
+         */
+        bool openLink(int8_t link);
+
+        /**
+         * Validate connection handle.
+         */
+        bool validLink(int8_t link);
+};
+
+#endif /* ESP8266_POOL_H */
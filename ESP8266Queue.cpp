@@ -0,0 +1,243 @@
+/**
+ * @file ESP8266Queue.cpp
+ * @brief Store-and-forward record queue, flushed in batches when the link is up.
+ */
+
+#include "ESP8266Queue.h"
+
+ESP8266RamStore::ESP8266RamStore(uint8_t *buffer, uint16_t size)
+{
+    _buffer = buffer;
+    _size = size;
+    _head = 0;
+    _tail = 0;
+    _used = 0;
+    _count = 0;
+    _cursorIndex = 0;
+    _cursorPos = 0;
+}
+
+bool ESP8266RamStore::push(const uint8_t *record, uint16_t len)
+{
+    if (((uint32_t) _size - _used) < ((uint32_t) len + 2))
+    {
+        return false;
+    }
+
+    _buffer[_head] = (uint8_t) len;
+    _head = (uint16_t) ((_head + 1) % _size);
+    _buffer[_head] = (uint8_t) (len >> 8);
+    _head = (uint16_t) ((_head + 1) % _size);
+    for (uint16_t i = 0; i < len; i++)
+    {
+        _buffer[_head] = record[i];
+        _head = (uint16_t) ((_head + 1) % _size);
+    }
+    _used += len + 2;
+    _count++;
+
+    return true;
+}
+
+uint16_t ESP8266RamStore::count(void)
+{
+    return _count;
+}
+
+uint16_t ESP8266RamStore::maxLength(void)
+{
+    return (uint16_t) (_size - 2);
+}
+
+int32_t ESP8266RamStore::length(uint16_t index)
+{
+    int32_t pos = seek(index);
+
+    if (0 > pos)
+    {
+        return -1;
+    }
+    return (int32_t) at(pos) | ((int32_t) at(pos + 1) << 8);
+}
+
+bool ESP8266RamStore::write(uint16_t index, Print &dest)
+{
+    int32_t pos = seek(index);
+    uint16_t len = 0;
+    uint16_t part = 0;
+
+    if (0 > pos)
+    {
+        return false;
+    }
+
+    len = (uint16_t) (at(pos) | (at(pos + 1) << 8));
+    pos = (pos + 2) % _size;
+
+    /* Up to two contiguous pieces, record may wrap around the end of the buffer */
+    while (0 < len)
+    {
+        part = ((uint32_t) pos + len > _size) ? (uint16_t) (_size - pos) : len;
+        dest.write(&_buffer[pos], part);
+        len -= part;
+        pos = (pos + part) % _size;
+    }
+
+    return true;
+}
+
+void ESP8266RamStore::pop(uint16_t count)
+{
+    uint16_t len = 0;
+
+    for (; (0 < count) && (0 < _count); count--)
+    {
+        len = (uint16_t) (at(_tail) | (at(_tail + 1) << 8));
+        _tail = (uint16_t) (((uint32_t) _tail + len + 2) % _size);
+        _used -= len + 2;
+        _count--;
+    }
+    _cursorIndex = 0;
+    _cursorPos = _tail;
+}
+
+/* Private functions */
+
+int32_t ESP8266RamStore::seek(uint16_t index)
+{
+    uint16_t len = 0;
+
+    if (index >= _count)
+    {
+        return -1;
+    }
+
+    if (index < _cursorIndex)
+    {
+        _cursorIndex = 0;
+        _cursorPos = _tail;
+    }
+    while (_cursorIndex < index)
+    {
+        len = (uint16_t) (at(_cursorPos) | (at(_cursorPos + 1) << 8));
+        _cursorPos = (uint16_t) (((uint32_t) _cursorPos + len + 2) % _size);
+        _cursorIndex++;
+    }
+
+    return (int32_t) _cursorPos;
+}
+
+uint8_t ESP8266RamStore::at(uint32_t pos)
+{
+    return _buffer[pos % _size];
+}
+
+ESP8266Queue::ESP8266Queue(ESP8266 &esp, ESP8266RecordStore &store, uint8_t policy)
+{
+    _esp = &esp;
+    _store = &store;
+    _policy = policy;
+    clearStats();
+}
+
+bool ESP8266Queue::push(const uint8_t *record, uint16_t len)
+{
+    bool ret = false;
+
+    if ((NULL != record) && (0 < len) && (ESP8266_MAX_SEND_LEN >= len) && (_store->maxLength() >= len))
+    {
+        ret = _store->push(record, len);
+        while (!ret && (ESP8266_QUEUE_DROP_OLDEST == _policy) && (0 < _store->count()))
+        {
+            _store->pop(1);
+            _dropped++;
+            ret = _store->push(record, len);
+        }
+    }
+
+    if (ret)
+    {
+        _queued++;
+    }
+    else
+    {
+        _dropped++;
+    }
+
+    return ret;
+}
+
+uint16_t ESP8266Queue::flush(void)
+{
+    uint16_t sent = 0;
+    uint16_t records = 0;
+    uint32_t len = 0;
+    int32_t recordLen = 0;
+    bool ok = true;
+
+    while (ok && _esp->connected() && (0 < _store->count()))
+    {
+        /* As many records as fit on one AT+CIPSEND */
+        len = 0;
+        for (records = 0; records < _store->count(); records++)
+        {
+            recordLen = _store->length(records);
+            if ((0 > recordLen) || ((len + recordLen) > ESP8266_MAX_SEND_LEN))
+            {
+                break;
+            }
+            len += (uint32_t) recordLen;
+        }
+
+        ok = (0 < records) && _esp->startSend(len);
+        if (ok)
+        {
+            for (uint16_t i = 0; i < records; i++)
+            {
+                (void) _store->write(i, *_esp);
+            }
+            ok = _esp->endSendTCP();
+        }
+
+        if (ok)
+        {
+            _store->pop(records);
+            _flushed += records;
+            _batches++;
+            sent += records;
+        }
+    }
+
+    return sent;
+}
+
+uint16_t ESP8266Queue::pending(void)
+{
+    return _store->count();
+}
+
+void ESP8266Queue::setOverflowPolicy(uint8_t policy)
+{
+    _policy = policy;
+}
+
+void ESP8266Queue::stats(esp8266_queue_stats_t *dest)
+{
+    if (NULL != dest)
+    {
+        memset((void *) dest, 0, sizeof(esp8266_queue_stats_t));
+        dest->queued = _queued;
+        dest->flushed = _flushed;
+        dest->dropped = _dropped;
+        dest->batches = _batches;
+        dest->pending = _store->count();
+    }
+}
+
+void ESP8266Queue::clearStats(void)
+{
+    _queued = 0;
+    _flushed = 0;
+    _dropped = 0;
+    _batches = 0;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file ESP8266Queue.h
+ * @brief Store-and-forward record queue, flushed in batches when the link is up.
+ */
+
+#ifndef ESP8266_QUEUE_H
+#define ESP8266_QUEUE_H
+
+#include "ESP8266.h"
+
+#define ESP8266_QUEUE_DROP_OLDEST   (0)  /* Queue full: drop oldest records to make room */
+#define ESP8266_QUEUE_DROP_NEWEST   (1)  /* Queue full: drop the record being queued */
+
+/* Queue counters, check ESP8266Queue::stats() */
+typedef struct
+{
+    uint32_t queued;         /* Records accepted */
+    uint32_t flushed;        /* Records sent */
+    uint32_t dropped;        /* Records dropped, queue full or record too long */
+    uint32_t batches;        /* AT+CIPSEND used to send records */
+    uint32_t pending;        /* Records waiting to be sent */
+} esp8266_queue_stats_t;
+
+/**
+ * Record storage used by ESP8266Queue, records are kept in arrival order.
+ *
+ * ESP8266RamStore keeps them in RAM, implement this interface to keep them
+ * in EEPROM, flash or SD so they survive a reset.
+ */
+class ESP8266RecordStore
+{
+    public:
+        /**
+         * Append a record.
+         *
+         * @retval true - success.
+         * @retval false - not enough room.
+         */
+        virtual bool push(const uint8_t *record, uint16_t len) = 0;
+
+        /**
+         * Get number of stored records.
+         */
+        virtual uint16_t count(void) = 0;
+
+        /**
+         * Get length of the longest record an empty store can hold.
+         */
+        virtual uint16_t maxLength(void) = 0;
+
+        /**
+         * Get record length.
+         *
+         * @param index - Record index, 0 is the oldest one.
+         *
+         * @retval - Record length, -1 if there is no such record.
+         */
+        virtual int32_t length(uint16_t index) = 0;
+
+        /**
+         * Write a record, records are read in order so sequential access should be fast.
+         *
+         * @param index - Record index, 0 is the oldest one.
+         * @param dest - Where record is written.
+         *
+         * @retval true - success.
+         * @retval false - there is no such record.
+         */
+        virtual bool write(uint16_t index, Print &dest) = 0;
+
+        /**
+         * Remove oldest records.
+         *
+         * @param count - Records to remove.
+         */
+        virtual void pop(uint16_t count) = 0;
+};
+
+/**
+ * RAM record storage, records are kept with a 2 bytes length on a ring.
+ * Use ESP8266StaticRamStore to declare a store with its own storage.
+ */
+class ESP8266RamStore: public ESP8266RecordStore
+{
+    public:
+        /**
+         * Class constructor
+         *
+         * @param buffer - Storage.
+         * @param size - Storage size.
+         */
+        ESP8266RamStore(uint8_t *buffer, uint16_t size);
+
+        virtual bool push(const uint8_t *record, uint16_t len);
+        virtual uint16_t count(void);
+        virtual uint16_t maxLength(void);
+        virtual int32_t length(uint16_t index);
+        virtual bool write(uint16_t index, Print &dest);
+        virtual void pop(uint16_t count);
+
+    private:
+        uint8_t *_buffer;
+        uint16_t _size;
+        uint16_t _head;          /* Next byte to write */
+        uint16_t _tail;          /* Oldest record */
+        uint16_t _used;
+        uint16_t _count;
+
+        /* Last record looked up, makes sequential access O(1) */
+        uint16_t _cursorIndex;
+        uint16_t _cursorPos;
+
+        int32_t seek(uint16_t index);
+        uint8_t at(uint32_t pos);
+};
+
+/**
+ * RAM record storage with static storage.
+ *
+ * @param N - Storage size, each record takes its length + 2 bytes.
+ */
+template <size_t N>
+class ESP8266StaticRamStore: public ESP8266RamStore
+{
+    static_assert((N >= 3) && (N <= 65535), "ESP8266 RAM store size must be 3..65535");
+
+    public:
+        ESP8266StaticRamStore(void) : ESP8266RamStore(_storage, (uint16_t) N) { }
+
+    private:
+        uint8_t _storage[N];
+};
+
+/**
+ * Queue records while the module is offline and send them once the TCP
+ * connection is up, packing as many records as fit (ESP8266_MAX_SEND_LEN)
+ * on each AT+CIPSEND.
+ *
+ * Records are sent back to back as they are, so they should carry their own
+ * separator (i.e. a line end). A record is removed once its AT+CIPSEND is
+ * acknowledged, records of a batch which failed are sent again, so the
+ * server may see a record twice.
+ *
+ * Usage:
+ *   queue.push(record, len);             // online or not
+ *   if (esp.connected()) queue.flush();  // from loop(), after reconnecting
+ */
+class ESP8266Queue
+{
+    public:
+        /**
+         * Class constructor
+         *
+         * @param esp - Module used to send the records.
+         * @param store - Record storage.
+         * @param policy - Overflow policy, ESP8266_QUEUE_DROP_OLDEST or ESP8266_QUEUE_DROP_NEWEST.
+         */
+        ESP8266Queue(ESP8266 &esp, ESP8266RecordStore &store, uint8_t policy = ESP8266_QUEUE_DROP_OLDEST);
+
+        /**
+         * Queue a record.
+         *
+         * @param record - Record data.
+         * @param len - Record length (max. ESP8266_MAX_SEND_LEN).
+         *
+         * @retval true - record queued, older records may have been dropped.
+         * @retval false - record dropped, queue full or record longer than the store can hold.
+         */
+        bool push(const uint8_t *record, uint16_t len);
+
+        /**
+         * Send queued records through current TCP connection, stops on the
+         * first failed batch.
+         *
+         * @retval - Records sent.
+         */
+        uint16_t flush(void);
+
+        /**
+         * Get number of records waiting to be sent.
+         */
+        uint16_t pending(void);
+
+        /**
+         * Set overflow policy.
+         *
+         * @param policy - ESP8266_QUEUE_DROP_OLDEST or ESP8266_QUEUE_DROP_NEWEST.
+         */
+        void setOverflowPolicy(uint8_t policy);
+
+        /**
+         * Get queue counters.
+         *
+         * @param dest - Pointer to store counters.
+         */
+        void stats(esp8266_queue_stats_t *dest);
+
+        /**
+         * Reset queue counters, pending records are kept.
+         */
+        void clearStats(void);
+
+    private:
+        ESP8266 *_esp;
+        ESP8266RecordStore *_store;
+        uint8_t _policy;
+
+        uint32_t _queued;
+        uint32_t _flushed;
+        uint32_t _dropped;
+        uint32_t _batches;
+};
+
+#endif /* ESP8266_QUEUE_H */
@@ -0,0 +1,136 @@
+/**
+ * @file ESP8266RingBuffer.cpp
+ * @brief Lock-free single producer/single consumer receive buffer for ESP8266.
+ */
+
+#include "ESP8266RingBuffer.h"
+
+ESP8266RingBuffer::ESP8266RingBuffer(uint8_t *buffer, esp8266_ring_index_t mask)
+{
+    _buffer = buffer;
+    _mask = mask;
+    _head = 0;
+    _tail = 0;
+    _overflows = 0;
+    _source = NULL;
+}
+
+bool ESP8266RingBuffer::push(uint8_t c)
+{
+    bool ret = false;
+    esp8266_ring_index_t head = _head;
+    esp8266_ring_index_t next = (head + 1) & _mask;
+
+    /* One slot is kept empty to tell full from empty */
+    if (next != ESP8266_RING_LOAD(_tail))
+    {
+        _buffer[head] = c;
+        ESP8266_RING_STORE(_head, next);
+        ret = true;
+    }
+    else
+    {
+        _overflows = _overflows + 1;
+    }
+
+    return ret;
+}
+
+esp8266_ring_index_t ESP8266RingBuffer::pump(Stream &source)
+{
+    esp8266_ring_index_t count = 0;
+    int c = 0;
+
+    while (0 < source.available())
+    {
+        /* Stop once full, remaining bytes stay on the serial port */
+        if (((_head + 1) & _mask) == ESP8266_RING_LOAD(_tail))
+        {
+            break;
+        }
+        c = source.read();
+        if (0 > c)
+        {
+            break;
+        }
+        (void) push((uint8_t) c);
+        count++;
+    }
+
+    return count;
+}
+
+void ESP8266RingBuffer::autoPump(Stream *source)
+{
+    _source = source;
+}
+
+esp8266_ring_index_t ESP8266RingBuffer::capacity(void)
+{
+    return _mask;
+}
+
+uint32_t ESP8266RingBuffer::overflows(void)
+{
+    return _overflows;
+}
+
+void ESP8266RingBuffer::clear(void)
+{
+    ESP8266_RING_STORE(_tail, ESP8266_RING_LOAD(_head));
+}
+
+int ESP8266RingBuffer::available()
+{
+    if (NULL != _source)
+    {
+        (void) pump(*_source);
+    }
+    return (ESP8266_RING_LOAD(_head) - _tail) & _mask;
+}
+
+int ESP8266RingBuffer::read()
+{
+    int c = -1;
+    esp8266_ring_index_t tail = _tail;
+
+    if ((tail == ESP8266_RING_LOAD(_head)) && (NULL != _source))
+    {
+        (void) pump(*_source);
+    }
+
+    if (tail != ESP8266_RING_LOAD(_head))
+    {
+        c = _buffer[tail];
+        ESP8266_RING_STORE(_tail, (esp8266_ring_index_t) ((tail + 1) & _mask));
+    }
+
+    return c;
+}
+
+int ESP8266RingBuffer::peek()
+{
+    int c = -1;
+    esp8266_ring_index_t tail = _tail;
+
+    if ((tail == ESP8266_RING_LOAD(_head)) && (NULL != _source))
+    {
+        (void) pump(*_source);
+    }
+
+    if (tail != ESP8266_RING_LOAD(_head))
+    {
+        c = _buffer[tail];
+    }
+
+    return c;
+}
+
+size_t ESP8266RingBuffer::write(uint8_t)
+{
+    return 0;
+}
+
+void ESP8266RingBuffer::flush()
+{
+}
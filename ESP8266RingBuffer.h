@@ -0,0 +1,136 @@
+/**
+ * @file ESP8266RingBuffer.h
+ * @brief Lock-free single producer/single consumer receive buffer for ESP8266.
+ */
+
+#ifndef ESP8266_RING_BUFFER_H
+#define ESP8266_RING_BUFFER_H
+
+#include "Arduino.h"
+
+#if defined(__AVR__)
+/* Single byte loads/stores are atomic on 8-bit AVR, so indexes must fit on one byte */
+typedef uint8_t esp8266_ring_index_t;
+#define ESP8266_RING_LOAD(var)          (var)
+#define ESP8266_RING_STORE(var, value)  ((var) = (value))
+#else
+typedef uint16_t esp8266_ring_index_t;
+#define ESP8266_RING_LOAD(var)          __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define ESP8266_RING_STORE(var, value)  __atomic_store_n(&(var), (value), __ATOMIC_RELEASE)
+#endif
+
+/**
+ * Receive ring buffer, one side (producer) pushes bytes received from the
+ * serial port, i.e. from an RX interrupt, a timer or a reader thread, while
+ * the other side (consumer, the ESP8266 driver) reads them as a Stream.
+ *
+ * Only one producer and one consumer are allowed, no locks are needed. With
+ * a reader thread as producer, the serial port must accept writes from the
+ * consumer thread meanwhile (ESP8266LinuxSerial does).
+ * Use ESP8266StaticRingBuffer to declare a buffer with its own storage.
+ */
+class ESP8266RingBuffer: public Stream
+{
+    public:
+        /**
+         * Class constructor
+         *
+         * @param buffer - Storage, size must be a power of two.
+         * @param mask - Storage size - 1.
+         */
+        ESP8266RingBuffer(uint8_t *buffer, esp8266_ring_index_t mask);
+
+        /**
+         * Producer: store a received byte.
+         *
+         * @param c - Received byte.
+         *
+         * @retval true - success.
+         * @retval false - buffer full, byte dropped and overflow counted.
+         */
+        bool push(uint8_t c);
+
+        /**
+         * Producer: move every byte available on a serial port into the buffer.
+         *
+         * @param source - Serial port to read from.
+         *
+         * @retval - Number of bytes moved.
+         */
+        esp8266_ring_index_t pump(Stream &source);
+
+        /**
+         * Let the consumer feed the buffer from a serial port every time it looks
+         * for data, use it only when nothing else pushes data into the buffer.
+         *
+         * @param source - Serial port to read from, NULL to disable.
+         */
+        void autoPump(Stream *source);
+
+        /**
+         * Get buffer capacity.
+         *
+         * @retval - Maximum bytes that can be stored.
+         */
+        esp8266_ring_index_t capacity(void);
+
+        /**
+         * Get number of bytes dropped because the buffer was full.
+         *
+         * @retval - Overflow count.
+         *
+         * @note On 8-bit cores read it with interrupts disabled for an exact value.
+         */
+        uint32_t overflows(void);
+
+        /**
+         * Consumer: discard every stored byte.
+         */
+        void clear(void);
+
+        /**
+         * Consumer: Stream methods.
+         */
+        virtual int available();
+        virtual int read();
+        virtual int peek();
+
+        /**
+         * Buffer is read only, write is discarded.
+         */
+        virtual size_t write(uint8_t);
+        virtual void flush();
+
+    private:
+        uint8_t *_buffer;
+        esp8266_ring_index_t _mask;
+
+        /* Written only by producer */
+        volatile esp8266_ring_index_t _head;
+        volatile uint32_t _overflows;
+
+        /* Written only by consumer */
+        volatile esp8266_ring_index_t _tail;
+
+        Stream *_source;
+};
+
+/**
+ * Receive ring buffer with static storage.
+ *
+ * @param N - Buffer size, power of two (N - 1 bytes can be stored).
+ */
+template <size_t N>
+class ESP8266StaticRingBuffer: public ESP8266RingBuffer
+{
+    static_assert((N >= 2) && (0 == (N & (N - 1))), "ESP8266 ring buffer size must be a power of two");
+    static_assert((N - 1) <= (esp8266_ring_index_t) ~0, "ESP8266 ring buffer size too big for this core");
+
+    public:
+        ESP8266StaticRingBuffer(void) : ESP8266RingBuffer(_storage, (esp8266_ring_index_t) (N - 1)) { }
+
+    private:
+        uint8_t _storage[N];
+};
+
+#endif /* ESP8266_RING_BUFFER_H */
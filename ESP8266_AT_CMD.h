@@ -29,6 +29,7 @@ const char AT_SET_WIFI_MODE[] = "+CWMODE_CUR"; /* Current WiFi mode */
 const char AT_CWJAP[] = "+CWJAP_CUR"; /* Connect to AP, for current */
 const char AT_CWLAP[] = "+CWLAP"; /* List available APs */
 const char AT_CWQAP[] = "+CWQAP"; /* Disconnect from AP */
+const char AT_CWLAPOPT[] = "+CWLAPOPT"; /* Set AP list order and fields */
 
 /* WiFi responses*/
 const char AT_CWLAP_RX[] = "+CWLAP:";
@@ -40,8 +41,11 @@ const char AT_CIPCLOSE[] = "+CIPCLOSE"; /* Close TCP, UDP or SSL connection */
 const char AT_CIPMUX[] = "+CIPMUX"; /* Enable multiple connections */
 const char AT_CIFSR[] = "+CIFSR"; /* Get local IP address */
 const char AT_CIPSTAMAC[] = "+CIPSTAMAC_CUR"; /* Set/Get MAC address */
-const char AT_PING[] = "+PING"; /* DESC */
+const char AT_PING[] = "+PING"; /* Ping remote host */
 const char AT_IPD[] = "+IPD";
+const char AT_CIPRECVMODE[] = "+CIPRECVMODE"; /* Set TCP receive mode (active/passive) */
+const char AT_CIPRECVDATA[] = "+CIPRECVDATA"; /* Get TCP data in passive receive mode */
+const char AT_CIPRECVLEN[] = "+CIPRECVLEN"; /* Get TCP data length in passive receive mode */
 
 /* TCP Responses */
 const char AT_CIPSTART_ALRDY[] = "ALREADY CONNECT";
@@ -51,5 +55,9 @@ const char AT_CIPCLOSE_OK[] = "CLOSED";
 const char AT_CIFSR_STATIP[] = "+CIFSR:STAIP,";
 const char AT_CIPSTAMAC_CURR[] = "+CIPSTAMAC_CUR:";
 const char AT_CIFSR_STAMAC[] = "+CIFSR:STAMAC,";
+const char AT_IPD_RX[] = "+IPD,";
+const char AT_CIPRECVDATA_RX[] = "+CIPRECVDATA:";
+const char AT_CIPRECVLEN_RX[] = "+CIPRECVLEN:";
+const char AT_PING_RX[] = "+PING:"; /* Newer firmware, older ones reply "+<time>" */
 
 #endif /* ESP8266_AT_CMD_H_ */
@@ -0,0 +1,156 @@
+/*
+ ParserBenchmark.pde
+ Measure how many bytes per second the ESP8266 response parser can handle.
+
+ Recorded module output (CWLAP, CIFSR, +IPD and HTTP lines) is run through
+ ESP8266::parseLine() and ESP8266::parseIPD(), the same functions used by the
+ library while talking to the module, so no ESP8266 is needed for this test.
+ A set of malformed lines is also parsed into a small guarded buffer to
+ check that bad module output never writes past the destination buffer.
+
+ modified on 18 Oct 2026
+ http://www.github.com/argandas/ESP8266
+*/
+
+#include <ESP8266.h>
+#include <SoftwareSerial.h>
+
+#define ITERATIONS 200
+
+/* Recorded responses */
+const char* cwlapTrace[] = {
+  "+CWLAP:(3,\"HomeNetwork\",-62,\"a0:f3:c1:12:34:56\",6,-8,0)",
+  "+CWLAP:(4,\"Office-5G\",-71,\"18:e8:29:ab:cd:ef\",11,10,0)",
+  "+CWLAP:(0,\"Guest\",-85,\"00:1d:7e:00:11:22\",1,-2,0)",
+  "OK"
+};
+
+const char* cifsrTrace[] = {
+  "+CIFSR:STAIP,\"192.168.1.105\"",
+  "+CIFSR:STAMAC,\"5c:cf:7f:01:02:03\"",
+  "OK"
+};
+
+const char* ipdTrace[] = {
+  "+IPD,512:HTTP/1.1 200 OK",
+  "+IPD,0,1460:HTTP/1.1 200 OK",
+  "+IPD,4,38"
+};
+
+const char* httpTrace[] = {
+  "HTTP/1.1 200 OK",
+  "Content-Type: application/json",
+  "Content-Length: 61",
+  "Connection: close",
+  "",
+  "{\"temp\":21.5,\"hum\":40,\"status\":\"ok\",\"ts\":1476789012}"
+};
+
+/* Malformed responses */
+const char* badTrace[] = {
+  "+CIFSR:STAIP,\"192.168.1.105.192.168.1.105.192.168.1.105\"",
+  "+CIFSR:STAIP,\"",
+  "+CIFSR:STAIP,\"\"",
+  "+CIFSR:STAIP,192.168.1.105\"",
+  "+IPD,",
+  "+IPD,99999999999:",
+  "+IPD,1,:",
+  "+IPD,-5:",
+  "busy p..."
+};
+
+char line[ESP8266_RX_BUFF_LEN];
+
+uint32_t runTrace(const char** trace, uint8_t count, const char* pass, char delimA, char delimB)
+{
+  char dest[ESP8266_RX_BUFF_LEN];
+  uint32_t bytes = 0;
+  uint8_t len = 0;
+
+  for (uint16_t n = 0; n < ITERATIONS; n++)
+  {
+    for (uint8_t i = 0; i < count; i++)
+    {
+      /* Parser modifies the line, so work on a copy */
+      len = strlen(trace[i]);
+      memcpy(line, trace[i], len + 1);
+      if (NULL != pass)
+      {
+        (void) ESP8266::parseLine(line, len, dest, sizeof(dest), pass, NULL, delimA, delimB);
+      }
+      else
+      {
+        (void) ESP8266::parseIPD(line, NULL);
+      }
+      bytes += len;
+    }
+  }
+  return bytes;
+}
+
+void report(const char* name, const char** trace, uint8_t count, const char* pass, char delimA, char delimB)
+{
+  uint32_t start = micros();
+  uint32_t bytes = runTrace(trace, count, pass, delimA, delimB);
+  uint32_t elapsed = micros() - start;
+
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(bytes);
+  Serial.print(" bytes in ");
+  Serial.print(elapsed);
+  Serial.print(" us, ");
+  Serial.print((bytes * 1000.0) / elapsed);
+  Serial.println(" KB/s");
+}
+
+bool malformed(void)
+{
+  /* 16 bytes destination surrounded by guard bytes */
+  char guarded[4 + ESP8266_IP_LEN + 4];
+  char* dest = &guarded[4];
+  bool ok = true;
+  uint8_t len = 0;
+
+  for (uint8_t i = 0; i < (sizeof(badTrace) / sizeof(badTrace[0])); i++)
+  {
+    memset(guarded, 0xA5, sizeof(guarded));
+    len = strlen(badTrace[i]);
+    memcpy(line, badTrace[i], len + 1);
+    (void) ESP8266::parseLine(line, len, dest, ESP8266_IP_LEN, "+CIFSR:STAIP,", NULL, '"', '"');
+    (void) ESP8266::parseIPD(line, NULL);
+
+    for (uint8_t j = 0; j < 4; j++)
+    {
+      if (((char) 0xA5 != guarded[j]) || ((char) 0xA5 != guarded[sizeof(guarded) - 1 - j]))
+      {
+        Serial.print("Overrun on: ");
+        Serial.println(badTrace[i]);
+        ok = false;
+        break;
+      }
+    }
+  }
+  return ok;
+}
+
+void setup()
+{
+  Serial.begin(9600);
+  Serial.println("ESP8266 parser benchmark");
+
+  report("CWLAP", cwlapTrace, 4, "+CWLAP:", '"', '"');
+  report("CIFSR", cifsrTrace, 3, "+CIFSR:STAIP,", '"', '"');
+  report("+IPD ", ipdTrace, 3, NULL, '\0', '\0');
+  report("HTTP ", httpTrace, 6, "HTTP/1.1", ' ', ' ');
+
+  if (malformed())
+  {
+    Serial.println("Malformed responses: OK");
+  }
+}
+
+void loop()
+{
+  /* Do nothing */
+}
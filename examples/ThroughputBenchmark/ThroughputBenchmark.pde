@@ -0,0 +1,357 @@
+/*
+ ThroughputBenchmark.pde
+ Measure real upload/download rates, per-send latency and errors.
+
+ Data is exchanged with the host program in extras/ThroughputHost, build and
+ run it on a PC in the same network (instructions on top of its source file):
+   ./esp8266_bench_host 5000
+ then set WIFI_SSID, WIFI_PASS and HOST_IP below.
+
+ Each baud rate in baudRates[] is selected with AT+UART_CUR and every send
+ mode is run on it:
+  - send:        send() for each CHUNK_LEN bytes, one AT+CIPSEND per chunk.
+  - segments:    send() of a segment list, SEGMENTS chunks per AT+CIPSEND.
+  - transparent: AT+CIPMODE=1, data written straight to the port.
+ A download is run on each baud rate as well. Results are printed as CSV
+ lines so runs with other port types or boards can be compared:
+   baud,port,mode,dir,bytes,ms,KB/s,lat_min,lat_avg,lat_max,errors
+
+ Latency is the time taken by each send() (or port write in transparent mode)
+ in ms. Errors are failed sends, bytes lost or corrupted and driver timeouts,
+ ERROR and busy responses.
+
+ NOTE:
+ AT firmware answers "busy s..." to a new AT+CIPSEND while the previous one
+ is in progress, so sends can't be pipelined; segments mode is the closest,
+ it batches more data on each AT+CIPSEND.
+
+ modified on 18 Oct 2026
+ http://www.github.com/argandas/ESP8266
+*/
+
+#include <ESP8266.h>
+#include <SoftwareSerial.h>
+
+#define WIFI_SSID   "MyNetwork"
+#define WIFI_PASS   "MyPassword"
+#define HOST_IP     "192.168.1.10"
+#define HOST_PORT   5000
+
+#define TOTAL_BYTES 8192  /* Bytes per test */
+#define CHUNK_LEN   256   /* Bytes per send(), multiple of 256 */
+#define SEGMENTS    8     /* Chunks per AT+CIPSEND in segments mode */
+#define MODULE_BAUD 115200  /* Baud rate of the module after reset */
+
+/* Comment out to use Serial1 on boards with a second hardware UART */
+#define USE_SOFTWARE_SERIAL
+
+#ifdef USE_SOFTWARE_SERIAL
+SoftwareSerial espSerial(10, 11);
+#define PORT_TYPE "SoftwareSerial"
+#else
+#define espSerial Serial1
+#define PORT_TYPE "Serial1"
+#endif
+
+/* Setup ESP8266 control pins */
+ESP8266 myESP(13, 12); /* RESET, ENABLE*/
+
+const uint32_t baudRates[] = { 9600, 57600, 115200 };
+
+enum { MODE_SEND, MODE_SEGMENTS, MODE_TRANSPARENT };
+const char* modeNames[] = { "send", "segments", "transparent" };
+
+/* Payload byte at offset i is (i & 0xFF), same for every chunk */
+uint8_t chunk[CHUNK_LEN];
+uint32_t currentBaud = MODULE_BAUD;
+
+uint32_t latMin;
+uint32_t latMax;
+uint32_t latSum;
+uint32_t latCount;
+
+void addLatency(uint32_t ms)
+{
+  if ((0 == latCount) || (ms < latMin))
+  {
+    latMin = ms;
+  }
+  if (ms > latMax)
+  {
+    latMax = ms;
+  }
+  latSum += ms;
+  latCount++;
+}
+
+uint32_t driverErrors(void)
+{
+  esp8266_metrics_t m;
+  myESP.metrics(&m);
+  return m.timeouts + m.errors + m.busy;
+}
+
+void report(const char* mode, const char* dir, uint32_t bytes, uint32_t ms, uint32_t errors)
+{
+  Serial.print(currentBaud);
+  Serial.print(",");
+  Serial.print(PORT_TYPE);
+  Serial.print(",");
+  Serial.print(mode);
+  Serial.print(",");
+  Serial.print(dir);
+  Serial.print(",");
+  Serial.print(bytes);
+  Serial.print(",");
+  Serial.print(ms);
+  Serial.print(",");
+  Serial.print(ms ? ((float) bytes / ms) : 0.0);
+  Serial.print(",");
+  Serial.print(latMin);
+  Serial.print(",");
+  Serial.print(latCount ? (latSum / latCount) : 0);
+  Serial.print(",");
+  Serial.print(latMax);
+  Serial.print(",");
+  Serial.println(errors);
+}
+
+/* Parse "R <bytes> <errors> <ms>" reply from host, returns host errors */
+uint32_t parseReply(char* reply, uint32_t expected)
+{
+  char* p = strchr(reply, 'R');
+  uint32_t received = 0;
+  uint32_t errors = expected;
+
+  if (NULL != p)
+  {
+    received = strtoul(p + 1, &p, 10);
+    errors = strtoul(p, &p, 10);
+    if (received < expected)
+    {
+      errors += expected - received;
+    }
+  }
+  return errors;
+}
+
+bool setBaud(uint32_t baud)
+{
+  /* Change baud rate until next reset */
+  myESP.print("AT+UART_CUR=");
+  myESP.print(baud);
+  myESP.print(",8,1,0,0\r\n");
+  myESP.find((char*) "OK");
+  delay(100);
+
+  myESP.begin(espSerial, baud);
+  currentBaud = baud;
+  return myESP.test();
+}
+
+void upload(uint8_t mode)
+{
+  char header[16];
+  char reply[32];
+  esp8266_segment_t segments[SEGMENTS];
+  uint32_t sent = 0;
+  uint32_t len = 0;
+  uint32_t start = 0;
+  uint32_t elapsed = 0;
+  uint32_t errors = 0;
+  uint32_t driver = driverErrors();
+  int32_t count = 0;
+  bool ok = true;
+
+  latMin = latMax = latSum = latCount = 0;
+
+  if (!myESP.startTCP((char*) HOST_IP, HOST_PORT))
+  {
+    report(modeNames[mode], "up", 0, 0, 1);
+    return;
+  }
+
+  sprintf(header, "U %lu\n", (unsigned long) TOTAL_BYTES);
+  if (MODE_TRANSPARENT == mode)
+  {
+    myESP.print("AT+CIPMODE=1\r\n");
+    ok = myESP.find((char*) "OK");
+    myESP.print("AT+CIPSEND\r\n");
+    ok = ok && myESP.find((char*) ">");
+    myESP.print(header);
+  }
+  else
+  {
+    ok = myESP.send((const uint8_t*) header, strlen(header));
+  }
+
+  start = millis();
+  while (ok && (sent < TOTAL_BYTES))
+  {
+    uint32_t t = millis();
+    if (MODE_SEND == mode)
+    {
+      len = CHUNK_LEN;
+      ok = myESP.send(chunk, len);
+    }
+    else if (MODE_SEGMENTS == mode)
+    {
+      uint8_t n = 0;
+      for (len = 0; (n < SEGMENTS) && ((sent + len) < TOTAL_BYTES); len += CHUNK_LEN)
+      {
+        segments[n].type = ESP8266_SEGMENT_RAM;
+        segments[n].data = chunk;
+        segments[n].len = CHUNK_LEN;
+        n++;
+      }
+      ok = myESP.send(segments, n);
+    }
+    else
+    {
+      len = CHUNK_LEN;
+      myESP.write(chunk, len);
+    }
+    addLatency(millis() - t);
+    if (ok)
+    {
+      sent += len;
+    }
+    else
+    {
+      errors++;
+    }
+  }
+
+  /* Host replies once it has all data */
+  memset(reply, 0, sizeof(reply));
+  if (MODE_TRANSPARENT == mode)
+  {
+    myESP.setTimeout(10000);
+    if (myESP.find((char*) "R "))
+    {
+      myESP.readBytesUntil('\n', &reply[1], sizeof(reply) - 2);
+      reply[0] = 'R';
+    }
+    myESP.setTimeout(1000);
+  }
+  else if (0 < sent)
+  {
+    count = myESP.receive((uint8_t*) reply, sizeof(reply) - 1, 10000);
+    if (0 < count)
+    {
+      reply[count] = '\0';
+    }
+  }
+  elapsed = millis() - start;
+  errors += parseReply(reply, TOTAL_BYTES);
+
+  if (MODE_TRANSPARENT == mode)
+  {
+    /* Leave transparent mode, "+++" must be alone for 1s */
+    delay(1000);
+    myESP.print("+++");
+    myESP.flush();
+    delay(1000);
+    myESP.print("AT+CIPMODE=0\r\n");
+    myESP.find((char*) "OK");
+  }
+  myESP.stopTCP();
+
+  report(modeNames[mode], "up", sent, elapsed, errors + driverErrors() - driver);
+}
+
+void download(void)
+{
+  char header[16];
+  uint8_t buffer[64];
+  uint32_t received = 0;
+  uint32_t start = 0;
+  uint32_t elapsed = 0;
+  uint32_t errors = 0;
+  uint32_t driver = driverErrors();
+  int32_t count = 0;
+
+  latMin = latMax = latSum = latCount = 0;
+
+  if (!myESP.startTCP((char*) HOST_IP, HOST_PORT))
+  {
+    report("receive", "down", 0, 0, 1);
+    return;
+  }
+
+  sprintf(header, "D %lu\n", (unsigned long) TOTAL_BYTES);
+  start = millis();
+  if (myESP.send((const uint8_t*) header, strlen(header)))
+  {
+    while (received < TOTAL_BYTES)
+    {
+      count = myESP.receive(buffer, sizeof(buffer), 5000);
+      if (0 >= count)
+      {
+        break;
+      }
+      for (int32_t i = 0; i < count; i++)
+      {
+        if (buffer[i] != (uint8_t) (received + i))
+        {
+          errors++;
+        }
+      }
+      received += count;
+    }
+  }
+  elapsed = millis() - start;
+  myESP.stopTCP();
+
+  errors += TOTAL_BYTES - received;
+  report("receive", "down", received, elapsed, errors + driverErrors() - driver);
+}
+
+void setup()
+{
+  Serial.begin(9600);
+  Serial.println("ESP8266 throughput benchmark");
+
+  for (uint16_t i = 0; i < CHUNK_LEN; i++)
+  {
+    chunk[i] = (uint8_t) i;
+  }
+
+  myESP.begin(espSerial, MODULE_BAUD);
+  if (!myESP.hardReset() && !myESP.reset())
+  {
+    Serial.println("ESP8266 not responding");
+    return;
+  }
+  myESP.echo(false);
+  myESP.operationMode(ESP8266_MODE_STATION);
+  myESP.connectionMode(ESP8266_CONN_SINGLE);
+  if (!myESP.joinAP((char*) WIFI_SSID, (char*) WIFI_PASS))
+  {
+    Serial.println("Unable to join AP");
+    return;
+  }
+
+  Serial.println("baud,port,mode,dir,bytes,ms,KB/s,lat_min,lat_avg,lat_max,errors");
+  for (uint8_t b = 0; b < (sizeof(baudRates) / sizeof(baudRates[0])); b++)
+  {
+    if (!setBaud(baudRates[b]))
+    {
+      Serial.print(baudRates[b]);
+      Serial.println(" baud not working");
+      continue;
+    }
+    for (uint8_t mode = MODE_SEND; mode <= MODE_TRANSPARENT; mode++)
+    {
+      upload(mode);
+    }
+    download();
+  }
+  setBaud(MODULE_BAUD);
+  Serial.println("Done");
+}
+
+void loop()
+{
+  /* Do nothing */
+}
@@ -0,0 +1,130 @@
+/**
+ * @file esp8266_lzss_decode.cpp
+ * @brief Decoder for frames sent by ESP8266Lzss, for the server side.
+ *
+ * Build on the server:
+ *   g++ -O2 -o esp8266_lzss_decode esp8266_lzss_decode.cpp
+ *
+ * Reads frames from stdin (i.e. the TCP stream saved by "nc -l 5000 > frames.bin")
+ * and writes the decoded data to stdout, frame statistics go to stderr:
+ *   ./esp8266_lzss_decode < frames.bin
+ *
+ * The frame format is described in ESP8266Lzss.h, lzssDecode() below can be
+ * copied into server code.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LZSS_MAGIC        (0x5A)  /* First byte of every frame ('Z') */
+#define LZSS_STORED          (0)  /* Payload sent as is */
+#define LZSS_COMPRESSED      (1)  /* Payload compressed */
+#define LZSS_HEADER_LEN      (6)  /* Frame header length */
+#define LZSS_MIN_MATCH       (3)  /* Match length offset */
+#define LZSS_MAX_FRAME   (65535)  /* Maximum payload and data length */
+
+/* Decompress a payload, returns data length or -1 if payload is corrupted */
+static long lzssDecode(const uint8_t *src, uint32_t len, uint8_t *dest, uint32_t destLen)
+{
+    uint32_t idx = 0;
+    uint32_t out = 0;
+    uint32_t dist = 0;
+    uint32_t count = 0;
+    uint8_t flags = 0;
+    uint8_t tokens = 0;
+
+    while (idx < len)
+    {
+        if (0 == tokens)
+        {
+            flags = src[idx++];
+            tokens = 8;
+            continue;
+        }
+
+        if (0 != (flags & 0x01))
+        {
+            if (out >= destLen)
+            {
+                return -1;
+            }
+            dest[out++] = src[idx++];
+        }
+        else
+        {
+            if ((idx + 2) > len)
+            {
+                return -1;
+            }
+            dist = (uint32_t) src[idx] + 1;
+            count = (uint32_t) src[idx + 1] + LZSS_MIN_MATCH;
+            idx += 2;
+            if ((dist > out) || ((out + count) > destLen))
+            {
+                return -1;
+            }
+            for (; 0 < count; count--, out++)
+            {
+                dest[out] = dest[out - dist];
+            }
+        }
+        flags >>= 1;
+        tokens--;
+    }
+
+    return (long) out;
+}
+
+int main(void)
+{
+    static uint8_t payload[LZSS_MAX_FRAME];
+    static uint8_t data[LZSS_MAX_FRAME];
+    uint8_t header[LZSS_HEADER_LEN];
+    uint32_t payloadLen = 0;
+    uint32_t dataLen = 0;
+    unsigned long frames = 0;
+    unsigned long bytesIn = 0;
+    unsigned long bytesOut = 0;
+    long len = 0;
+
+    while (LZSS_HEADER_LEN == fread(header, 1, LZSS_HEADER_LEN, stdin))
+    {
+        payloadLen = ((uint32_t) header[2] << 8) | header[3];
+        dataLen = ((uint32_t) header[4] << 8) | header[5];
+        if ((LZSS_MAGIC != header[0]) || (payloadLen != fread(payload, 1, payloadLen, stdin)))
+        {
+            fprintf(stderr, "Frame %lu: invalid or truncated\n", frames);
+            return 1;
+        }
+
+        if (LZSS_STORED == header[1])
+        {
+            memcpy(data, payload, payloadLen);
+            len = (long) payloadLen;
+        }
+        else if (LZSS_COMPRESSED == header[1])
+        {
+            len = lzssDecode(payload, payloadLen, data, dataLen);
+        }
+        else
+        {
+            len = -1;
+        }
+
+        if ((0 > len) || ((uint32_t) len != dataLen))
+        {
+            fprintf(stderr, "Frame %lu: corrupted\n", frames);
+            return 1;
+        }
+
+        fwrite(data, 1, dataLen, stdout);
+        frames++;
+        bytesIn += LZSS_HEADER_LEN + payloadLen;
+        bytesOut += dataLen;
+    }
+
+    fprintf(stderr, "%lu frames, %lu bytes received, %lu bytes decoded (%lu%%)\n",
+            frames, bytesIn, bytesOut, bytesOut ? ((bytesIn * 100) / bytesOut) : 0);
+    return 0;
+}
@@ -0,0 +1,204 @@
+/**
+ * @file esp8266_bench_host.cpp
+ * @brief TCP sink/source for examples/ThroughputBenchmark.
+ *
+ * Build and run on a Linux or macOS host in the same network as the module:
+ *   g++ -O2 -o esp8266_bench_host esp8266_bench_host.cpp
+ *   ./esp8266_bench_host [port]        (default port 5000)
+ *
+ * Each connection starts with a request line from the module:
+ *   "U <bytes>\n" - Upload, host reads <bytes> bytes and replies "R <bytes> <errors> <ms>\n".
+ *   "D <bytes>\n" - Download, host sends <bytes> bytes.
+ * Module closes the connection when the test is done.
+ *
+ * Payload byte at offset i is (i & 0xFF), bytes not matching are counted as errors.
+ * Host side rates are printed for each connection, to be compared with the
+ * rates reported by the sketch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define BENCH_DEFAULT_PORT   (5000)  /* Default TCP port */
+#define BENCH_MAX_BYTES   (1048576)  /* Maximum bytes per request */
+#define BENCH_TIMEOUT          (10)  /* Socket timeout (s) */
+#define BENCH_BUFF_LEN       (1460)  /* Read/write chunk, one TCP segment */
+
+static uint32_t nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ((ts.tv_sec * 1000) + (ts.tv_nsec / 1000000));
+}
+
+static bool readLine(int sock, char *line, size_t len)
+{
+    size_t idx = 0;
+    char c = 0;
+
+    while ((idx + 1) < len)
+    {
+        if (1 != recv(sock, &c, 1, 0))
+        {
+            return false;
+        }
+        if ('\n' == c)
+        {
+            break;
+        }
+        if ('\r' != c)
+        {
+            line[idx++] = c;
+        }
+    }
+    line[idx] = '\0';
+    return true;
+}
+
+static void upload(int sock, const char *peer, uint32_t bytes)
+{
+    uint8_t buffer[BENCH_BUFF_LEN];
+    uint32_t received = 0;
+    uint32_t errors = 0;
+    uint32_t start = nowMs();
+    uint32_t elapsed = 0;
+    ssize_t count = 0;
+    char reply[64];
+
+    while (received < bytes)
+    {
+        count = recv(sock, buffer, ((bytes - received) < sizeof(buffer)) ? (bytes - received) : sizeof(buffer), 0);
+        if (0 >= count)
+        {
+            break;
+        }
+        for (ssize_t i = 0; i < count; i++)
+        {
+            if (buffer[i] != (uint8_t) (received + i))
+            {
+                errors++;
+            }
+        }
+        received += (uint32_t) count;
+    }
+    elapsed = nowMs() - start;
+
+    /* Missing bytes are errors too */
+    errors += bytes - received;
+    snprintf(reply, sizeof(reply), "R %u %u %u\n", received, errors, elapsed);
+    (void) send(sock, reply, strlen(reply), 0);
+
+    /* Module closes the connection once it has the reply */
+    while (0 < recv(sock, buffer, sizeof(buffer), 0))
+    {
+    }
+
+    printf("%s upload   %7u bytes %6u ms %8.2f KB/s %u errors\n", peer, received, elapsed,
+           elapsed ? ((double) received / elapsed) : 0.0, errors);
+}
+
+static void download(int sock, const char *peer, uint32_t bytes)
+{
+    uint8_t buffer[BENCH_BUFF_LEN];
+    uint32_t sent = 0;
+    uint32_t start = nowMs();
+    uint32_t elapsed = 0;
+    ssize_t count = 0;
+    size_t len = 0;
+
+    while (sent < bytes)
+    {
+        len = ((bytes - sent) < sizeof(buffer)) ? (bytes - sent) : sizeof(buffer);
+        for (size_t i = 0; i < len; i++)
+        {
+            buffer[i] = (uint8_t) (sent + i);
+        }
+        count = send(sock, buffer, len, 0);
+        if (0 >= count)
+        {
+            break;
+        }
+        sent += (uint32_t) count;
+    }
+    /* Wait until the module has everything, it closes the connection when done */
+    while (0 < recv(sock, buffer, sizeof(buffer), 0))
+    {
+    }
+    elapsed = nowMs() - start;
+
+    printf("%s download %7u bytes %6u ms %8.2f KB/s\n", peer, sent, elapsed,
+           elapsed ? ((double) sent / elapsed) : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    int port = (1 < argc) ? atoi(argv[1]) : BENCH_DEFAULT_PORT;
+    int server = -1;
+    int sock = -1;
+    int one = 1;
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    struct timeval tv = { BENCH_TIMEOUT, 0 };
+    char line[32];
+    char peer[INET_ADDRSTRLEN];
+    unsigned long bytes = 0;
+
+    signal(SIGPIPE, SIG_IGN);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    server = socket(AF_INET, SOCK_STREAM, 0);
+    (void) setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t) port);
+    if ((0 > server) || (0 != bind(server, (struct sockaddr *) &addr, sizeof(addr))) || (0 != listen(server, 1)))
+    {
+        perror("esp8266_bench_host");
+        return 1;
+    }
+    printf("Listening on port %d\n", port);
+
+    while (true)
+    {
+        addrLen = sizeof(addr);
+        sock = accept(server, (struct sockaddr *) &addr, &addrLen);
+        if (0 > sock)
+        {
+            continue;
+        }
+        (void) setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        (void) setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        (void) setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        inet_ntop(AF_INET, &addr.sin_addr, peer, sizeof(peer));
+
+        if (readLine(sock, line, sizeof(line)) && (2 < strlen(line)) && (' ' == line[1]))
+        {
+            bytes = strtoul(&line[2], NULL, 10);
+            if ((0 < bytes) && (BENCH_MAX_BYTES >= bytes) && ('U' == line[0]))
+            {
+                upload(sock, peer, (uint32_t) bytes);
+            }
+            else if ((0 < bytes) && (BENCH_MAX_BYTES >= bytes) && ('D' == line[0]))
+            {
+                download(sock, peer, (uint32_t) bytes);
+            }
+            else
+            {
+                printf("%s invalid request \"%s\"\n", peer, line);
+            }
+        }
+        close(sock);
+    }
+
+    return 0;
+}
@@ -0,0 +1,465 @@
+/**
+ * @file ModemSim.cpp
+ * @brief Simulated ESP8266 AT modem on a pty, for host tests of the driver.
+ */
+
+#include "ModemSim.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <pty.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+ModemSim::ModemSim(void)
+{
+    _master = -1;
+    _slave = -1;
+    _device[0] = '\0';
+    _running = false;
+    _busy = 0;
+    _silent = false;
+    _hung = false;
+    _connectFail = false;
+    _sendStall = false;
+    _replyDelay = 0;
+    _linkOpen = false;
+    _passive = false;
+    _echo = false;
+    _peer = NULL;
+    _sendLeft = 0;
+}
+
+ModemSim::~ModemSim(void)
+{
+    end();
+}
+
+bool ModemSim::begin(void)
+{
+    struct termios tio;
+
+    memset(&tio, 0, sizeof(tio));
+    cfmakeraw(&tio);
+    if (0 != openpty(&_master, &_slave, _device, &tio, NULL))
+    {
+        return false;
+    }
+
+    _running = true;
+    _thread = std::thread(&ModemSim::run, this);
+    return true;
+}
+
+void ModemSim::end(void)
+{
+    _running = false;
+    if (_thread.joinable())
+    {
+        _thread.join();
+    }
+    if (0 <= _master)
+    {
+        close(_master);
+        _master = -1;
+    }
+    /* Slave is kept open until here, so the master never sees a hang up */
+    if (0 <= _slave)
+    {
+        close(_slave);
+        _slave = -1;
+    }
+}
+
+const char *ModemSim::device(void)
+{
+    return _device;
+}
+
+void ModemSim::setBusy(uint8_t count)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    _busy = count;
+}
+
+void ModemSim::setSilent(bool silent)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    _silent = silent;
+}
+
+void ModemSim::hang(void)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    _hung = true;
+}
+
+void ModemSim::setConnectFail(bool fail)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    _connectFail = fail;
+}
+
+void ModemSim::setSendStall(bool stall)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    _sendStall = stall;
+}
+
+void ModemSim::setReplyDelay(uint32_t ms)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    _replyDelay = ms;
+}
+
+void ModemSim::setPeer(ModemPeer *peer)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    _peer = peer;
+}
+
+void ModemSim::deliver(const std::string &data)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+
+    if (!_linkOpen || data.empty())
+    {
+        return;
+    }
+
+    if (_passive)
+    {
+        /* Data is held until AT+CIPRECVDATA, only its length is notified */
+        _held += data;
+        reply("+IPD," + std::to_string(data.size()) + "\r\n");
+    }
+    else
+    {
+        reply("\r\n+IPD," + std::to_string(data.size()) + ":" + data);
+    }
+}
+
+void ModemSim::deliverDuringSend(const std::string &data)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    _duringSend = data;
+}
+
+void ModemSim::closeRemote(void)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+
+    if (_linkOpen)
+    {
+        /* Passive mode data not read yet is lost with the connection */
+        _linkOpen = false;
+        _held.clear();
+        reply("CLOSED\r\n");
+    }
+}
+
+bool ModemSim::linkOpen(void)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    return _linkOpen;
+}
+
+bool ModemSim::passive(void)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    return _passive;
+}
+
+bool ModemSim::echo(void)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    return _echo;
+}
+
+std::vector<std::string> ModemSim::commands(void)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    return _commands;
+}
+
+std::string ModemSim::sent(void)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    return _sent;
+}
+
+/* Private functions */
+
+void ModemSim::run(void)
+{
+    struct pollfd pfd;
+    char buffer[512];
+    ssize_t len = 0;
+
+    pfd.fd = _master;
+    pfd.events = POLLIN;
+
+    while (_running)
+    {
+        if (0 >= poll(&pfd, 1, 20))
+        {
+            continue;
+        }
+
+        len = read(_master, buffer, sizeof(buffer));
+        if (0 < len)
+        {
+            _input.append(buffer, (size_t) len);
+            process();
+        }
+        else if ((0 > len) && (EAGAIN != errno) && (EINTR != errno))
+        {
+            /* Nobody has the slave open yet, don't spin */
+            usleep(1000);
+        }
+    }
+}
+
+void ModemSim::process(void)
+{
+    size_t pos = 0;
+    size_t take = 0;
+    std::string cmd;
+    std::string data;
+    ModemPeer *peer = NULL;
+    uint32_t delay = 0;
+
+    while (!_input.empty())
+    {
+        if (0 < _sendLeft)
+        {
+            /* Raw AT+CIPSEND payload, line ends are data */
+            take = (_input.size() < _sendLeft) ? _input.size() : _sendLeft;
+            _sendData.append(_input, 0, take);
+            _input.erase(0, take);
+            _sendLeft -= (uint32_t) take;
+            if (0 == _sendLeft)
+            {
+                std::lock_guard<std::recursive_mutex> guard(_lock);
+                data.swap(_sendData);
+                if (_sendStall)
+                {
+                    continue;
+                }
+                _sent += data;
+                reply("\r\nRecv " + std::to_string(data.size()) + " bytes\r\n");
+                if (!_duringSend.empty())
+                {
+                    deliver(_duringSend);
+                    _duringSend.clear();
+                }
+                reply("\r\nSEND OK\r\n");
+                peer = _peer;
+                if (NULL != peer)
+                {
+                    peer->onData(*this, data);
+                }
+            }
+            continue;
+        }
+
+        pos = _input.find("\r\n");
+        if (std::string::npos == pos)
+        {
+            break;
+        }
+        cmd = _input.substr(0, pos);
+        _input.erase(0, pos + 2);
+        {
+            std::lock_guard<std::recursive_mutex> guard(_lock);
+            delay = _replyDelay;
+            _replyDelay = 0;
+        }
+        /* Not holding the lock, the test thread keeps going meanwhile */
+        if (0 < delay)
+        {
+            usleep(delay * 1000);
+        }
+        handle(cmd);
+    }
+}
+
+void ModemSim::handle(const std::string &cmd)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    std::string at = cmd;
+    std::string data;
+    size_t len = 0;
+
+    _commands.push_back(cmd);
+    if (_hung && (cmd == "AT+RST"))
+    {
+        _hung = false;
+    }
+    if (_silent || _hung)
+    {
+        return;
+    }
+    if (_echo)
+    {
+        reply(cmd + "\r\n");
+    }
+    if (0 < _busy)
+    {
+        _busy--;
+        reply("busy p...\r\n");
+        return;
+    }
+
+    /* "+++" (leave transparent mode) comes without line end, right before next command */
+    while (0 == at.compare(0, 3, "+++"))
+    {
+        at.erase(0, 3);
+    }
+
+    if (at == "AT")
+    {
+        reply("\r\nOK\r\n");
+    }
+    else if ((at == "ATE0") || (at == "ATE1"))
+    {
+        _echo = (at == "ATE1");
+        reply("\r\nOK\r\n");
+    }
+    else if (at == "AT+RST")
+    {
+        _linkOpen = false;
+        _passive = false;
+        _echo = true;
+        _held.clear();
+        reply("\r\nOK\r\n");
+        reply("\r\n ets Jan  8 2013,rst cause:2, boot mode:(3,7)\r\n\r\nready\r\n");
+    }
+    else if (at == "AT+GMR")
+    {
+        reply("AT version:1.2.0.0(Jul  1 2016 20:04:45)\r\nSDK version:1.5.4.1(39cb9a32)\r\n\r\nOK\r\n");
+    }
+    else if (0 == at.compare(0, 12, "AT+CWJAP_CUR"))
+    {
+        reply("WIFI CONNECTED\r\nWIFI GOT IP\r\n\r\nOK\r\n");
+    }
+    else if (at == "AT+CWQAP")
+    {
+        reply("\r\nOK\r\nWIFI DISCONNECT\r\n");
+    }
+    else if (at == "AT+CIFSR")
+    {
+        reply("+CIFSR:STAIP,\"192.168.1.50\"\r\n+CIFSR:STAMAC,\"5c:cf:7f:00:00:01\"\r\n\r\nOK\r\n");
+    }
+    else if (0 == at.compare(0, 12, "AT+CIPSTART="))
+    {
+        if (_connectFail)
+        {
+            reply("\r\nERROR\r\nCLOSED\r\n");
+        }
+        else if (_linkOpen)
+        {
+            reply("ALREADY CONNECTED\r\n\r\nERROR\r\n");
+        }
+        else
+        {
+            _linkOpen = true;
+            _held.clear();
+            reply("CONNECT\r\n\r\nOK\r\n");
+            if (NULL != _peer)
+            {
+                _peer->onConnect(*this);
+            }
+        }
+    }
+    else if (0 == at.compare(0, 11, "AT+CIPSEND="))
+    {
+        len = (size_t) atol(at.c_str() + 11);
+        if (!_linkOpen)
+        {
+            reply("link is not valid\r\n\r\nERROR\r\n");
+        }
+        else if ((0 == len) || (2048 < len))
+        {
+            reply("\r\nERROR\r\n");
+        }
+        else
+        {
+            _sendLeft = (uint32_t) len;
+            _sendData.clear();
+            reply("\r\nOK\r\n> ");
+        }
+    }
+    else if (at == "AT+CIPSTATUS")
+    {
+        reply(std::string(_linkOpen ? "STATUS:3" : "STATUS:2") + "\r\n\r\nOK\r\n");
+    }
+    else if (at == "AT+CIPCLOSE")
+    {
+        if (_linkOpen)
+        {
+            _linkOpen = false;
+            reply("CLOSED\r\n\r\nOK\r\n");
+        }
+        else
+        {
+            reply("\r\nERROR\r\n");
+        }
+    }
+    else if (0 == at.compare(0, 16, "AT+CIPRECVMODE=1"))
+    {
+        _passive = true;
+        reply("\r\nOK\r\n");
+    }
+    else if (0 == at.compare(0, 16, "AT+CIPRECVMODE=0"))
+    {
+        _passive = false;
+        reply("\r\nOK\r\n");
+    }
+    else if (at == "AT+CIPRECVLEN?")
+    {
+        reply("+CIPRECVLEN:" + std::to_string(_held.size()) + ",0,0,0,0\r\n\r\nOK\r\n");
+    }
+    else if (0 == at.compare(0, 15, "AT+CIPRECVDATA="))
+    {
+        len = (size_t) atol(at.c_str() + 15);
+        if (len > _held.size())
+        {
+            len = _held.size();
+        }
+        data = _held.substr(0, len);
+        _held.erase(0, len);
+        reply("+CIPRECVDATA:" + std::to_string(len) + "," + data + "\r\n\r\nOK\r\n");
+    }
+    else if (0 == at.compare(0, 2, "AT"))
+    {
+        /* Setup commands the tests don't check (AT+CWMODE_CUR, AT+CIPMUX...) */
+        reply("\r\nOK\r\n");
+    }
+    else
+    {
+        reply("\r\nERROR\r\n");
+    }
+}
+
+void ModemSim::reply(const std::string &rsp)
+{
+    std::lock_guard<std::recursive_mutex> guard(_lock);
+    size_t done = 0;
+    ssize_t len = 0;
+
+    while (done < rsp.size())
+    {
+        len = write(_master, rsp.data() + done, rsp.size() - done);
+        if (0 < len)
+        {
+            done += (size_t) len;
+        }
+        else if ((0 > len) && (EAGAIN != errno) && (EINTR != errno))
+        {
+            break;
+        }
+    }
+}
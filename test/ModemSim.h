@@ -0,0 +1,188 @@
+/**
+ * @file ModemSim.h
+ * @brief Simulated ESP8266 AT modem on a pty, for host tests of the driver.
+ */
+
+#ifndef ESP8266_MODEM_SIM_H
+#define ESP8266_MODEM_SIM_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ModemSim;
+
+/**
+ * Remote end of the simulated TCP connection (i.e. a server or a broker).
+ * Callbacks run on the simulator thread, they can answer with ModemSim::deliver().
+ */
+class ModemPeer
+{
+    public:
+        virtual ~ModemPeer(void) { }
+
+        /**
+         * Connection opened by AT+CIPSTART.
+         */
+        virtual void onConnect(ModemSim &modem) { (void) modem; }
+
+        /**
+         * Data sent by AT+CIPSEND.
+         */
+        virtual void onData(ModemSim &modem, const std::string &data) = 0;
+};
+
+/**
+ * ESP8266 answering the AT subset used by the driver (single connection) on
+ * the master side of a pty. Open device() with ESP8266LinuxSerial.
+ *
+ * Faults can be injected: "busy p..." replies, a hung module which answers
+ * nothing or answers late, sends that never complete or connections refused
+ * by the remote end. Echo is off until a reset turns it on.
+ */
+class ModemSim
+{
+    public:
+        ModemSim(void);
+        ~ModemSim(void);
+
+        /**
+         * Open the pty and start the simulator thread.
+         *
+         * @retval true - success.
+         * @retval false - failure, check errno.
+         */
+        bool begin(void);
+
+        /**
+         * Stop the simulator thread and close the pty.
+         */
+        void end(void);
+
+        /**
+         * Get pty device path to open.
+         */
+        const char *device(void);
+
+        /**
+         * Answer "busy p..." to the next commands.
+         *
+         * @param count - Commands answered busy.
+         */
+        void setBusy(uint8_t count);
+
+        /**
+         * Stop/Resume answering commands, simulates a hung module.
+         */
+        void setSilent(bool silent);
+
+        /**
+         * Stop answering commands until AT+RST, simulates a module whose
+         * firmware is stuck but still takes a software reset.
+         */
+        void hang(void);
+
+        /**
+         * Refuse/Accept next AT+CIPSTART.
+         */
+        void setConnectFail(bool fail);
+
+        /**
+         * Take AT+CIPSEND data without answering "Recv <n> bytes" nor "SEND OK",
+         * simulates a send timing out after the bytes were written. Data is dropped.
+         */
+        void setSendStall(bool stall);
+
+        /**
+         * Answer the next command late, simulates a slow module. Commands
+         * received meanwhile are answered afterwards, in order.
+         *
+         * @param ms - Delay (ms).
+         */
+        void setReplyDelay(uint32_t ms);
+
+        /**
+         * Set remote end of the TCP connection, NULL drops sent data.
+         */
+        void setPeer(ModemPeer *peer);
+
+        /**
+         * Receive data from the remote end, as "+IPD,<len>:<data>" in active
+         * mode or as a "+IPD,<len>" notification in passive mode.
+         */
+        void deliver(const std::string &data);
+
+        /**
+         * Receive data from the remote end in the middle of the next
+         * AT+CIPSEND, between "Recv <n> bytes" and "SEND OK".
+         */
+        void deliverDuringSend(const std::string &data);
+
+        /**
+         * Close the connection from the remote end.
+         */
+        void closeRemote(void);
+
+        /**
+         * Check if a TCP connection is open.
+         */
+        bool linkOpen(void);
+
+        /**
+         * Check if passive receive mode is enabled.
+         */
+        bool passive(void);
+
+        /**
+         * Check if commands are echoed (ATE1, the default after a reset).
+         */
+        bool echo(void);
+
+        /**
+         * Get commands received so far, without line end.
+         */
+        std::vector<std::string> commands(void);
+
+        /**
+         * Get data sent with AT+CIPSEND so far.
+         */
+        std::string sent(void);
+
+    private:
+        int _master;
+        int _slave;
+        char _device[64];
+        std::thread _thread;
+        std::atomic<bool> _running;
+
+        /* State is shared with the test thread and peer callbacks */
+        std::recursive_mutex _lock;
+        uint8_t _busy;
+        bool _silent;
+        bool _hung;
+        bool _connectFail;
+        bool _sendStall;
+        uint32_t _replyDelay;
+        bool _linkOpen;
+        bool _passive;
+        bool _echo;
+        ModemPeer *_peer;
+        std::string _held;           /* Passive mode data not read yet */
+        std::string _duringSend;     /* Data to deliver within next AT+CIPSEND */
+        std::vector<std::string> _commands;
+        std::string _sent;
+
+        std::string _input;
+        uint32_t _sendLeft;          /* AT+CIPSEND bytes still expected */
+        std::string _sendData;
+
+        void run(void);
+        void process(void);
+        void handle(const std::string &cmd);
+        void reply(const std::string &rsp);
+};
+
+#endif /* ESP8266_MODEM_SIM_H */
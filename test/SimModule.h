@@ -0,0 +1,42 @@
+/**
+ * @file SimModule.h
+ * @brief ESP8266 driver connected to its own simulated modem.
+ */
+
+#ifndef ESP8266_SIM_MODULE_H
+#define ESP8266_SIM_MODULE_H
+
+#include "ESP8266.h"
+#include "ESP8266LinuxSerial.h"
+#include "ModemSim.h"
+
+/**
+ * Simulated modem, pty port and driver, ready to use once begin() succeeds.
+ */
+class SimModule
+{
+    public:
+        SimModule(void) : esp(-1, -1) { }
+
+        ~SimModule(void)
+        {
+            port.end();
+            sim.end();
+        }
+
+        bool begin(void)
+        {
+            if (!sim.begin() || !port.begin(sim.device(), 115200))
+            {
+                return false;
+            }
+            esp.begin(port);
+            return true;
+        }
+
+        ModemSim sim;
+        ESP8266LinuxSerial port;
+        ESP8266 esp;
+};
+
+#endif /* ESP8266_SIM_MODULE_H */
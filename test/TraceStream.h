@@ -0,0 +1,54 @@
+/**
+ * @file TraceStream.h
+ * @brief Stream replaying recorded module output from memory.
+ */
+
+#ifndef ESP8266_TRACE_STREAM_H
+#define ESP8266_TRACE_STREAM_H
+
+#include <string>
+
+#include "Arduino.h"
+
+/**
+ * Replays a recorded trace to the driver and drops what the driver writes,
+ * so the response path can be run without a modem or a pty. Reads never
+ * wait, a drained trace reads as -1.
+ */
+class TraceStream: public Stream
+{
+    public:
+        TraceStream(void) : _pos(0) { setTimeout(0); }
+
+        /**
+         * Set trace to replay, from its first byte.
+         */
+        void load(const std::string &trace)
+        {
+            _trace = trace;
+            _pos = 0;
+        }
+
+        /**
+         * Replay current trace again.
+         */
+        void rewind(void) { _pos = 0; }
+
+        /**
+         * Get bytes read by the driver since last load()/rewind().
+         */
+        size_t consumed(void) { return _pos; }
+
+        virtual size_t write(uint8_t c) { (void) c; return 1; }
+        virtual size_t write(const uint8_t *buffer, size_t size) { (void) buffer; return size; }
+        using Print::write;
+        virtual int available(void) { return (int) (_trace.size() - _pos); }
+        virtual int read(void) { return (_pos < _trace.size()) ? (uint8_t) _trace[_pos++] : -1; }
+        virtual int peek(void) { return (_pos < _trace.size()) ? (uint8_t) _trace[_pos] : -1; }
+
+    private:
+        std::string _trace;
+        size_t _pos;
+};
+
+#endif /* ESP8266_TRACE_STREAM_H */
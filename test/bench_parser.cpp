@@ -0,0 +1,208 @@
+/**
+ * @file bench_parser.cpp
+ * @brief Parser throughput on recorded CWLAP, CIFSR, +IPD and HTTP traces (Google Benchmark).
+ *
+ * Line benchmarks time the static parsers alone. Response benchmarks replay
+ * the whole trace through the driver (readBytesUntil(), getResponse() and the
+ * +IPD receive path) from memory, so the numbers don't include any I/O.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+#include <vector>
+
+#include "ESP8266.h"
+#include "TraceStream.h"
+
+/* Recorded responses */
+static const std::vector<std::string> cwlapLines = {
+    "+CWLAP:(3,\"HomeNetwork\",-62,\"a0:f3:c1:12:34:56\",6,-8,0)\r",
+    "+CWLAP:(4,\"Office-5G\",-71,\"18:e8:29:ab:cd:ef\",11,10,0)\r",
+    "+CWLAP:(0,\"Guest\",-85,\"00:1d:7e:00:11:22\",1,-2,0)\r",
+    "+CWLAP:(3,\"Neighbour\",-90,\"c8:d3:a3:10:20:30\",1,-4,0)\r",
+};
+
+static const std::vector<std::string> cifsrLines = {
+    "+CIFSR:STAIP,\"192.168.1.105\"\r",
+    "+CIFSR:STAMAC,\"5c:cf:7f:01:02:03\"\r",
+    "\r",
+    "OK\r",
+};
+
+static const std::vector<std::string> ipdLines = {
+    "+IPD,512:",
+    "+IPD,0,1460:",
+    "+IPD,4,38\r",
+    "+IPD,20\r",
+};
+
+static const std::vector<std::string> httpLines = {
+    "+IPD,211:HTTP/1.1 200 OK\r",
+    "Content-Type: application/json\r",
+    "Content-Length: 61\r",
+    "Connection: close\r",
+    "\r",
+    "{\"temp\":21.5,\"hum\":40,\"status\":\"ok\",\"ts\":1476789012}\r",
+};
+
+static std::string join(const std::vector<std::string> &lines)
+{
+    std::string trace;
+
+    for (const std::string &line : lines)
+    {
+        trace += line + "\n";
+    }
+    return trace;
+}
+
+/* parseLine() on each line, like getResponse() does */
+static void parseLines(benchmark::State &state, const std::vector<std::string> &lines,
+                       const char *pass, char delimA, char delimB)
+{
+    char line[ESP8266_RX_BUFF_LEN];
+    char dest[ESP8266_RX_BUFF_LEN];
+    int64_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        for (const std::string &text : lines)
+        {
+            /* Parser modifies the line, so work on a copy */
+            memcpy(line, text.c_str(), text.size() + 1);
+            benchmark::DoNotOptimize(ESP8266::parseLine(line, (uint8_t) text.size(), dest, sizeof(dest),
+                                                        pass, NULL, delimA, delimB));
+            bytes += (int64_t) text.size();
+        }
+    }
+    state.SetBytesProcessed(bytes);
+}
+
+static void BM_ParseLine_CWLAP(benchmark::State &state)
+{
+    parseLines(state, cwlapLines, "+CWLAP:", '"', '"');
+}
+BENCHMARK(BM_ParseLine_CWLAP);
+
+static void BM_ParseLine_CIFSR(benchmark::State &state)
+{
+    parseLines(state, cifsrLines, "+CIFSR:STAIP,", '"', '"');
+}
+BENCHMARK(BM_ParseLine_CIFSR);
+
+static void BM_ParseLine_HTTP(benchmark::State &state)
+{
+    parseLines(state, httpLines, "+IPD", ' ', ' ');
+}
+BENCHMARK(BM_ParseLine_HTTP);
+
+static void BM_ParseIPD(benchmark::State &state)
+{
+    int8_t link = 0;
+    int64_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        for (const std::string &text : ipdLines)
+        {
+            benchmark::DoNotOptimize(ESP8266::parseIPD(text.c_str(), &link));
+            bytes += (int64_t) text.size();
+        }
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_ParseIPD);
+
+/* Driver reading a trace from memory */
+class ResponseBench
+{
+    public:
+        ResponseBench(const std::string &trace) : esp(-1, -1)
+        {
+            stream.load(trace);
+            esp.begin(stream);
+        }
+
+        TraceStream stream;
+        ESP8266 esp;
+};
+
+static void BM_Response_CIFSR(benchmark::State &state)
+{
+    ResponseBench bench(join(cifsrLines));
+    char ip[ESP8266_IP_LEN];
+    int64_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        bench.stream.rewind();
+        benchmark::DoNotOptimize(bench.esp.localIP(ip, sizeof(ip)));
+        bytes += (int64_t) bench.stream.consumed();
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_Response_CIFSR);
+
+static void BM_Response_CWLAP(benchmark::State &state)
+{
+    ResponseBench bench(join(cwlapLines));
+    int64_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        bench.stream.rewind();
+        benchmark::DoNotOptimize(bench.esp.requestAPList());
+        for (size_t i = 1; i < cwlapLines.size(); i++)
+        {
+            benchmark::DoNotOptimize(bench.esp.getNextAP());
+        }
+        bytes += (int64_t) bench.stream.consumed();
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_Response_CWLAP);
+
+static void BM_Response_HTTP(benchmark::State &state)
+{
+    ResponseBench bench(join(httpLines));
+    int64_t bytes = 0;
+
+    for (auto _ : state)
+    {
+        bench.stream.rewind();
+        benchmark::DoNotOptimize(bench.esp.httpStatus());
+        bytes += (int64_t) bench.stream.consumed();
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_Response_HTTP);
+
+/* Active mode frames of state.range(0) bytes, read with a 64 bytes buffer */
+static void BM_Response_IPD(benchmark::State &state)
+{
+    std::string payload((size_t) state.range(0), 'x');
+    std::string trace;
+    uint8_t buffer[64];
+    int64_t bytes = 0;
+
+    for (int i = 0; i < 8; i++)
+    {
+        trace += "\r\n+IPD," + std::to_string(payload.size()) + ":" + payload;
+    }
+    ResponseBench bench(trace);
+
+    for (auto _ : state)
+    {
+        bench.stream.rewind();
+        while (0 < bench.stream.available())
+        {
+            benchmark::DoNotOptimize(bench.esp.receive(buffer, sizeof(buffer), 0));
+        }
+        bytes += (int64_t) bench.stream.consumed();
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_Response_IPD)->Arg(16)->Arg(512)->Arg(1460);
+
+BENCHMARK_MAIN();
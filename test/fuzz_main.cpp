@@ -0,0 +1,162 @@
+/**
+ * @file fuzz_main.cpp
+ * @brief Standalone driver for fuzz harnesses when libFuzzer isn't available (GCC).
+ *
+ * Accepts a subset of libFuzzer's command line, so the same ctest entry works
+ * with both builds:
+ *   fuzz_parser [-runs=N] [-seed=S] [corpus dir or file]...
+ *
+ * Corpus inputs are replayed first, then N inputs are made by mutating them.
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define FUZZ_MAX_LEN    (512)  /* Longest input made by mutation */
+
+/* Bytes with a meaning for the parsers, mutations prefer them */
+static const char fuzzTokens[] = "\r\n\",:+()-0123456789 >";
+
+static void loadFile(const char *path, std::vector<std::string> &corpus)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+
+    if (file)
+    {
+        content << file.rdbuf();
+        corpus.push_back(content.str());
+    }
+}
+
+static void loadPath(const char *path, std::vector<std::string> &corpus)
+{
+    struct stat info;
+    DIR *dir = NULL;
+    struct dirent *entry = NULL;
+    std::string file;
+
+    if (0 != stat(path, &info))
+    {
+        fprintf(stderr, "Can't open %s\n", path);
+        return;
+    }
+    if (!S_ISDIR(info.st_mode))
+    {
+        loadFile(path, corpus);
+        return;
+    }
+
+    dir = opendir(path);
+    while ((NULL != dir) && (NULL != (entry = readdir(dir))))
+    {
+        if ('.' != entry->d_name[0])
+        {
+            file = std::string(path) + "/" + entry->d_name;
+            loadFile(file.c_str(), corpus);
+        }
+    }
+    if (NULL != dir)
+    {
+        closedir(dir);
+    }
+}
+
+static std::string mutate(std::string input, std::mt19937 &rng)
+{
+    uint32_t count = 1 + (rng() % 8);
+    size_t pos = 0;
+    size_t len = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        pos = input.empty() ? 0 : (rng() % input.size());
+        switch (rng() % 6)
+        {
+            case 0: /* Flip a bit */
+                if (!input.empty())
+                {
+                    input[pos] = (char) (input[pos] ^ (1 << (rng() % 8)));
+                }
+                break;
+            case 1: /* Random byte */
+                input.insert(pos, 1, (char) rng());
+                break;
+            case 2: /* Token */
+                input.insert(pos, 1, fuzzTokens[rng() % (sizeof(fuzzTokens) - 1)]);
+                break;
+            case 3: /* Remove a piece */
+                len = input.empty() ? 0 : (1 + (rng() % 16));
+                input.erase(pos, len);
+                break;
+            case 4: /* Repeat a piece, makes long lines and numbers */
+                len = 1 + (rng() % 32);
+                input.insert(pos, input.substr(pos, len));
+                break;
+            default: /* Cut */
+                input.resize(pos);
+                break;
+        }
+    }
+    if (FUZZ_MAX_LEN < input.size())
+    {
+        input.resize(FUZZ_MAX_LEN);
+    }
+
+    return input;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> corpus;
+    unsigned long runs = 10000;
+    unsigned long seed = 1;
+    std::string input;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (0 == strncmp(argv[i], "-runs=", 6))
+        {
+            runs = strtoul(&argv[i][6], NULL, 10);
+        }
+        else if (0 == strncmp(argv[i], "-seed=", 6))
+        {
+            seed = strtoul(&argv[i][6], NULL, 10);
+        }
+        else if ('-' != argv[i][0])
+        {
+            loadPath(argv[i], corpus);
+        }
+    }
+
+    for (const std::string &entry : corpus)
+    {
+        (void) LLVMFuzzerTestOneInput((const uint8_t *) entry.data(), entry.size());
+    }
+
+    std::mt19937 rng((std::mt19937::result_type) seed);
+    if (corpus.empty())
+    {
+        corpus.push_back(std::string());
+    }
+    for (unsigned long run = 0; run < runs; run++)
+    {
+        input = mutate(corpus[rng() % corpus.size()], rng);
+        (void) LLVMFuzzerTestOneInput((const uint8_t *) input.data(), input.size());
+    }
+
+    printf("Done %lu runs, %zu corpus inputs, seed %lu\n", runs, corpus.size(), seed);
+    return 0;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file fuzz_parser.cpp
+ * @brief libFuzzer harness over the response and +IPD parsers.
+ *
+ * Input is used twice: as a single line fed straight to the static parsers,
+ * with guard bytes around the destination, and as a module output trace
+ * replayed through getResponse() and the +IPD receive path. For the trace,
+ * first byte selects the driver path ('0'..'4' in the seed corpus) and the
+ * rest is the module output.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "ESP8266.h"
+#include "TraceStream.h"
+
+#define GUARD_LEN   (8)
+#define GUARD_BYTE  (0xA5)
+
+/* Driver paths reading a trace */
+#define FUZZ_PATH_CIFSR     (0)  /* Quoted instance into a small buffer */
+#define FUZZ_PATH_CWLAP     (1)  /* AP list, one line after another */
+#define FUZZ_PATH_HTTP      (2)  /* Space delimited instance */
+#define FUZZ_PATH_IPD       (3)  /* Active mode +IPD frames */
+#define FUZZ_PATH_PASSIVE   (4)  /* "+IPD,<len>" notifications while waiting for a response */
+#define FUZZ_PATH_COUNT     (5)
+
+static void check(bool condition)
+{
+    if (!condition)
+    {
+        abort();
+    }
+}
+
+static void fuzzLine(const uint8_t *data, size_t size)
+{
+    /* Line as getResponse() reads it: at most RX buffer length - 1 bytes, NULL terminated */
+    uint8_t line[GUARD_LEN + ESP8266_RX_BUFF_LEN + GUARD_LEN];
+    uint8_t dest[GUARD_LEN + ESP8266_RX_BUFF_LEN + GUARD_LEN];
+    size_t len = (size < (ESP8266_RX_BUFF_LEN - 1)) ? size : (ESP8266_RX_BUFF_LEN - 1);
+    size_t destLen = (0 < size) ? (1 + (data[0] % ESP8266_RX_BUFF_LEN)) : 1;
+    char *text = (char *) &line[GUARD_LEN];
+    esp8266_ap_t ap;
+    int8_t link = 0;
+
+    memset(line, GUARD_BYTE, sizeof(line));
+    memset(dest, GUARD_BYTE, sizeof(dest));
+    memcpy(text, data, len);
+    text[len] = '\0';
+
+    (void) ESP8266::parseIPD(text, &link);
+    (void) ESP8266::parseClosed(text, &link);
+    (void) ESP8266::parseAP(text, &ap);
+    (void) ESP8266::parsePing(text);
+
+    /* parseLine() may cut the line, run it last */
+    (void) ESP8266::parseLine(text, (uint8_t) len, (char *) &dest[GUARD_LEN], destLen,
+                              "+CIFSR:STAIP,", "FAIL", '"', '"');
+
+    for (size_t i = 0; i < GUARD_LEN; i++)
+    {
+        check(GUARD_BYTE == line[i]);
+        check(GUARD_BYTE == line[GUARD_LEN + ESP8266_RX_BUFF_LEN + i]);
+        check(GUARD_BYTE == dest[i]);
+        check(GUARD_BYTE == dest[GUARD_LEN + destLen + i]);
+    }
+}
+
+static void fuzzTrace(const uint8_t *data, size_t size)
+{
+    TraceStream trace;
+    ESP8266 esp(-1, -1);
+    esp8266_retry_policy_t policy;
+    uint8_t buffer[64];
+    char ip[ESP8266_IP_LEN];
+    uint8_t path = (0 < size) ? ((uint8_t) (data[0] - '0') % FUZZ_PATH_COUNT) : FUZZ_PATH_CIFSR;
+    std::string output;
+
+    if (0 < size)
+    {
+        output.assign((const char *) &data[1], size - 1);
+    }
+
+    /* Trace always ends with ERROR, so every command returns without waiting for a timeout */
+    if (FUZZ_PATH_PASSIVE == path)
+    {
+        output = "\r\nOK\r\n" + output;
+    }
+    if (FUZZ_PATH_IPD != path)
+    {
+        output += "\r\nERROR\r\n";
+    }
+    trace.load(output);
+
+    esp.begin(trace);
+    esp.retryPolicy(&policy);
+    policy.attempts = 1;
+    esp.setRetryPolicy(&policy);
+
+    switch (path)
+    {
+        case FUZZ_PATH_CIFSR:
+            (void) esp.localIP(ip, sizeof(ip));
+            break;
+        case FUZZ_PATH_CWLAP:
+            if (NULL != esp.requestAPList())
+            {
+                while (NULL != esp.getNextAP())
+                {
+                }
+            }
+            break;
+        case FUZZ_PATH_HTTP:
+            (void) esp.httpStatus();
+            break;
+        case FUZZ_PATH_IPD:
+            while (0 < trace.available())
+            {
+                (void) esp.receive(buffer, sizeof(buffer), 0);
+            }
+            break;
+        case FUZZ_PATH_PASSIVE:
+            if (esp.receiveMode(true))
+            {
+                (void) esp.localIP(ip, sizeof(ip));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    fuzzLine(data, size);
+    fuzzTrace(data, size);
+    return 0;
+}
@@ -0,0 +1,260 @@
+/**
+ * @file Arduino.cpp
+ * @brief Minimal Arduino core for host builds of the library tests.
+ */
+
+#include "Arduino.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+
+void pinMode(int pin, int mode)
+{
+    (void) pin;
+    (void) mode;
+}
+
+void digitalWrite(int pin, int value)
+{
+    (void) pin;
+    (void) value;
+}
+
+unsigned long millis(void)
+{
+    return (unsigned long) std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+unsigned long micros(void)
+{
+    return (unsigned long) std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+long random(long max)
+{
+    return (0 < max) ? (rand() % max) : 0;
+}
+
+long random(long min, long max)
+{
+    return (min < max) ? (min + random(max - min)) : min;
+}
+
+void randomSeed(unsigned long seed)
+{
+    srand((unsigned int) seed);
+}
+
+char *ultoa(unsigned long value, char *str, int base)
+{
+    char tmp[sizeof(unsigned long) * 8 + 1];
+    size_t len = 0;
+
+    if ((2 > base) || (36 < base))
+    {
+        base = 10;
+    }
+    do
+    {
+        tmp[len++] = "0123456789abcdefghijklmnopqrstuvwxyz"[value % (unsigned long) base];
+        value /= (unsigned long) base;
+    } while (0 < value);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        str[i] = tmp[len - 1 - i];
+    }
+    str[len] = '\0';
+    return str;
+}
+
+char *ltoa(long value, char *str, int base)
+{
+    /* Like avr-libc, only base 10 values are printed with a sign */
+    if ((0 > value) && (10 == base))
+    {
+        str[0] = '-';
+        (void) ultoa(0UL - (unsigned long) value, &str[1], base);
+    }
+    else
+    {
+        (void) ultoa((unsigned long) value, str, base);
+    }
+    return str;
+}
+
+char *itoa(int value, char *str, int base)
+{
+    return ltoa(value, str, base);
+}
+
+char *utoa(unsigned int value, char *str, int base)
+{
+    return ultoa(value, str, base);
+}
+
+/* Print */
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t count = 0;
+    while ((count < size) && (1 == write(buffer[count])))
+    {
+        count++;
+    }
+    return count;
+}
+
+size_t Print::print(long value, int base)
+{
+    char str[sizeof(long) * 8 + 2];
+    return write(ltoa(value, str, base));
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+    char str[sizeof(long) * 8 + 1];
+    return write(ultoa(value, str, base));
+}
+
+size_t Print::print(double value, int digits)
+{
+    char str[64];
+    snprintf(str, sizeof(str), "%.*f", digits, value);
+    return write(str);
+}
+
+/* Stream */
+
+int Stream::timedRead(void)
+{
+    unsigned long start = millis();
+    int c = -1;
+
+    do
+    {
+        c = read();
+    } while ((0 > c) && (_timeout > (millis() - start)));
+
+    return c;
+}
+
+int Stream::timedPeek(void)
+{
+    unsigned long start = millis();
+    int c = -1;
+
+    do
+    {
+        c = peek();
+    } while ((0 > c) && (_timeout > (millis() - start)));
+
+    return c;
+}
+
+bool Stream::find(const char *target)
+{
+    size_t len = strlen(target);
+    size_t matched = 0;
+    int c = 0;
+
+    while (matched < len)
+    {
+        c = timedRead();
+        if (0 > c)
+        {
+            return false;
+        }
+        if (c == target[matched])
+        {
+            matched++;
+        }
+        else
+        {
+            matched = (c == target[0]) ? 1 : 0;
+        }
+    }
+
+    return true;
+}
+
+long Stream::parseInt(void)
+{
+    long value = 0;
+    bool negative = false;
+    int c = timedPeek();
+
+    /* Skip anything before the number, like Arduino's SKIP_ALL */
+    while ((0 <= c) && ('-' != c) && !isdigit(c))
+    {
+        (void) read();
+        c = timedPeek();
+    }
+    if ('-' == c)
+    {
+        negative = true;
+        (void) read();
+        c = timedPeek();
+    }
+    while ((0 <= c) && isdigit(c))
+    {
+        value = (value * 10) + (c - '0');
+        (void) read();
+        c = timedPeek();
+    }
+
+    return negative ? -value : value;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    int c = 0;
+
+    while (count < length)
+    {
+        c = timedRead();
+        if (0 > c)
+        {
+            break;
+        }
+        buffer[count++] = (char) c;
+    }
+
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
+{
+    size_t count = 0;
+    int c = 0;
+
+    while (count < length)
+    {
+        c = timedRead();
+        if ((0 > c) || (terminator == c))
+        {
+            break;
+        }
+        buffer[count++] = (char) c;
+    }
+
+    return count;
+}
+
+/* HardwareSerial */
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return (EOF != putchar(c)) ? 1 : 0;
+}
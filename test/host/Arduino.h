@@ -0,0 +1,143 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core for host builds of the library tests.
+ *
+ * Only what the library uses is provided: Print, Stream, String, timing and
+ * pin stubs. Serial writes to stdout.
+ */
+
+#ifndef ESP8266_HOST_ARDUINO_H
+#define ESP8266_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+
+#define LOW                 (0)
+#define HIGH                (1)
+#define INPUT               (0)
+#define OUTPUT              (1)
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *) (addr))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+#define F(str) ((const __FlashStringHelper *) (str))
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+char *itoa(int value, char *str, int base);
+char *ltoa(long value, char *str, int base);
+char *utoa(unsigned int value, char *str, int base);
+char *ultoa(unsigned long value, char *str, int base);
+
+class String
+{
+    public:
+        String(const char *str = "") : _str((NULL != str) ? str : "") { }
+        String(char c) : _str(1, c) { }
+        String(int value) : _str(std::to_string(value)) { }
+        String(unsigned int value) : _str(std::to_string(value)) { }
+        String(long value) : _str(std::to_string(value)) { }
+        String(unsigned long value) : _str(std::to_string(value)) { }
+
+        unsigned int length(void) const { return (unsigned int) _str.size(); }
+        const char *c_str(void) const { return _str.c_str(); }
+
+        String &operator+=(const String &rhs) { _str += rhs._str; return *this; }
+        String &operator+=(const char *rhs) { _str += rhs; return *this; }
+        String &operator+=(char rhs) { _str += rhs; return *this; }
+        bool operator==(const char *rhs) const { return _str == rhs; }
+
+        friend String operator+(const String &lhs, const String &rhs)
+        {
+            String ret(lhs);
+            ret += rhs;
+            return ret;
+        }
+
+    private:
+        std::string _str;
+};
+
+class Print
+{
+    public:
+        virtual ~Print(void) { }
+
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t *buffer, size_t size);
+        size_t write(const char *str) { return (NULL != str) ? write((const uint8_t *) str, strlen(str)) : 0; }
+        size_t write(const char *buffer, size_t size) { return write((const uint8_t *) buffer, size); }
+        virtual void flush(void) { }
+
+        size_t print(const __FlashStringHelper *str) { return write((const char *) str); }
+        size_t print(const String &str) { return write(str.c_str()); }
+        size_t print(const char *str) { return write(str); }
+        size_t print(char c) { return write((uint8_t) c); }
+        size_t print(int value, int base = 10) { return print((long) value, base); }
+        size_t print(unsigned int value, int base = 10) { return print((unsigned long) value, base); }
+        size_t print(long value, int base = 10);
+        size_t print(unsigned long value, int base = 10);
+        size_t print(double value, int digits = 2);
+
+        size_t println(void) { return write("\r\n"); }
+        template <typename T> size_t println(T value) { return print(value) + println(); }
+        template <typename T> size_t println(T value, int format) { return print(value, format) + println(); }
+};
+
+class Stream: public Print
+{
+    public:
+        Stream(void) : _timeout(1000) { }
+
+        virtual int available(void) = 0;
+        virtual int read(void) = 0;
+        virtual int peek(void) = 0;
+
+        void setTimeout(unsigned long timeout) { _timeout = timeout; }
+        bool find(const char *target);
+        bool find(char *target) { return find((const char *) target); }
+        long parseInt(void);
+        size_t readBytes(char *buffer, size_t length);
+        size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *) buffer, length); }
+        size_t readBytesUntil(char terminator, char *buffer, size_t length);
+
+    protected:
+        unsigned long _timeout;
+
+        int timedRead(void);
+        int timedPeek(void);
+};
+
+class HardwareSerial: public Stream
+{
+    public:
+        void begin(unsigned long baud) { (void) baud; }
+
+        virtual size_t write(uint8_t c);
+        using Print::write;
+        virtual int available(void) { return 0; }
+        virtual int read(void) { return -1; }
+        virtual int peek(void) { return -1; }
+
+        operator bool(void) { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif /* ESP8266_HOST_ARDUINO_H */
@@ -0,0 +1,113 @@
+/**
+ * @file test_async.cpp
+ * @brief ESP8266AsyncModule tests against the simulated modem.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ESP8266Async.h"
+#include "ModemSim.h"
+
+class AsyncTest: public ::testing::Test
+{
+    protected:
+        ModemSim sim;
+        ESP8266LinuxSerial port;
+        ESP8266AsyncModule *module;
+        ESP8266AsyncLoop loop;
+
+        void SetUp(void) override
+        {
+            module = NULL;
+            ASSERT_TRUE(sim.begin());
+            ASSERT_TRUE(port.begin(sim.device(), 115200));
+            module = new ESP8266AsyncModule(port);
+            ASSERT_TRUE(loop.add(*module));
+        }
+
+        void TearDown(void) override
+        {
+            delete module;
+            port.end();
+            sim.end();
+        }
+};
+
+static ESP8266Task runCommands(ESP8266AsyncModule &m, std::vector<int32_t> &results)
+{
+    results.push_back(co_await m.test());
+    results.push_back(co_await m.startTCP("example.com", 80));
+    results.push_back(co_await m.send((const uint8_t *) "hello", 5));
+    results.push_back(co_await m.stopTCP());
+}
+
+static ESP8266Task runTimeout(ESP8266AsyncModule &m, std::vector<int32_t> &results)
+{
+    results.push_back(co_await m.test(100));
+    /* No connection, ERROR is expected, not the late OK of the test */
+    results.push_back(co_await m.stopTCP());
+    results.push_back(co_await m.test());
+}
+
+static ESP8266Task runReceive(ESP8266AsyncModule &m, std::string &data, int32_t &result)
+{
+    uint8_t buffer[64];
+
+    if (co_await m.startTCP("example.com", 80))
+    {
+        result = co_await m.receive(buffer, sizeof(buffer), 2000);
+        if (0 < result)
+        {
+            data.assign((const char *) buffer, (size_t) result);
+        }
+    }
+}
+
+TEST_F(AsyncTest, Commands)
+{
+    std::vector<int32_t> results;
+
+    runCommands(*module, results);
+    loop.run();
+
+    EXPECT_EQ(std::vector<int32_t>({1, 1, 1, 1}), results);
+    EXPECT_EQ("hello", sim.sent());
+    EXPECT_FALSE(module->connected());
+}
+
+TEST_F(AsyncTest, TimeoutThenNextCommand)
+{
+    std::vector<int32_t> results;
+
+    /* OK of the first command comes after it timed out */
+    sim.setReplyDelay(300);
+    runTimeout(*module, results);
+    loop.run();
+
+    EXPECT_EQ(std::vector<int32_t>({0, 0, 1}), results);
+    EXPECT_FALSE(module->pending());
+}
+
+TEST_F(AsyncTest, ReceiveWaitsForData)
+{
+    std::string data;
+    int32_t result = -2;
+    std::thread remote([&](void)
+    {
+        /* Receive is already waiting when the frame comes */
+        usleep(200000);
+        sim.deliver("hello\r\nworld");
+    });
+
+    runReceive(*module, data, result);
+    loop.run();
+    remote.join();
+
+    EXPECT_EQ(12, result);
+    EXPECT_EQ("hello\r\nworld", data);
+    EXPECT_EQ(0U, module->dropped());
+}
@@ -0,0 +1,175 @@
+/**
+ * @file test_bridge.cpp
+ * @brief ESP8266Bridge tests: uplink batching and downlink in both receive modes.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <unistd.h>
+
+#include "ESP8266Bridge.h"
+#include "SimModule.h"
+
+/* Local device, bytes pushed by the test are read by the bridge */
+class LocalPort: public Stream
+{
+    public:
+        std::string input;
+        std::string output;       /* Written by the bridge */
+
+        virtual size_t write(uint8_t c) { output += (char) c; return 1; }
+        virtual size_t write(const uint8_t *buffer, size_t size)
+        {
+            output.append((const char *) buffer, size);
+            return size;
+        }
+        using Print::write;
+        virtual int available(void) { return (int) input.size(); }
+        virtual int read(void)
+        {
+            int c = peek();
+            if (0 <= c)
+            {
+                input.erase(0, 1);
+            }
+            return c;
+        }
+        virtual int peek(void) { return input.empty() ? -1 : (uint8_t) input[0]; }
+};
+
+class BridgeTest: public ::testing::Test
+{
+    protected:
+        SimModule module;
+        LocalPort local;
+        ESP8266Bridge bridge;
+
+        BridgeTest(void) : bridge(module.esp, local) { }
+
+        void SetUp(void) override
+        {
+            ASSERT_TRUE(module.begin());
+        }
+
+        size_t countCommands(const std::string &prefix)
+        {
+            size_t count = 0;
+            for (const std::string &line : module.sim.commands())
+            {
+                count += (0 == line.compare(0, prefix.size(), prefix)) ? 1 : 0;
+            }
+            return count;
+        }
+
+        /* Poll until the local device got len bytes */
+        void pollDown(size_t len)
+        {
+            uint32_t ulStartTime = millis();
+            while ((local.output.size() < len) && (2000 > (millis() - ulStartTime)))
+            {
+                (void) bridge.poll();
+            }
+        }
+
+        std::string pattern(size_t len)
+        {
+            std::string ret;
+            for (size_t i = 0; i < len; i++)
+            {
+                ret += (char) ('a' + (i % 26));
+            }
+            return ret;
+        }
+};
+
+TEST_F(BridgeTest, UplinkBatching)
+{
+    esp8266_bridge_stats_t stats;
+    uint32_t ulStartTime = 0;
+    uint32_t elapsed = 0;
+
+    ASSERT_TRUE(bridge.begin(50));
+    ASSERT_TRUE(module.esp.startTCP((char *) "example.com", 80));
+
+    /* Bytes coming in bursts are sent together once the first one waited the latency */
+    ulStartTime = millis();
+    local.input = "hello ";
+    EXPECT_TRUE(bridge.poll());
+    delay(10);
+    local.input += "world";
+    do
+    {
+        EXPECT_TRUE(bridge.poll());
+        bridge.stats(&stats);
+    } while ((0 == stats.sends) && (1000 > (millis() - ulStartTime)));
+    elapsed = millis() - ulStartTime;
+
+    EXPECT_EQ("hello world", module.sim.sent());
+    EXPECT_EQ(1U, countCommands("AT+CIPSEND="));
+    EXPECT_LE(50U, elapsed);
+    EXPECT_GT(50U + 100U, elapsed);
+
+    /* A full buffer is sent right away */
+    local.input = pattern(ESP8266_BRIDGE_TX_LEN);
+    EXPECT_TRUE(bridge.poll());
+    bridge.stats(&stats);
+    EXPECT_EQ(2U, stats.sends);
+    EXPECT_EQ(11U + ESP8266_BRIDGE_TX_LEN, stats.bytesUp);
+}
+
+TEST_F(BridgeTest, DownlinkActive)
+{
+    std::string data = pattern(3 * ESP8266_BRIDGE_RX_LEN + 10);
+
+    ASSERT_TRUE(bridge.begin());
+    ASSERT_TRUE(module.esp.receiveMode(false));
+    ASSERT_TRUE(module.esp.startTCP((char *) "example.com", 80));
+
+    module.sim.deliver(data.substr(0, 100));
+    module.sim.deliver(data.substr(100));
+    pollDown(data.size());
+    EXPECT_EQ(data, local.output);
+    EXPECT_EQ(0U, countCommands("AT+CIPRECVDATA"));
+}
+
+TEST_F(BridgeTest, DownlinkPassive)
+{
+    std::string data = pattern(3 * ESP8266_BRIDGE_RX_LEN + 10);
+
+    ASSERT_TRUE(bridge.begin());
+    ASSERT_TRUE(module.sim.passive());
+    ASSERT_TRUE(module.esp.startTCP((char *) "example.com", 80));
+
+    /* Nothing is asked for until data is notified */
+    EXPECT_TRUE(bridge.poll());
+    EXPECT_EQ(0U, countCommands("AT+CIPRECVDATA"));
+
+    module.sim.deliver(data.substr(0, 100));
+    module.sim.deliver(data.substr(100));
+    pollDown(data.size());
+    EXPECT_EQ(data, local.output);
+
+    /* Notifications are enough, no AT+CIPRECVLEN? round trip */
+    EXPECT_EQ(0U, countCommands("AT+CIPRECVLEN"));
+    EXPECT_EQ(4U, countCommands("AT+CIPRECVDATA=" + std::to_string(ESP8266_BRIDGE_RX_LEN)) +
+                  countCommands("AT+CIPRECVDATA=10"));
+}
+
+TEST_F(BridgeTest, DownlinkPassiveClosed)
+{
+    ASSERT_TRUE(bridge.begin());
+    ASSERT_TRUE(module.esp.startTCP((char *) "example.com", 80));
+
+    /* "CLOSED" follows the notification, the data is gone with the connection */
+    module.sim.deliver("abc");
+    module.sim.closeRemote();
+    usleep(50000);
+    while (bridge.poll())
+    {
+    }
+    EXPECT_FALSE(module.esp.connected());
+    EXPECT_EQ(0U, countCommands("AT+CIPRECVLEN"));
+    EXPECT_EQ(0U, countCommands("AT+CIPRECVDATA"));
+    EXPECT_EQ("", local.output);
+}
@@ -0,0 +1,254 @@
+/**
+ * @file test_http.cpp
+ * @brief httpDownload() tests against an HTTP server stand-in behind the simulated modem.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SimModule.h"
+
+/**
+ * Answers each GET with a canned response, cut in small +IPD frames so
+ * headers and chunk sizes are split across reads, then closes the connection.
+ * A "Range: bytes=<n>-" request gets the rest of the body with 206.
+ */
+class HttpServerStandIn: public ModemPeer
+{
+    public:
+        HttpServerStandIn(void) : frameLen(7), chunked(false), honorRange(true), closeEarly(false) { }
+
+        std::string body;
+        std::string extraHeaders;  /* Added to every response */
+        size_t frameLen;           /* Response bytes per +IPD frame */
+        bool chunked;              /* Send body with Transfer-Encoding: chunked */
+        bool honorRange;           /* Answer Range requests with 206 */
+        bool closeEarly;           /* Close before the last chunk */
+
+        virtual void onConnect(ModemSim &modem)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            (void) modem;
+            _request.clear();
+        }
+
+        virtual void onData(ModemSim &modem, const std::string &data)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            std::string response;
+            std::string content = body;
+            size_t pos = 0;
+            int status = 200;
+
+            _request += data;
+            if (std::string::npos == _request.find("\r\n\r\n"))
+            {
+                return;
+            }
+            _requests.push_back(_request);
+
+            pos = _request.find("Range: bytes=");
+            if (honorRange && (std::string::npos != pos))
+            {
+                content = body.substr((size_t) atol(_request.c_str() + pos + 13));
+                status = 206;
+            }
+
+            response = "HTTP/1.1 " + std::to_string(status) + ((200 == status) ? " OK" : " Partial Content") + "\r\n";
+            response += extraHeaders;
+            if (chunked)
+            {
+                response += "Transfer-Encoding: chunked\r\n\r\n";
+                response += encodeChunked(content);
+            }
+            else
+            {
+                response += "Content-Length: " + std::to_string(content.size()) + "\r\n\r\n";
+                response += content;
+            }
+
+            for (pos = 0; pos < response.size(); pos += frameLen)
+            {
+                modem.deliver(response.substr(pos, frameLen));
+            }
+            modem.closeRemote();
+        }
+
+        std::vector<std::string> requests(void)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            return _requests;
+        }
+
+    private:
+        std::mutex _lock;
+        std::string _request;
+        std::vector<std::string> _requests;
+
+        /* Uneven chunks, one with an extension, and a trailer field */
+        std::string encodeChunked(const std::string &content)
+        {
+            std::string ret;
+            size_t pos = 0;
+            size_t len = 1;
+            char size[16];
+
+            while (pos < content.size())
+            {
+                len = std::min(len * 3, content.size() - pos);
+                snprintf(size, sizeof(size), "%zX", len);
+                ret += std::string(size) + ((0 == pos) ? ";name=value" : "") + "\r\n";
+                ret += content.substr(pos, len) + "\r\n";
+                pos += len;
+            }
+            if (!closeEarly)
+            {
+                ret += "0\r\nX-Checksum: none\r\n\r\n";
+            }
+            return ret;
+        }
+};
+
+/* Sink taking up to limit bytes */
+class StringSink: public Print
+{
+    public:
+        StringSink(size_t max = (size_t) -1) : limit(max) { }
+
+        std::string data;
+        size_t limit;
+
+        virtual size_t write(uint8_t c) { return write(&c, 1); }
+        virtual size_t write(const uint8_t *buffer, size_t size)
+        {
+            size_t len = std::min(size, limit - data.size());
+            data.append((const char *) buffer, len);
+            return len;
+        }
+};
+
+class HttpTest: public ::testing::Test
+{
+    protected:
+        SimModule module;
+        HttpServerStandIn server;
+        esp8266_download_t state;
+        std::string body;
+
+        void SetUp(void) override
+        {
+            ASSERT_TRUE(module.begin());
+            module.sim.setPeer(&server);
+            memset(&state, 0, sizeof(state));
+
+            /* Includes CR, LF and hex digits, none of it may be taken as framing */
+            for (int i = 0; i < 1000; i++)
+            {
+                body += "0123456789abcdef\r\n"[i % 18];
+            }
+            server.body = body;
+        }
+
+        void TearDown(void) override
+        {
+            module.sim.setPeer(NULL);
+        }
+
+        bool download(Print &sink)
+        {
+            return module.esp.httpDownload((char *) "example.com", 80, "/firmware.bin", sink, &state, 2000);
+        }
+
+        uint32_t crc(const std::string &data)
+        {
+            return ESP8266::crc32(0, (const uint8_t *) data.data(), data.size());
+        }
+};
+
+TEST_F(HttpTest, ContentLength)
+{
+    StringSink sink;
+
+    ASSERT_TRUE(download(sink));
+    EXPECT_EQ(body, sink.data);
+    EXPECT_EQ(200, state.status);
+    EXPECT_EQ(body.size(), state.contentLength);
+    EXPECT_EQ(body.size(), state.bytes);
+    EXPECT_EQ(crc(body), state.crc32);
+    EXPECT_FALSE(module.esp.connected());
+
+    ASSERT_EQ(1U, server.requests().size());
+    EXPECT_EQ(0U, server.requests()[0].find("GET /firmware.bin HTTP/1.1\r\nHost: example.com\r\n"));
+}
+
+TEST_F(HttpTest, Chunked)
+{
+    StringSink sink;
+
+    server.chunked = true;
+    ASSERT_TRUE(download(sink));
+    EXPECT_EQ(body, sink.data);
+    EXPECT_EQ(crc(body), state.crc32);
+    EXPECT_EQ(0U, state.contentLength);
+}
+
+TEST_F(HttpTest, ChunkedTruncated)
+{
+    StringSink sink;
+
+    /* Connection closed before the last chunk, body is incomplete */
+    server.chunked = true;
+    server.closeEarly = true;
+    EXPECT_FALSE(download(sink));
+    EXPECT_EQ(body, sink.data);
+}
+
+TEST_F(HttpTest, UnsupportedEncoding)
+{
+    StringSink sink;
+
+    server.extraHeaders = "Transfer-Encoding: gzip\r\n";
+    EXPECT_FALSE(download(sink));
+    EXPECT_EQ("", sink.data);
+    EXPECT_EQ(0U, state.bytes);
+}
+
+TEST_F(HttpTest, SinkFullThenResume)
+{
+    StringSink sink(300);
+
+    /* Sink takes part of the body and rejects the rest */
+    EXPECT_FALSE(download(sink));
+    EXPECT_EQ(body.substr(0, 300), sink.data);
+    EXPECT_EQ(300U, state.bytes);
+    EXPECT_FALSE(module.esp.connected());
+
+    /* Resume asks for the rest with a range */
+    sink.limit = (size_t) -1;
+    ASSERT_TRUE(download(sink));
+    EXPECT_EQ(206, state.status);
+    EXPECT_EQ(body, sink.data);
+    EXPECT_EQ(body.size(), state.contentLength);
+    EXPECT_EQ(crc(body), state.crc32);
+    ASSERT_EQ(2U, server.requests().size());
+    EXPECT_NE(std::string::npos, server.requests()[1].find("Range: bytes=300-\r\n"));
+}
+
+TEST_F(HttpTest, ChunkedResumeWithoutRange)
+{
+    StringSink sink(500);
+
+    /* Server ignores Range, already delivered bytes are skipped after decoding */
+    server.chunked = true;
+    server.honorRange = false;
+    EXPECT_FALSE(download(sink));
+    sink.limit = (size_t) -1;
+    ASSERT_TRUE(download(sink));
+    EXPECT_EQ(200, state.status);
+    EXPECT_EQ(body, sink.data);
+    EXPECT_EQ(crc(body), state.crc32);
+}
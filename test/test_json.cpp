@@ -0,0 +1,177 @@
+/**
+ * @file test_json.cpp
+ * @brief ESP8266JsonExtractor tests: paths, "*key" fields, escapes and split input.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "ESP8266Json.h"
+
+static const char WEATHER[] =
+    "{\"coord\":{\"lon\":-3.7,\"lat\":40.42},"
+    "\"weather\":[{\"id\":800,\"main\":\"Clear\"},{\"id\":801,\"main\":\"Clouds\"}],"
+    "\"main\":{\"temp\":21.5,\"feels_temp\":20,\"humidity\":40,\"pressure\":\"1013\"},"
+    "\"sys\":{\"wind\":{\"gust\":null,\"temp\":7.25}},"
+    "\"name\":\"Madrid \\\"centro\\\"\\n\\u00e9\\\\\",\"ok\":true,\"empty\":[]}";
+
+class JsonTest: public ::testing::Test
+{
+    protected:
+        ESP8266JsonExtractor json;
+
+        void feed(const std::string &doc)
+        {
+            json.write((const uint8_t *) doc.data(), doc.size());
+        }
+};
+
+TEST_F(JsonTest, DottedPaths)
+{
+    float lat = 0;
+    long id = 0;
+    char main[16];
+    float temp = 0;
+    long pressure = 0;
+
+    ASSERT_TRUE(json.addFloat("coord.lat", &lat));
+    ASSERT_TRUE(json.addInt("weather.1.id", &id));
+    ASSERT_TRUE(json.addString("weather.0.main", main, sizeof(main)));
+    ASSERT_TRUE(json.addFloat("main.temp", &temp));
+    ASSERT_TRUE(json.addInt("main.pressure", &pressure));
+    feed(WEATHER);
+
+    EXPECT_FALSE(json.error());
+    EXPECT_TRUE(json.complete());
+    EXPECT_FLOAT_EQ(40.42f, lat);
+    EXPECT_EQ(801, id);
+    EXPECT_STREQ("Clear", main);
+    EXPECT_FLOAT_EQ(21.5f, temp);
+    /* Quoted number */
+    EXPECT_EQ(1013, pressure);
+}
+
+TEST_F(JsonTest, AnyDepthKey)
+{
+    long humidity = 0;
+    float gust = -1;
+    long ok = 0;
+    float temp = 0;
+
+    ASSERT_TRUE(json.addInt("*humidity", &humidity));
+    ASSERT_TRUE(json.addFloat("*gust", &gust));
+    ASSERT_TRUE(json.addInt("*ok", &ok));
+    ASSERT_TRUE(json.addFloat("*temp", &temp));
+    feed(WEATHER);
+
+    EXPECT_EQ(40, humidity);
+    EXPECT_EQ(1, ok);
+    /* null is not a value */
+    EXPECT_FALSE(json.found(1));
+    EXPECT_FLOAT_EQ(-1, gust);
+    /* Whole key only ("feels_temp" doesn't match), last match wins */
+    EXPECT_FLOAT_EQ(7.25f, temp);
+}
+
+TEST_F(JsonTest, EscapedString)
+{
+    char name[32];
+    char main[4];
+
+    ASSERT_TRUE(json.addString("name", name, sizeof(name)));
+    ASSERT_TRUE(json.addString("weather.1.main", main, sizeof(main)));
+    feed(WEATHER);
+
+    /* Escaped quotes don't end the string, \u sequences become '?' */
+    EXPECT_STREQ("Madrid \"centro\"\n?\\", name);
+    /* Truncated to the buffer */
+    EXPECT_STREQ("Clo", main);
+    EXPECT_TRUE(json.complete());
+}
+
+TEST_F(JsonTest, EscapedKey)
+{
+    long value = 0;
+
+    ASSERT_TRUE(json.addInt("a.say \"hi\".b", &value));
+    feed("{\"a\":{\"say \\\"hi\\\"\":{\"b\":5}}}");
+    EXPECT_FALSE(json.error());
+    EXPECT_EQ(5, value);
+}
+
+TEST_F(JsonTest, SplitAcrossReads)
+{
+    const std::string doc = WEATHER;
+    float temp = 0;
+    long id = 0;
+    char name[32];
+
+    ASSERT_TRUE(json.addFloat("main.temp", &temp));
+    ASSERT_TRUE(json.addInt("weather.1.id", &id));
+    ASSERT_TRUE(json.addString("name", name, sizeof(name)));
+
+    /* Every split point, inside keys, numbers and escape sequences */
+    for (size_t split = 1; split < doc.size(); split++)
+    {
+        temp = 0;
+        id = 0;
+        json.reset();
+        feed(doc.substr(0, split));
+        feed(doc.substr(split));
+        ASSERT_TRUE(json.complete()) << split;
+        ASSERT_FLOAT_EQ(21.5f, temp) << split;
+        ASSERT_EQ(801, id) << split;
+        ASSERT_STREQ("Madrid \"centro\"\n?\\", name) << split;
+    }
+
+    /* Byte by byte, as httpDownload() may deliver it */
+    json.reset();
+    for (char c : doc)
+    {
+        json.write((uint8_t) c);
+    }
+    EXPECT_TRUE(json.complete());
+}
+
+TEST_F(JsonTest, MissingPath)
+{
+    long id = -1;
+    float temp = 0;
+
+    ASSERT_TRUE(json.addInt("weather.2.id", &id));
+    ASSERT_TRUE(json.addFloat("main.temp", &temp));
+    feed(WEATHER);
+
+    EXPECT_FALSE(json.error());
+    EXPECT_FALSE(json.found(0));
+    EXPECT_TRUE(json.found(1));
+    EXPECT_FALSE(json.complete());
+    EXPECT_EQ(-1, id);
+}
+
+TEST_F(JsonTest, Malformed)
+{
+    long value = 0;
+
+    ASSERT_TRUE(json.addInt("b", &value));
+    feed("{\"a\" 1, \"b\": 2}");
+    EXPECT_TRUE(json.error());
+    EXPECT_FALSE(json.found(0));
+}
+
+TEST_F(JsonTest, TooDeep)
+{
+    std::string doc;
+    long value = 0;
+
+    ASSERT_TRUE(json.addInt("*b", &value));
+    for (int i = 0; i <= ESP8266_JSON_MAX_DEPTH; i++)
+    {
+        doc += "[";
+    }
+    doc += "{\"b\":1}";
+    feed(doc);
+    EXPECT_TRUE(json.error());
+    EXPECT_FALSE(json.found(0));
+}
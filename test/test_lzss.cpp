@@ -0,0 +1,205 @@
+/**
+ * @file test_lzss.cpp
+ * @brief ESP8266Lzss frames decoded by the server side decoder (extras/LzssDecode).
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "ESP8266Lzss.h"
+#include "SimModule.h"
+
+class LzssTest: public ::testing::Test
+{
+    protected:
+        SimModule module;
+        ESP8266Lzss lzss;
+
+        LzssTest(void) : lzss(module.esp) { }
+
+        void SetUp(void) override
+        {
+            ASSERT_TRUE(module.begin());
+            ASSERT_TRUE(module.esp.startTCP((char *) "example.com", 5000));
+        }
+
+        /* Run the decoder on a TCP stream, returns decoded data or "<error>" */
+        std::string decode(const std::string &frames)
+        {
+            char path[] = "/tmp/test_lzss_XXXXXX";
+            std::string command;
+            std::string ret;
+            char buffer[256];
+            size_t len = 0;
+            FILE *pipe = NULL;
+            int fd = mkstemp(path);
+
+            if (0 > fd)
+            {
+                return "<error>";
+            }
+            if ((ssize_t) frames.size() != write(fd, frames.data(), frames.size()))
+            {
+                ret = "<error>";
+            }
+            close(fd);
+
+            command = std::string(LZSS_DECODER) + " < " + path + " 2> /dev/null";
+            pipe = popen(command.c_str(), "r");
+            if ((NULL != pipe) && ret.empty())
+            {
+                while (0 < (len = fread(buffer, 1, sizeof(buffer), pipe)))
+                {
+                    ret.append(buffer, len);
+                }
+            }
+            if ((NULL == pipe) || (0 != pclose(pipe)))
+            {
+                ret = "<error>";
+            }
+            unlink(path);
+            return ret;
+        }
+
+        bool send(const std::string &data)
+        {
+            return lzss.send((const uint8_t *) data.data(), (uint32_t) data.size());
+        }
+
+        /* Frame built from ESP8266Lzss::compress() without the send buffer limit */
+        std::string compressedFrame(const std::string &data)
+        {
+            std::vector<uint8_t> payload(2 * data.size() + 16);
+            int32_t len = ESP8266Lzss::compress((const uint8_t *) data.data(), (uint32_t) data.size(),
+                                                payload.data(), (uint32_t) payload.size());
+            std::string frame;
+
+            if (0 > len)
+            {
+                return "";
+            }
+            frame += (char) ESP8266_LZSS_MAGIC;
+            frame += (char) ESP8266_LZSS_COMPRESSED;
+            frame += (char) (len >> 8);
+            frame += (char) len;
+            frame += (char) (data.size() >> 8);
+            frame += (char) data.size();
+            frame.append((const char *) payload.data(), (size_t) len);
+            return frame;
+        }
+
+        /* Bytes without repeats worth a match */
+        static std::string noise(size_t len, uint32_t seed)
+        {
+            std::string ret;
+            for (size_t i = 0; i < len; i++)
+            {
+                seed = (seed * 1103515245U) + 12345U;
+                ret += (char) (seed >> 16);
+            }
+            return ret;
+        }
+
+        static std::string records(size_t len)
+        {
+            std::string ret;
+            for (int i = 0; ret.size() < len; i++)
+            {
+                ret += "{\"id\":" + std::to_string(i % 10) + ",\"temp\":21.5,\"hum\":40}\n";
+            }
+            return ret.substr(0, len);
+        }
+};
+
+TEST_F(LzssTest, Compressed)
+{
+    std::string data = records(200);
+    esp8266_lzss_stats_t stats;
+
+    ASSERT_TRUE(send(data));
+    EXPECT_EQ(ESP8266_LZSS_COMPRESSED, module.sim.sent()[1]);
+    EXPECT_GT(ESP8266_LZSS_HEADER_LEN + data.size(), module.sim.sent().size());
+    EXPECT_EQ(data, decode(module.sim.sent()));
+
+    lzss.stats(&stats);
+    EXPECT_EQ(1U, stats.frames);
+    EXPECT_EQ(0U, stats.stored);
+    EXPECT_GT(100U, stats.ratio);
+}
+
+TEST_F(LzssTest, IncompressibleIsStored)
+{
+    std::string data = noise(100, 1);
+    esp8266_lzss_stats_t stats;
+
+    ASSERT_TRUE(send(data));
+    EXPECT_EQ(ESP8266_LZSS_STORED, module.sim.sent()[1]);
+    EXPECT_EQ(ESP8266_LZSS_HEADER_LEN + data.size(), module.sim.sent().size());
+    EXPECT_EQ(data, decode(module.sim.sent()));
+
+    lzss.stats(&stats);
+    EXPECT_EQ(1U, stats.stored);
+}
+
+TEST_F(LzssTest, LargerThanBuffer)
+{
+    std::string small = records(ESP8266_LZSS_BUFF_LEN * 2);
+    std::string big = noise(ESP8266_LZSS_BUFF_LEN, 2) + records(ESP8266_LZSS_BUFF_LEN * 2);
+    std::string sent;
+
+    ASSERT_GT(big.size(), compressedFrame(big).size());
+
+    /* Compresses into the buffer */
+    ASSERT_TRUE(send(small));
+    sent = module.sim.sent();
+    EXPECT_EQ(ESP8266_LZSS_COMPRESSED, sent[1]);
+
+    /* Would compress, but not into the buffer, sent stored */
+    ASSERT_TRUE(send(big));
+    EXPECT_EQ(ESP8266_LZSS_STORED, module.sim.sent()[sent.size() + 1]);
+    EXPECT_EQ(sent.size() + ESP8266_LZSS_HEADER_LEN + big.size(), module.sim.sent().size());
+
+    /* One stream, two frames */
+    EXPECT_EQ(small + big, decode(module.sim.sent()));
+}
+
+TEST_F(LzssTest, WindowBoundary)
+{
+    std::string block = noise(ESP8266_LZSS_WINDOW, 3);
+    std::string frame;
+
+    /* Repeat exactly a window back, then one byte too far for a match */
+    frame = compressedFrame(block + block);
+    ASSERT_FALSE(frame.empty());
+    EXPECT_GT(ESP8266_LZSS_HEADER_LEN + (2 * block.size()), frame.size());
+    EXPECT_EQ(block + block, decode(frame));
+
+    block = noise(ESP8266_LZSS_WINDOW + 1, 4);
+    frame = compressedFrame(block + block);
+    ASSERT_FALSE(frame.empty());
+    EXPECT_LT(2 * block.size(), frame.size());
+    EXPECT_EQ(block + block, decode(frame));
+
+    /* Longest matches, overlapping the current position */
+    block = std::string(3 * ESP8266_LZSS_MAX_MATCH + 7, 'a');
+    frame = compressedFrame(block);
+    ASSERT_FALSE(frame.empty());
+    EXPECT_EQ(block, decode(frame));
+}
+
+TEST_F(LzssTest, CorruptedFrame)
+{
+    std::string frame = compressedFrame(records(100));
+
+    /* Match distance before the start of the data */
+    ASSERT_LT(8U, frame.size());
+    frame[ESP8266_LZSS_HEADER_LEN] = 0;
+    frame[ESP8266_LZSS_HEADER_LEN + 1] = 10;
+    EXPECT_EQ("<error>", decode(frame));
+}
@@ -0,0 +1,214 @@
+/**
+ * @file test_modem.cpp
+ * @brief Driver tests against the simulated modem, over ESP8266LinuxSerial.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "ESP8266.h"
+#include "ESP8266LinuxSerial.h"
+#include "ModemSim.h"
+
+class ModemTest: public ::testing::Test
+{
+    protected:
+        ModemSim sim;
+        ESP8266LinuxSerial port;
+        ESP8266 esp;
+
+        ModemTest(void) : esp(-1, -1) { }
+
+        void SetUp(void) override
+        {
+            ASSERT_TRUE(sim.begin());
+            ASSERT_TRUE(port.begin(sim.device(), 115200));
+            esp.begin(port);
+        }
+
+        void TearDown(void) override
+        {
+            port.end();
+            sim.end();
+        }
+
+        bool sentCommand(const std::string &cmd)
+        {
+            for (const std::string &line : sim.commands())
+            {
+                if (line == cmd)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /* Single attempt, so failures don't wait for the retry backoff */
+        void noRetries(void)
+        {
+            esp8266_retry_policy_t policy;
+            esp.retryPolicy(&policy);
+            policy.attempts = 1;
+            esp.setRetryPolicy(&policy);
+        }
+};
+
+TEST_F(ModemTest, Test)
+{
+    EXPECT_TRUE(esp.test());
+    EXPECT_TRUE(sentCommand("AT"));
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_SUCCESS, esp.lastResult());
+}
+
+TEST_F(ModemTest, JoinAndLocalIP)
+{
+    char ip[ESP8266_IP_LEN];
+
+    EXPECT_TRUE(esp.joinAP((char *) "home", (char *) "secret"));
+    EXPECT_TRUE(sentCommand("AT+CWJAP_CUR=\"home\",\"secret\""));
+    ASSERT_TRUE(esp.localIP(ip));
+    EXPECT_STREQ("192.168.1.50", ip);
+}
+
+TEST_F(ModemTest, SendAndClose)
+{
+    ASSERT_TRUE(esp.startTCP((char *) "example.com", 80));
+    EXPECT_TRUE(sentCommand("AT+CIPSTART=\"TCP\",\"example.com\",80"));
+    EXPECT_TRUE(esp.connected());
+
+    EXPECT_TRUE(esp.send((const uint8_t *) "hello\r\n", 7));
+    /* String requests get an empty line appended */
+    EXPECT_TRUE(esp.send(String("world")));
+    EXPECT_EQ("hello\r\nworld\r\n\r\n", sim.sent());
+
+    EXPECT_TRUE(esp.stopTCP());
+    EXPECT_FALSE(esp.connected());
+    EXPECT_FALSE(sim.linkOpen());
+}
+
+TEST_F(ModemTest, ConnectRefused)
+{
+    noRetries();
+    sim.setConnectFail(true);
+    EXPECT_FALSE(esp.startTCP((char *) "example.com", 80));
+    EXPECT_FALSE(esp.connected());
+}
+
+TEST_F(ModemTest, ReceiveActive)
+{
+    uint8_t buffer[16];
+
+    ASSERT_TRUE(esp.startTCP((char *) "example.com", 80));
+    sim.deliver("0123456789");
+
+    /* Frame is read in two calls */
+    ASSERT_EQ(4, esp.receive(buffer, 4, 1000));
+    EXPECT_EQ(0, memcmp(buffer, "0123", 4));
+    ASSERT_EQ(6, esp.receive(buffer, sizeof(buffer), 1000));
+    EXPECT_EQ(0, memcmp(buffer, "456789", 6));
+    EXPECT_EQ(0, esp.receive(buffer, sizeof(buffer), 0));
+}
+
+TEST_F(ModemTest, ReceivePassive)
+{
+    uint8_t buffer[16];
+
+    ASSERT_TRUE(esp.receiveMode(true));
+    EXPECT_TRUE(sim.passive());
+    ASSERT_TRUE(esp.startTCP((char *) "example.com", 80));
+
+    /* Nothing is requested until the modem reports data */
+    EXPECT_EQ(0, esp.receive(buffer, sizeof(buffer), 0));
+
+    sim.deliver("hello world");
+    ASSERT_EQ(5, esp.receive(buffer, 5, 1000));
+    EXPECT_EQ(0, memcmp(buffer, "hello", 5));
+    EXPECT_EQ(6U, esp.receivePending());
+    ASSERT_EQ(6, esp.receive(buffer, sizeof(buffer), 1000));
+    EXPECT_EQ(0, memcmp(buffer, " world", 6));
+    EXPECT_EQ(0U, esp.receivePending());
+    EXPECT_TRUE(sentCommand("AT+CIPRECVDATA=5"));
+    EXPECT_TRUE(sentCommand("AT+CIPRECVDATA=6"));
+}
+
+TEST_F(ModemTest, ReceiveLength)
+{
+    ASSERT_TRUE(esp.receiveMode(true));
+    ASSERT_TRUE(esp.startTCP((char *) "example.com", 80));
+    sim.deliver("abc");
+    EXPECT_EQ(3, esp.receiveLength());
+    EXPECT_EQ(3U, esp.receivePending());
+}
+
+TEST_F(ModemTest, RemoteClose)
+{
+    uint8_t buffer[16];
+
+    ASSERT_TRUE(esp.startTCP((char *) "example.com", 80));
+    sim.closeRemote();
+    EXPECT_EQ(0, esp.receive(buffer, sizeof(buffer), 200));
+    EXPECT_FALSE(esp.connected());
+}
+
+TEST_F(ModemTest, BusyIsRetried)
+{
+    esp8266_metrics_t metrics;
+
+    sim.setBusy(2);
+    EXPECT_TRUE(esp.test());
+    esp.metrics(&metrics);
+    EXPECT_EQ(2U, metrics.busy);
+    EXPECT_EQ(2U, metrics.retries);
+}
+
+TEST_F(ModemTest, HungModemTimesOut)
+{
+    noRetries();
+    sim.setSilent(true);
+    EXPECT_FALSE(esp.test());
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_TIMEOUT, esp.lastResult());
+
+    sim.setSilent(false);
+    EXPECT_TRUE(esp.test());
+}
+
+TEST_F(ModemTest, RecoverRestoresSettings)
+{
+    std::vector<std::string> commands;
+    size_t reset = 0;
+
+    ASSERT_TRUE(esp.echo(false));
+    ASSERT_TRUE(esp.operationMode(1));
+    ASSERT_TRUE(esp.connectionMode(0));
+    ASSERT_TRUE(esp.receiveMode(true));
+    ASSERT_TRUE(esp.joinAP((char *) "home", (char *) "secret"));
+    ASSERT_TRUE(esp.startTCP((char *) "example.com", 80));
+
+    /* Module stops answering, threshold timeouts make it unhealthy */
+    noRetries();
+    sim.hang();
+    for (int i = 0; i < ESP8266_RECOVERY_THRESHOLD; i++)
+    {
+        EXPECT_FALSE(esp.test());
+    }
+
+    /* "+++" and "AT" get nothing, the software reset brings it back with echo on */
+    ASSERT_TRUE(esp.maintain());
+    EXPECT_FALSE(sim.echo());
+    EXPECT_TRUE(sim.passive());
+    EXPECT_TRUE(sim.linkOpen());
+    EXPECT_TRUE(esp.connected());
+
+    commands = sim.commands();
+    while ((reset < commands.size()) && ("AT+RST" != commands[reset]))
+    {
+        reset++;
+    }
+    commands.erase(commands.begin(), commands.begin() + (reset + 1));
+    EXPECT_EQ(std::vector<std::string>({"AT", "ATE0", "AT+CWMODE_CUR=1", "AT+CIPMUX=0", "AT+CIPRECVMODE=1",
+                                        "AT+CWJAP_CUR=\"home\",\"secret\"", "AT+CIPSTART=\"TCP\",\"example.com\",80"}),
+              commands);
+}
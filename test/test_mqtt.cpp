@@ -0,0 +1,384 @@
+/**
+ * @file test_mqtt.cpp
+ * @brief ESP8266Mqtt tests against a broker stand-in behind the simulated modem.
+ */
+
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ESP8266Mqtt.h"
+#include "SimModule.h"
+
+/**
+ * Minimal MQTT 3.1.1 broker: accepts (or refuses) CONNECT, acknowledges
+ * SUBSCRIBE, answers PINGREQ and sends PUBLISH back when the client is
+ * subscribed to its topic. Runs on the simulator thread.
+ */
+class BrokerStandIn: public ModemPeer
+{
+    public:
+        typedef struct
+        {
+            uint8_t header;
+            std::string topic;
+            std::string payload;
+        } packet_t;
+
+        BrokerStandIn(void) : connackCode(0) { }
+
+        uint8_t connackCode;     /* CONNACK return code to answer with */
+
+        virtual void onConnect(ModemSim &modem)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            (void) modem;
+            _input.clear();
+        }
+
+        virtual void onData(ModemSim &modem, const std::string &data)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            size_t pos = 0;
+            uint32_t remaining = 0;
+            uint8_t shift = 0;
+            bool complete = false;
+
+            _input += data;
+            while (2 <= _input.size())
+            {
+                /* Remaining length, up to 4 bytes */
+                remaining = 0;
+                complete = false;
+                for (pos = 1, shift = 0; (pos < _input.size()) && (5 > pos); pos++, shift += 7)
+                {
+                    remaining |= (uint32_t) (_input[pos] & 0x7F) << shift;
+                    if (0 == (_input[pos] & 0x80))
+                    {
+                        complete = true;
+                        pos++;
+                        break;
+                    }
+                }
+                if (!complete || (_input.size() < (pos + remaining)))
+                {
+                    break;
+                }
+
+                handle(modem, (uint8_t) _input[0], _input.substr(pos, remaining));
+                _input.erase(0, pos + remaining);
+            }
+        }
+
+        /* Packets received from the client, in order */
+        std::vector<packet_t> received(void)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            return _received;
+        }
+
+        size_t count(uint8_t type)
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            size_t ret = 0;
+            for (const packet_t &packet : _received)
+            {
+                if (type == (packet.header & 0xF0))
+                {
+                    ret++;
+                }
+            }
+            return ret;
+        }
+
+        /* Encode a PUBLISH from the broker */
+        static std::string publish(const std::string &topic, const std::string &payload,
+                                   uint8_t qos = 0, uint16_t id = 0)
+        {
+            std::string body = word((uint16_t) topic.size()) + topic;
+            if (0 < qos)
+            {
+                body += word(id);
+            }
+            body += payload;
+            return packet((uint8_t) (ESP8266_MQTT_PUBLISH | (qos << 1)), body);
+        }
+
+        static std::string packet(uint8_t header, const std::string &body)
+        {
+            std::string ret(1, (char) header);
+            size_t len = body.size();
+
+            do
+            {
+                ret += (char) ((len & 0x7F) | ((0x7F < len) ? 0x80 : 0x00));
+                len >>= 7;
+            } while (0 < len);
+            return ret + body;
+        }
+
+        static std::string word(uint16_t value)
+        {
+            return std::string(1, (char) (value >> 8)) + std::string(1, (char) (value & 0xFF));
+        }
+
+    private:
+        std::mutex _lock;
+        std::string _input;
+        std::vector<packet_t> _received;
+        std::vector<std::string> _subscriptions;
+
+        static std::string readString(const std::string &body, size_t *pos)
+        {
+            std::string ret;
+            size_t len = 0;
+
+            if ((*pos + 2) <= body.size())
+            {
+                len = ((size_t) (uint8_t) body[*pos] << 8) | (uint8_t) body[*pos + 1];
+                ret = body.substr(*pos + 2, len);
+                *pos += 2 + len;
+            }
+            return ret;
+        }
+
+        void handle(ModemSim &modem, uint8_t header, const std::string &body)
+        {
+            packet_t rx;
+            size_t pos = 0;
+
+            rx.header = header;
+            switch (header & 0xF0)
+            {
+                case ESP8266_MQTT_CONNECT:
+                    /* Protocol name, level, flags and keep alive, then client identifier */
+                    pos = 10;
+                    rx.topic = readString(body, &pos);
+                    modem.deliver(packet(ESP8266_MQTT_CONNACK, std::string(1, '\0') + std::string(1, (char) connackCode)));
+                    break;
+
+                case ESP8266_MQTT_SUBSCRIBE & 0xF0:
+                    pos = 2;
+                    rx.topic = readString(body, &pos);
+                    _subscriptions.push_back(rx.topic);
+                    modem.deliver(packet(ESP8266_MQTT_SUBACK, body.substr(0, 2) + std::string(1, '\0')));
+                    break;
+
+                case ESP8266_MQTT_PUBLISH:
+                    rx.topic = readString(body, &pos);
+                    rx.payload = body.substr(pos);
+                    for (const std::string &topic : _subscriptions)
+                    {
+                        if (topic == rx.topic)
+                        {
+                            modem.deliver(publish(rx.topic, rx.payload));
+                        }
+                    }
+                    break;
+
+                case ESP8266_MQTT_PUBACK:
+                    rx.payload = body;
+                    break;
+
+                case ESP8266_MQTT_PINGREQ:
+                    modem.deliver(packet(ESP8266_MQTT_PINGRESP, ""));
+                    break;
+
+                default:
+                    break;
+            }
+            _received.push_back(rx);
+        }
+};
+
+/* Messages delivered to the client callback */
+static std::mutex messagesLock;
+static std::vector<std::pair<std::string, std::string>> messages;
+
+static void onMessage(const char *topic, const uint8_t *payload, uint16_t len)
+{
+    std::lock_guard<std::mutex> guard(messagesLock);
+    messages.push_back(std::make_pair(std::string(topic), std::string((const char *) payload, len)));
+}
+
+static size_t messageCount(void)
+{
+    std::lock_guard<std::mutex> guard(messagesLock);
+    return messages.size();
+}
+
+class MqttTest: public ::testing::Test
+{
+    protected:
+        SimModule module;
+        BrokerStandIn broker;
+        ESP8266Mqtt mqtt;
+
+        MqttTest(void) : mqtt(module.esp) { }
+
+        void SetUp(void) override
+        {
+            ASSERT_TRUE(module.begin());
+            module.sim.setPeer(&broker);
+            mqtt.onMessage(onMessage);
+            std::lock_guard<std::mutex> guard(messagesLock);
+            messages.clear();
+        }
+
+        void TearDown(void) override
+        {
+            module.sim.setPeer(NULL);
+        }
+
+        bool connect(uint16_t keepAlive = 60)
+        {
+            return mqtt.connect((char *) "broker.local", 1883, "client-1", keepAlive);
+        }
+
+        /* Run loop() until done() or timeout */
+        bool spin(std::function<bool(void)> done, uint32_t timeout)
+        {
+            uint32_t start = millis();
+
+            while (!done())
+            {
+                if (timeout <= (millis() - start))
+                {
+                    return false;
+                }
+                mqtt.loop();
+                delay(1);
+            }
+            return true;
+        }
+
+        size_t sends(void)
+        {
+            size_t ret = 0;
+            for (const std::string &cmd : module.sim.commands())
+            {
+                if (0 == cmd.compare(0, 11, "AT+CIPSEND="))
+                {
+                    ret++;
+                }
+            }
+            return ret;
+        }
+};
+
+TEST_F(MqttTest, ConnectAccepted)
+{
+    ASSERT_TRUE(connect());
+    EXPECT_TRUE(mqtt.connected());
+    EXPECT_TRUE(module.sim.passive());
+    ASSERT_EQ(1U, broker.count(ESP8266_MQTT_CONNECT));
+    EXPECT_EQ("client-1", broker.received()[0].topic);
+}
+
+TEST_F(MqttTest, ConnectRefused)
+{
+    uint32_t start = millis();
+
+    broker.connackCode = 5; /* Not authorized */
+    EXPECT_FALSE(connect());
+    EXPECT_FALSE(mqtt.connected());
+    EXPECT_FALSE(module.sim.linkOpen());
+
+    /* Refusal ends the wait, no CONNACK timeout */
+    EXPECT_GT((uint32_t) ESP8266_MQTT_TIMEOUT, millis() - start);
+}
+
+TEST_F(MqttTest, PublishesAreBatched)
+{
+    size_t before = 0;
+
+    ASSERT_TRUE(connect());
+    before = sends();
+
+    EXPECT_TRUE(mqtt.publish("sensors/temp", "21.5"));
+    EXPECT_TRUE(mqtt.publish("sensors/hum", "40"));
+    EXPECT_TRUE(mqtt.publish("sensors/light", "812"));
+    ASSERT_TRUE(spin([&](void) { return 3 == broker.count(ESP8266_MQTT_PUBLISH); }, 1000));
+
+    /* All three went out on a single AT+CIPSEND, with no keep alive ping behind them */
+    EXPECT_EQ(before + 1, sends());
+    EXPECT_EQ(0U, broker.count(ESP8266_MQTT_PINGREQ));
+    std::vector<BrokerStandIn::packet_t> packets = broker.received();
+    EXPECT_EQ("sensors/temp", packets[1].topic);
+    EXPECT_EQ("21.5", packets[1].payload);
+    EXPECT_EQ("sensors/light", packets[3].topic);
+    EXPECT_EQ("812", packets[3].payload);
+}
+
+TEST_F(MqttTest, SubscribeAndReceive)
+{
+    ASSERT_TRUE(connect());
+    ASSERT_TRUE(mqtt.subscribe("cmd/led"));
+    EXPECT_TRUE(mqtt.publish("cmd/led", "on"));
+    ASSERT_TRUE(spin([](void) { return 0 < messageCount(); }, 1000));
+
+    std::lock_guard<std::mutex> guard(messagesLock);
+    EXPECT_EQ("cmd/led", messages[0].first);
+    EXPECT_EQ("on", messages[0].second);
+}
+
+TEST_F(MqttTest, SubscribeAndReceivePassive)
+{
+    ASSERT_TRUE(module.esp.receiveMode(true));
+    ASSERT_TRUE(connect());
+    ASSERT_TRUE(mqtt.subscribe("cmd/led"));
+    EXPECT_TRUE(mqtt.publish("cmd/led", "off"));
+    ASSERT_TRUE(spin([](void) { return 0 < messageCount(); }, 1000));
+
+    std::lock_guard<std::mutex> guard(messagesLock);
+    EXPECT_EQ("cmd/led", messages[0].first);
+    EXPECT_EQ("off", messages[0].second);
+}
+
+TEST_F(MqttTest, PublishDuringBatchSend)
+{
+    ASSERT_TRUE(connect());
+
+    /* Broker sends while the batch is still on AT+CIPSEND */
+    module.sim.deliverDuringSend(BrokerStandIn::publish("cmd/led", "on"));
+    EXPECT_TRUE(mqtt.publish("sensors/temp", "21.5"));
+    ASSERT_TRUE(spin([](void) { return 0 < messageCount(); }, 1000));
+
+    std::lock_guard<std::mutex> guard(messagesLock);
+    EXPECT_EQ("cmd/led", messages[0].first);
+    EXPECT_EQ("on", messages[0].second);
+}
+
+TEST_F(MqttTest, PublishDuringPing)
+{
+    /* PUBLISH lands within the PINGREQ send, PINGRESP right after it */
+    ASSERT_TRUE(connect(1));
+    module.sim.deliverDuringSend(BrokerStandIn::publish("cmd/led", "off"));
+
+    /* A lost PINGRESP would stop pings and drop the connection */
+    ASSERT_TRUE(spin([&](void) { return 2 <= broker.count(ESP8266_MQTT_PINGREQ); }, 2000));
+    EXPECT_TRUE(mqtt.connected());
+    EXPECT_EQ(1U, messageCount());
+}
+
+TEST_F(MqttTest, QoS1IsAcknowledged)
+{
+    ASSERT_TRUE(connect());
+    module.sim.deliver(BrokerStandIn::publish("cmd/reboot", "now", 1, 0x1234));
+    ASSERT_TRUE(spin([&](void) { return 1 == broker.count(ESP8266_MQTT_PUBACK); }, 1000));
+
+    std::vector<BrokerStandIn::packet_t> packets = broker.received();
+    EXPECT_EQ(BrokerStandIn::word(0x1234), packets.back().payload);
+    EXPECT_EQ(1U, messageCount());
+}
+
+TEST_F(MqttTest, KeepAlive)
+{
+    /* Ping after half of the keep alive time without sending */
+    ASSERT_TRUE(connect(1));
+    ASSERT_TRUE(spin([&](void) { return 2 <= broker.count(ESP8266_MQTT_PINGREQ); }, 2000));
+    EXPECT_TRUE(mqtt.connected());
+}
@@ -0,0 +1,226 @@
+/**
+ * @file test_parser.cpp
+ * @brief Response parser tests: parseLine(), parseIPD(), parseClosed(), parseAP(), parsePing().
+ */
+
+#include <gtest/gtest.h>
+
+#include "ESP8266.h"
+
+/* Destination surrounded by guard bytes, to catch writes past its end */
+#define GUARD_LEN   (8)
+#define GUARD_BYTE  ((char) 0xA5)
+
+class GuardedBuffer
+{
+    public:
+        GuardedBuffer(size_t len) : _len(len)
+        {
+            memset(_storage, GUARD_BYTE, sizeof(_storage));
+        }
+
+        char *data(void) { return &_storage[GUARD_LEN]; }
+        size_t size(void) { return _len; }
+
+        bool intact(void)
+        {
+            for (size_t i = 0; i < GUARD_LEN; i++)
+            {
+                if ((GUARD_BYTE != _storage[i]) || (GUARD_BYTE != _storage[GUARD_LEN + _len + i]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        size_t _len;
+        char _storage[GUARD_LEN + ESP8266_RX_BUFF_LEN + GUARD_LEN];
+};
+
+/* parseLine() works on a writable copy, cut like getResponse() does with longer lines */
+static int8_t parse(const char *line, char *dest, size_t destLen, const char *pass,
+                    const char *fail = NULL, char delimA = '\0', char delimB = '\0')
+{
+    char copy[ESP8266_RX_BUFF_LEN];
+    size_t len = strlen(line);
+
+    if ((sizeof(copy) - 1) < len)
+    {
+        len = sizeof(copy) - 1;
+    }
+    memcpy(copy, line, len);
+    copy[len] = '\0';
+    return ESP8266::parseLine(copy, (uint8_t) len, dest, destLen, pass, fail, delimA, delimB);
+}
+
+TEST(ParseLine, Pass)
+{
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_SUCCESS, parse("OK\r", NULL, 0, "OK"));
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_SUCCESS, parse("SEND OK\r", NULL, 0, "SEND OK"));
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_WAIT, parse("Recv 5 bytes\r", NULL, 0, "SEND OK"));
+}
+
+TEST(ParseLine, Results)
+{
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_FAILED, parse("ALREADY CONNECT\r", NULL, 0, "CONNECT", "ALREADY CONNECT"));
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_BUSY, parse("busy p...\r", NULL, 0, "OK"));
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_ERROR, parse("ERROR\r", NULL, 0, "OK"));
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_WAIT, parse("\r", NULL, 0, "OK"));
+}
+
+TEST(ParseLine, Instance)
+{
+    GuardedBuffer ip(ESP8266_IP_LEN);
+
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_SUCCESS,
+              parse("+CIFSR:STAIP,\"192.168.1.105\"\r", ip.data(), ip.size(), "+CIFSR:STAIP,", NULL, '"', '"'));
+    EXPECT_STREQ("192.168.1.105", ip.data());
+    EXPECT_TRUE(ip.intact());
+
+    /* Largest instance that fits, including NULL terminator */
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_SUCCESS,
+              parse("+CIFSR:STAIP,\"255.255.255.255\"\r", ip.data(), ip.size(), "+CIFSR:STAIP,", NULL, '"', '"'));
+    EXPECT_STREQ("255.255.255.255", ip.data());
+    EXPECT_TRUE(ip.intact());
+}
+
+TEST(ParseLine, InstanceTooLong)
+{
+    GuardedBuffer ip(ESP8266_IP_LEN);
+
+    strcpy(ip.data(), "unchanged");
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_WAIT,
+              parse("+CIFSR:STAIP,\"192.168.1.105.192.168.1.105\"\r", ip.data(), ip.size(),
+                    "+CIFSR:STAIP,", NULL, '"', '"'));
+    EXPECT_STREQ("unchanged", ip.data());
+    EXPECT_TRUE(ip.intact());
+}
+
+TEST(ParseLine, Malformed)
+{
+    const char *lines[] = {
+        "+CIFSR:STAIP,\"",
+        "+CIFSR:STAIP,\"\"",
+        "+CIFSR:STAIP,\"1\"",
+        "+CIFSR:STAIP,192.168.1.105\"",
+        "+CIFSR:STAIP,",
+        "+CIFSR:STAIP,\"0123456789012345678901234567890123456789012345678901234\"",
+    };
+
+    for (const char *line : lines)
+    {
+        GuardedBuffer ip(ESP8266_IP_LEN);
+        EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_WAIT, parse(line, ip.data(), ip.size(), "+CIFSR:STAIP,", NULL, '"', '"')) << line;
+        EXPECT_TRUE(ip.intact()) << line;
+    }
+}
+
+TEST(ParseLine, EmbeddedNull)
+{
+    /* Delimiters are looked for in the whole line, NULL bytes included */
+    char line[] = "+CWLAP:\0\"HomeNetwork\"\r";
+    char ssid[ESP8266_MAX_SSID_LEN + 1];
+
+    EXPECT_EQ(ESP8266::ESP8266_CMD_RSP_SUCCESS,
+              ESP8266::parseLine(line, (uint8_t) (sizeof(line) - 1), ssid, sizeof(ssid), "+CWLAP:", NULL, '"', '"'));
+    EXPECT_STREQ("HomeNetwork", ssid);
+}
+
+TEST(ParseIPD, Valid)
+{
+    int8_t link = 0;
+
+    EXPECT_EQ(512, ESP8266::parseIPD("+IPD,512:HTTP/1.1 200 OK", &link));
+    EXPECT_EQ(-1, link);
+    EXPECT_EQ(1460, ESP8266::parseIPD("+IPD,0,1460:HTTP/1.1 200 OK", &link));
+    EXPECT_EQ(0, link);
+    EXPECT_EQ(38, ESP8266::parseIPD("+IPD,4,38\r", &link));
+    EXPECT_EQ(4, link);
+    EXPECT_EQ(20, ESP8266::parseIPD("+IPD,20\r", NULL));
+}
+
+TEST(ParseIPD, Invalid)
+{
+    const char *lines[] = {
+        "+IPD,",
+        "+IPD,:",
+        "+IPD,99999999999:",
+        "+IPD,1,:",
+        "+IPD,1,99999999999:",
+        "+IPD,-5:",
+        "+IPD,128,5:",
+        "IPD,5:",
+        "",
+    };
+
+    for (const char *line : lines)
+    {
+        int8_t link = 42;
+        EXPECT_EQ(-1, ESP8266::parseIPD(line, &link)) << line;
+        EXPECT_EQ(42, link) << line;
+    }
+    EXPECT_EQ(-1, ESP8266::parseIPD(NULL, NULL));
+}
+
+TEST(ParseClosed, Lines)
+{
+    int8_t link = 0;
+
+    EXPECT_TRUE(ESP8266::parseClosed("CLOSED", &link));
+    EXPECT_EQ(-1, link);
+    EXPECT_TRUE(ESP8266::parseClosed("CLOSED\r", NULL));
+    EXPECT_TRUE(ESP8266::parseClosed("3,CLOSED\r", &link));
+    EXPECT_EQ(3, link);
+    EXPECT_TRUE(ESP8266::parseClosed("127,CLOSED", &link));
+    EXPECT_EQ(127, link);
+
+    EXPECT_FALSE(ESP8266::parseClosed("128,CLOSED", NULL));
+    EXPECT_FALSE(ESP8266::parseClosed("CLOSED BY PEER", NULL));
+    EXPECT_FALSE(ESP8266::parseClosed("SOCKET CLOSED", NULL));
+    EXPECT_FALSE(ESP8266::parseClosed(",CLOSED", NULL));
+    EXPECT_FALSE(ESP8266::parseClosed("", NULL));
+    EXPECT_FALSE(ESP8266::parseClosed(NULL, NULL));
+}
+
+TEST(ParseAP, Valid)
+{
+    esp8266_ap_t ap;
+
+    memset(&ap, 0, sizeof(ap));
+    ASSERT_TRUE(ESP8266::parseAP("+CWLAP:(-62,\"a0:f3:c1:12:34:56\",6)\r", &ap));
+    EXPECT_EQ(-62, ap.rssi);
+    EXPECT_STREQ("a0:f3:c1:12:34:56", ap.bssid);
+    EXPECT_EQ(6, ap.channel);
+}
+
+TEST(ParseAP, Invalid)
+{
+    const char *lines[] = {
+        "+CWLAP:(3,\"HomeNetwork\",-62,\"a0:f3:c1:12:34:56\",6,-8,0)",
+        "+CWLAP:(-62,\"a0:f3:c1:12:34:56:78:9a:bc\",6)",
+        "+CWLAP:(-62,\"a0:f3:c1:12:34:56\",15)",
+        "+CWLAP:(5,\"a0:f3:c1:12:34:56\",6)",
+        "+CWLAP:(-62,\"a0:f3:c1:12:34:56",
+        "+CWLAP:(",
+        "OK",
+    };
+    esp8266_ap_t ap;
+
+    for (const char *line : lines)
+    {
+        EXPECT_FALSE(ESP8266::parseAP(line, &ap)) << line;
+    }
+}
+
+TEST(ParsePing, Lines)
+{
+    EXPECT_EQ(23, ESP8266::parsePing("+PING:23\r"));
+    EXPECT_EQ(23, ESP8266::parsePing("+23\r"));
+    EXPECT_EQ(-1, ESP8266::parsePing("+timeout\r"));
+    EXPECT_EQ(-1, ESP8266::parsePing("+12345678"));
+    EXPECT_EQ(-1, ESP8266::parsePing("+PING:"));
+    EXPECT_EQ(-1, ESP8266::parsePing("OK"));
+    EXPECT_EQ(-1, ESP8266::parsePing(NULL));
+}
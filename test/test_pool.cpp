@@ -0,0 +1,190 @@
+/**
+ * @file test_pool.cpp
+ * @brief ESP8266Pool tests against several simulated modems.
+ */
+
+#include <gtest/gtest.h>
+
+#include "ESP8266Pool.h"
+#include "SimModule.h"
+
+#define POOL_MODULES    (3)
+
+class PoolTest: public ::testing::Test
+{
+    protected:
+        SimModule modules[POOL_MODULES];
+        ESP8266Pool pool;
+
+        void SetUp(void) override
+        {
+            for (SimModule &module : modules)
+            {
+                ASSERT_TRUE(module.begin());
+                ASSERT_TRUE(pool.add(module.esp));
+            }
+        }
+
+        int moduleIndex(int8_t link)
+        {
+            for (int i = 0; i < POOL_MODULES; i++)
+            {
+                if (pool.module(link) == &modules[i].esp)
+                {
+                    return i;
+                }
+            }
+            return -1;
+        }
+};
+
+TEST_F(PoolTest, OneConnectionPerModule)
+{
+    int8_t links[POOL_MODULES];
+
+    EXPECT_EQ(POOL_MODULES, pool.size());
+    EXPECT_EQ(POOL_MODULES, pool.healthy());
+
+    for (int i = 0; i < POOL_MODULES; i++)
+    {
+        links[i] = pool.startTCP((char *) "example.com", 80);
+        ASSERT_NE(ESP8266_POOL_INVALID_LINK, links[i]);
+    }
+    EXPECT_NE(moduleIndex(links[0]), moduleIndex(links[1]));
+    EXPECT_NE(moduleIndex(links[0]), moduleIndex(links[2]));
+    EXPECT_NE(moduleIndex(links[1]), moduleIndex(links[2]));
+    for (SimModule &module : modules)
+    {
+        EXPECT_TRUE(module.sim.linkOpen());
+    }
+
+    /* Every module is busy with a connection */
+    EXPECT_EQ(ESP8266_POOL_INVALID_LINK, pool.startTCP((char *) "example.com", 80));
+
+    EXPECT_TRUE(pool.stopTCP(links[1]));
+    EXPECT_NE(ESP8266_POOL_INVALID_LINK, pool.startTCP((char *) "example.com", 80));
+}
+
+TEST_F(PoolTest, LeastLoaded)
+{
+    int8_t link = pool.startTCP((char *) "example.com", 80);
+    int first = moduleIndex(link);
+
+    ASSERT_LE(0, first);
+    EXPECT_TRUE(pool.send(link, String("a long request to load the first module")));
+    EXPECT_TRUE(pool.stopTCP(link));
+
+    /* First module sent the most, new connection goes elsewhere */
+    link = pool.startTCP((char *) "example.com", 80);
+    EXPECT_NE(first, moduleIndex(link));
+}
+
+TEST_F(PoolTest, ConnectFailover)
+{
+    int8_t link = ESP8266_POOL_INVALID_LINK;
+
+    /* Busy on AT+CIPSTART and on the AT test that follows, module is down */
+    modules[0].sim.setBusy(2 * ESP8266_RETRY_ATTEMPTS);
+    link = pool.startTCP((char *) "example.com", 80);
+    ASSERT_NE(ESP8266_POOL_INVALID_LINK, link);
+    EXPECT_NE(0, moduleIndex(link));
+    EXPECT_EQ(POOL_MODULES - 1, pool.healthy());
+
+    /* Module answers again, check() brings it back */
+    EXPECT_EQ(POOL_MODULES, pool.check());
+}
+
+TEST_F(PoolTest, ConnectRefusedByServer)
+{
+    for (SimModule &module : modules)
+    {
+        module.sim.setConnectFail(true);
+    }
+
+    /* First module still answers AT, the server is the problem */
+    EXPECT_EQ(ESP8266_POOL_INVALID_LINK, pool.startTCP((char *) "example.com", 80));
+    EXPECT_EQ(POOL_MODULES, pool.healthy());
+    for (int i = 1; i < POOL_MODULES; i++)
+    {
+        for (const std::string &cmd : modules[i].sim.commands())
+        {
+            EXPECT_NE(0, cmd.compare(0, 12, "AT+CIPSTART=")) << i;
+        }
+    }
+}
+
+TEST_F(PoolTest, SendFailover)
+{
+    int8_t link = pool.startTCP((char *) "example.com", 80);
+    int first = moduleIndex(link);
+
+    ASSERT_LE(0, first);
+    modules[first].sim.setSendStall(true);
+
+    /* Module takes the data but never confirms it, data goes out through another one */
+    EXPECT_TRUE(pool.send(link, String("payload")));
+    EXPECT_EQ(1U, pool.failovers());
+    EXPECT_NE(first, moduleIndex(link));
+    EXPECT_EQ("payload\r\n\r\n", modules[moduleIndex(link)].sim.sent());
+    EXPECT_EQ(POOL_MODULES - 1, pool.healthy());
+
+    /* Old connection is not left open */
+    EXPECT_FALSE(modules[first].sim.linkOpen());
+    EXPECT_FALSE(modules[first].esp.connected());
+}
+
+TEST_F(PoolTest, SendFailoverSilent)
+{
+    int8_t link = pool.startTCP((char *) "example.com", 80);
+    int first = moduleIndex(link);
+
+    ASSERT_LE(0, first);
+    modules[first].sim.setSilent(true);
+
+    /* Module doesn't answer AT+CIPSEND, data goes out through another one */
+    EXPECT_TRUE(pool.send(link, String("payload")));
+    EXPECT_EQ(1U, pool.failovers());
+    EXPECT_NE(first, moduleIndex(link));
+    EXPECT_EQ("payload\r\n\r\n", modules[moduleIndex(link)].sim.sent());
+    EXPECT_EQ("", modules[first].sim.sent());
+    EXPECT_EQ(POOL_MODULES - 1, pool.healthy());
+}
+
+TEST_F(PoolTest, CheckMovesClosedLink)
+{
+    int8_t link = pool.startTCP((char *) "example.com", 80);
+    int first = moduleIndex(link);
+
+    ASSERT_LE(0, first);
+    modules[first].sim.closeRemote();
+
+    /* AT test of the module sees "CLOSED", the connection is opened again */
+    EXPECT_EQ(POOL_MODULES, pool.check());
+    EXPECT_EQ(1U, pool.failovers());
+    EXPECT_LE(0, moduleIndex(link));
+    EXPECT_TRUE(pool.module(link)->connected());
+}
+
+TEST_F(PoolTest, Metrics)
+{
+    esp8266_metrics_t total;
+    esp8266_metrics_t current;
+    uint32_t commands = 0;
+    uint32_t bytesSent = 0;
+
+    for (int i = 0; i < POOL_MODULES; i++)
+    {
+        ASSERT_NE(ESP8266_POOL_INVALID_LINK, pool.startTCP((char *) "example.com", 80));
+    }
+
+    pool.metrics(&total);
+    for (SimModule &module : modules)
+    {
+        module.esp.metrics(&current);
+        EXPECT_LT(0U, current.commands);
+        commands += current.commands;
+        bytesSent += current.bytesSent;
+    }
+    EXPECT_EQ(commands, total.commands);
+    EXPECT_EQ(bytesSent, total.bytesSent);
+}
@@ -0,0 +1,197 @@
+/**
+ * @file test_queue.cpp
+ * @brief ESP8266Queue tests against the simulated modem: overflow, batching and failed sends.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+#include <string>
+
+#include "ESP8266Queue.h"
+#include "SimModule.h"
+
+class QueueTest: public ::testing::Test
+{
+    protected:
+        SimModule module;
+
+        void SetUp(void) override
+        {
+            ASSERT_TRUE(module.begin());
+        }
+
+        static std::string record(int i, size_t len = 7)
+        {
+            char prefix[16];
+            std::string ret;
+
+            snprintf(prefix, sizeof(prefix), "rec-%02d", i);
+            ret = prefix;
+            ret.resize(len - 1, '.');
+            return ret + "\n";
+        }
+
+        static bool push(ESP8266Queue &queue, const std::string &data)
+        {
+            return queue.push((const uint8_t *) data.data(), (uint16_t) data.size());
+        }
+
+        size_t countSends(void)
+        {
+            size_t count = 0;
+            for (const std::string &line : module.sim.commands())
+            {
+                count += (0 == line.compare(0, 11, "AT+CIPSEND=")) ? 1 : 0;
+            }
+            return count;
+        }
+};
+
+TEST_F(QueueTest, DropOldest)
+{
+    /* 7 records of 7 bytes + 2 bytes length each */
+    ESP8266StaticRamStore<64> store;
+    ESP8266Queue queue(module.esp, store);
+    esp8266_queue_stats_t stats;
+    std::string expected;
+
+    /* Ring wraps around several times, records split across its end */
+    for (int i = 0; i < 30; i++)
+    {
+        EXPECT_TRUE(push(queue, record(i)));
+    }
+    EXPECT_EQ(7U, queue.pending());
+    for (int i = 23; i < 30; i++)
+    {
+        expected += record(i);
+    }
+
+    ASSERT_TRUE(module.esp.startTCP((char *) "example.com", 80));
+    EXPECT_EQ(7U, queue.flush());
+    EXPECT_EQ(expected, module.sim.sent());
+
+    queue.stats(&stats);
+    EXPECT_EQ(30U, stats.queued);
+    EXPECT_EQ(23U, stats.dropped);
+    EXPECT_EQ(7U, stats.flushed);
+    EXPECT_EQ(0U, stats.pending);
+}
+
+TEST_F(QueueTest, DropNewest)
+{
+    ESP8266StaticRamStore<64> store;
+    ESP8266Queue queue(module.esp, store, ESP8266_QUEUE_DROP_NEWEST);
+    std::string expected;
+
+    for (int i = 0; i < 10; i++)
+    {
+        EXPECT_EQ(7 > i, push(queue, record(i))) << i;
+    }
+    for (int i = 0; i < 7; i++)
+    {
+        expected += record(i);
+    }
+    /* Longer than the store */
+    EXPECT_FALSE(push(queue, record(0, 63)));
+
+    ASSERT_TRUE(module.esp.startTCP((char *) "example.com", 80));
+    EXPECT_EQ(7U, queue.flush());
+    EXPECT_EQ(expected, module.sim.sent());
+}
+
+TEST_F(QueueTest, FlushInBatches)
+{
+    ESP8266StaticRamStore<4096> store;
+    ESP8266Queue queue(module.esp, store);
+    esp8266_queue_stats_t stats;
+    std::string expected;
+
+    /* Nothing is sent while offline */
+    for (int i = 0; i < 10; i++)
+    {
+        expected += record(i);
+        ASSERT_TRUE(push(queue, record(i)));
+    }
+    EXPECT_EQ(0U, queue.flush());
+    EXPECT_EQ(0U, countSends());
+
+    /* All records on one AT+CIPSEND */
+    ASSERT_TRUE(module.esp.startTCP((char *) "example.com", 80));
+    EXPECT_EQ(10U, queue.flush());
+    EXPECT_EQ(1U, countSends());
+    EXPECT_EQ(expected, module.sim.sent());
+
+    /* 30 records of 100 bytes, 20 fit in ESP8266_MAX_SEND_LEN */
+    for (int i = 0; i < 30; i++)
+    {
+        expected += record(i, 100);
+        ASSERT_TRUE(push(queue, record(i, 100)));
+    }
+    EXPECT_EQ(30U, queue.flush());
+    EXPECT_EQ(3U, countSends());
+    EXPECT_EQ(expected, module.sim.sent());
+
+    queue.stats(&stats);
+    EXPECT_EQ(3U, stats.batches);
+    EXPECT_EQ(40U, stats.flushed);
+}
+
+TEST_F(QueueTest, BusyKeepsRecords)
+{
+    ESP8266StaticRamStore<256> store;
+    ESP8266Queue queue(module.esp, store);
+    std::string expected;
+
+    for (int i = 0; i < 5; i++)
+    {
+        expected += record(i);
+        ASSERT_TRUE(push(queue, record(i)));
+    }
+    ASSERT_TRUE(module.esp.startTCP((char *) "example.com", 80));
+
+    /* Busy on every attempt, connection is kept */
+    module.sim.setBusy(ESP8266_RETRY_ATTEMPTS);
+    EXPECT_EQ(0U, queue.flush());
+    EXPECT_EQ(5U, queue.pending());
+    EXPECT_TRUE(module.esp.connected());
+    EXPECT_EQ("", module.sim.sent());
+
+    EXPECT_EQ(5U, queue.flush());
+    EXPECT_EQ(0U, queue.pending());
+    EXPECT_EQ(expected, module.sim.sent());
+}
+
+TEST_F(QueueTest, FailedSendKeepsRecords)
+{
+    ESP8266StaticRamStore<256> store;
+    ESP8266Queue queue(module.esp, store);
+    esp8266_queue_stats_t stats;
+    std::string expected;
+
+    for (int i = 0; i < 5; i++)
+    {
+        expected += record(i);
+        ASSERT_TRUE(push(queue, record(i)));
+    }
+    ASSERT_TRUE(module.esp.startTCP((char *) "example.com", 80));
+
+    /* Data written but never acknowledged, the batch is kept */
+    module.sim.setSendStall(true);
+    EXPECT_EQ(0U, queue.flush());
+    EXPECT_EQ(5U, queue.pending());
+
+    /* Sent again once the link is back */
+    module.sim.setSendStall(false);
+    if (!module.esp.connected())
+    {
+        ASSERT_TRUE(module.esp.startTCP((char *) "example.com", 80));
+    }
+    EXPECT_EQ(5U, queue.flush());
+    EXPECT_EQ(expected, module.sim.sent());
+
+    queue.stats(&stats);
+    EXPECT_EQ(5U, stats.flushed);
+    EXPECT_EQ(1U, stats.batches);
+}
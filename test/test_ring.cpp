@@ -0,0 +1,164 @@
+/**
+ * @file test_ring.cpp
+ * @brief ESP8266RingBuffer tests: full/empty, wraparound and a two thread SPSC run.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "ESP8266RingBuffer.h"
+#include "SimModule.h"
+#include "TraceStream.h"
+
+TEST(RingBuffer, Empty)
+{
+    ESP8266StaticRingBuffer<16> ring;
+
+    EXPECT_EQ(15, ring.capacity());
+    EXPECT_EQ(0, ring.available());
+    EXPECT_EQ(-1, ring.peek());
+    EXPECT_EQ(-1, ring.read());
+    EXPECT_EQ(0U, ring.write('x'));
+}
+
+TEST(RingBuffer, Full)
+{
+    ESP8266StaticRingBuffer<16> ring;
+
+    /* One slot is kept empty */
+    for (int i = 0; i < 15; i++)
+    {
+        EXPECT_TRUE(ring.push((uint8_t) i));
+    }
+    EXPECT_EQ(15, ring.available());
+    EXPECT_FALSE(ring.push(0xFF));
+    EXPECT_EQ(1U, ring.overflows());
+
+    for (int i = 0; i < 15; i++)
+    {
+        EXPECT_EQ(i, ring.read());
+    }
+    EXPECT_EQ(-1, ring.read());
+    EXPECT_TRUE(ring.push(0xAA));
+    EXPECT_EQ(0xAA, ring.peek());
+
+    ring.clear();
+    EXPECT_EQ(0, ring.available());
+}
+
+TEST(RingBuffer, Wraparound)
+{
+    ESP8266StaticRingBuffer<16> ring;
+    uint8_t next = 0;
+    uint8_t expected = 0;
+
+    /* 5 bytes in, 5 bytes out, indexes wrap every few rounds */
+    for (int round = 0; round < 50; round++)
+    {
+        for (int i = 0; i < 5; i++)
+        {
+            ASSERT_TRUE(ring.push(next++));
+        }
+        ASSERT_EQ(5, ring.available());
+        for (int i = 0; i < 5; i++)
+        {
+            ASSERT_EQ(expected++, ring.read()) << round;
+        }
+    }
+    EXPECT_EQ(0U, ring.overflows());
+}
+
+TEST(RingBuffer, PumpStopsWhenFull)
+{
+    ESP8266StaticRingBuffer<8> ring;
+    TraceStream source;
+
+    source.load("0123456789");
+    EXPECT_EQ(7, ring.pump(source));
+    EXPECT_EQ(3, source.available());
+    EXPECT_EQ(0U, ring.overflows());
+
+    /* Rest is taken once there is room */
+    EXPECT_EQ('0', ring.read());
+    EXPECT_EQ('1', ring.read());
+    EXPECT_EQ(2, ring.pump(source));
+    EXPECT_EQ('2', ring.read());
+}
+
+TEST(RingBuffer, TwoThreads)
+{
+    const uint32_t total = 1000000;
+    ESP8266StaticRingBuffer<64> ring;
+    uint32_t received = 0;
+    uint32_t mismatches = 0;
+    int c = 0;
+
+    std::thread producer([&](void)
+    {
+        for (uint32_t i = 0; i < total;)
+        {
+            if (ring.push((uint8_t) i))
+            {
+                i++;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    /* Bytes come out in order, none lost or duplicated */
+    while (received < total)
+    {
+        c = ring.read();
+        if (0 <= c)
+        {
+            if ((uint8_t) received != c)
+            {
+                mismatches++;
+            }
+            received++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    EXPECT_EQ(0U, mismatches);
+    EXPECT_EQ(0, ring.available());
+}
+
+TEST(RingBuffer, ReaderThread)
+{
+    SimModule module;
+    ESP8266StaticRingBuffer<256> ring;
+    std::atomic<bool> running(true);
+
+    ASSERT_TRUE(module.begin());
+    module.esp.attachRxBuffer(&ring, false);
+
+    /* Reader thread fills the ring while the driver writes commands */
+    std::thread reader([&](void)
+    {
+        while (running)
+        {
+            (void) ring.pump(module.port);
+        }
+    });
+
+    for (int i = 0; i < 50; i++)
+    {
+        EXPECT_TRUE(module.esp.test()) << i;
+    }
+    EXPECT_TRUE(module.esp.startTCP((char *) "example.com", 80));
+    EXPECT_TRUE(module.esp.send((const uint8_t *) "hello", 5));
+    EXPECT_EQ("hello", module.sim.sent());
+
+    running = false;
+    reader.join();
+    EXPECT_EQ(0U, ring.overflows());
+}